@@ -12,7 +12,11 @@
  *
  * This abstract class defines an abstract activation function, with
  * 2 basic methods, equation and firstDerivative, necessary for the 
- * back propagation algorithm.
+ * back propagation algorithm. Both are also available for a whole 
+ * layer at once, so that the network makes one virtual call per layer
+ * and the implementations can use the vector kernels; the derivative
+ * of a layer is obtained from the values already computed by equation.
+ * The layer versions exist in double and single precision.
  */
 class ActivationFunction
 {
@@ -41,6 +45,41 @@ public:
     * @return The value of the derivative at \p x.
     */
     virtual double firstDerivative(double x) const = 0;
+    /**
+    * @brief Abstract member function applying the activation function
+    * to a whole layer, in place.
+    *
+    * @param values On input the points in which the function is computed,
+    * on output the values of the function.
+    * @param n Number of entries in \p values.
+    */
+    virtual void equation(double* values, unsigned n) const = 0;
+    /**
+    * @brief Abstract member function computing the derivative of the 
+    * activation function for a whole layer, from the values of the 
+    * function itself (as computed by @ref equation).
+    *
+    * @param outputs Values of the activation function.
+    * @param derivatives On output the values of the derivative.
+    * @param n Number of entries in \p outputs and \p derivatives.
+    */
+    virtual void firstDerivativeFromOutput(const double* outputs, double* derivatives, unsigned n) const = 0;
+    /**
+    * @brief Single precision version of @ref equation for a whole layer.
+    *
+    * @param values On input the points in which the function is computed,
+    * on output the values of the function.
+    * @param n Number of entries in \p values.
+    */
+    virtual void equation(float* values, unsigned n) const = 0;
+    /**
+    * @brief Single precision version of @ref firstDerivativeFromOutput.
+    *
+    * @param outputs Values of the activation function.
+    * @param derivatives On output the values of the derivative.
+    * @param n Number of entries in \p outputs and \p derivatives.
+    */
+    virtual void firstDerivativeFromOutput(const float* outputs, float* derivatives, unsigned n) const = 0;
 protected:
 };
 #endif //ACTIVATION_FUNCTION_H
\ No newline at end of file
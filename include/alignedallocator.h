@@ -0,0 +1,92 @@
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <vector>
+/**
+ * @file alignedallocator.h
+ * @brief Contains class @ref AlignedAllocator, alias @ref AlignedArray and typedef @ref AlignedVector.
+ */
+ /**
+ * @brief Minimal standard allocator returning memory aligned to \p Alignment bytes.
+ *
+ * The default alignment is a cache line (64 bytes), which is also the width of the
+ * largest vector registers, so buffers allocated with it can be streamed with aligned
+ * loads. The memory is over-allocated with std::malloc and the original pointer is
+ * stored just before the aligned block, which keeps the allocator portable.
+ */
+template<typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    /**
+    * @brief Rebinding helper, required by the containers.
+    */
+    template<typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+    /**
+    * @brief Constructor (no members to initialise).
+    */
+    AlignedAllocator(){}
+    /**
+    * @brief Converting constructor, required by the containers.
+    */
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&){}
+    /**
+    * @brief Allocates aligned memory for \p n objects of type T.
+    *
+    * @param n Number of objects.
+    * @return Pointer to the first object, aligned to \p Alignment bytes.
+    */
+    T* allocate(std::size_t n)
+    {
+        void* raw = std::malloc(n * sizeof(T) + Alignment + sizeof(void*));
+        if(raw == NULL)
+        {
+            throw std::bad_alloc();
+        }
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        std::uintptr_t aligned = (start + Alignment - 1) & ~static_cast<std::uintptr_t>(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+    /**
+    * @brief Releases memory obtained from @ref allocate.
+    *
+    * @param p Pointer returned by @ref allocate.
+    */
+    void deallocate(T* p, std::size_t)
+    {
+        if(p != NULL)
+        {
+            std::free(reinterpret_cast<void**>(p)[-1]);
+        }
+    }
+};
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return true;}
+
+template<typename T, typename U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) {return false;}
+
+/**
+* @brief std::vector of \p T whose storage starts on a cache line boundary.
+*/
+template<typename T>
+using AlignedArray = std::vector<T, AlignedAllocator<T> >;
+
+/**
+* @brief std::vector of doubles whose storage starts on a cache line boundary.
+*/
+typedef AlignedArray<double> AlignedVector;
+
+#endif // ALIGNED_ALLOCATOR_H
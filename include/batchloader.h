@@ -0,0 +1,176 @@
+#ifndef BATCH_LOADER_H
+#define BATCH_LOADER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "alignedallocator.h"
+#include "patternsmanager.h"
+/**
+ * @file batchloader.h
+ * @brief Contains struct @ref PatternBatch and class @ref BatchLoader.
+ */
+ /**
+ * @brief Matrices of the patterns of a batch, one row per pattern: either rows of the
+ * data in a @ref PatternsManager, when the patterns are consecutive, or copies.
+ */
+struct PatternBatch
+{
+    /**
+    * @brief Inputs of the first pattern.
+    */
+    const double* inputs;
+    /**
+    * @brief Number of values between the inputs of consecutive patterns.
+    */
+    unsigned inputStride;
+    /**
+    * @brief Expected outputs of the first pattern.
+    */
+    const double* targets;
+    /**
+    * @brief Number of values between the outputs of consecutive patterns.
+    */
+    unsigned targetStride;
+    /**
+    * @brief Number of patterns.
+    */
+    unsigned nPatterns;
+};
+
+ /**
+ * @brief Gathers the batches of an epoch on a thread of its own, one batch ahead of
+ * the training.
+ *
+ * The loader has two buffers: while the net trains on the batch in one, the next batch
+ * is copied in the other, so that the copy of shuffled patterns is not on the critical
+ * path. The batches are those of a list of patterns, in order, so that the results are
+ * the same as gathering them on the training thread with @ref gather.
+ */
+class BatchLoader
+{
+public:
+    /**
+    * @brief Constructor starting the thread of the loader.
+    *
+    * @param pm The data.
+    * @param batchCapacity Maximum number of patterns in a batch.
+    */
+    BatchLoader(const PatternsManager& pm, unsigned batchCapacity);
+    /**
+    * @brief Destructor stopping the thread.
+    */
+    ~BatchLoader();
+    /**
+    * @brief Starts gathering the batches of an epoch. The batches of the previous
+    * epoch must have all been taken with @ref next.
+    *
+    * @param patterns Indices of the patterns, in the order of training, unchanged
+    * until the end of the epoch.
+    * @param batchSize Number of patterns in each batch (the last one can be smaller),
+    * at most the capacity.
+    */
+    void start(const std::vector<unsigned>& patterns, unsigned batchSize);
+    /**
+    * @brief Waits for the next batch of the epoch. The batch returned by the previous
+    * call is released, and its buffer reused.
+    *
+    * @param batch The next batch, valid until the following call.
+    * @return false at the end of the epoch.
+    */
+    bool next(PatternBatch& batch);
+    /**
+    * @brief Gathers patterns in a batch: a run of consecutive patterns is used in place,
+    * as a sub-matrix of the data; otherwise the patterns are copied in the buffers with
+    * @ref PatternsManager::copyPattern, which scales them if the data are not (see
+    * @ref PatternsManager::unscaledData). Quantised inputs are always dequantised in the buffers.
+    *
+    * @param pm The data.
+    * @param patterns Indices of the patterns.
+    * @param nPatterns Number of patterns.
+    * @param inputs Buffer of the inputs, with rows of @ref PatternsManager::inputStride values.
+    * @param targets Buffer of the outputs, with rows of @ref PatternsManager::outputStride values.
+    * @param batch The batch.
+    */
+    static void gather(const PatternsManager& pm, const unsigned* patterns, unsigned nPatterns,
+                       AlignedVector& inputs, AlignedVector& targets, PatternBatch& batch);
+private:
+    /**
+    * @brief Buffers and batch of one of the two slots.
+    */
+    struct Slot
+    {
+        /**
+        * @brief Buffer of the inputs.
+        */
+        AlignedVector inputs;
+        /**
+        * @brief Buffer of the outputs.
+        */
+        AlignedVector targets;
+        /**
+        * @brief The batch, gathered by the thread of the loader.
+        */
+        PatternBatch batch;
+        /**
+        * @brief Whether the batch is ready (or being trained on).
+        */
+        bool full;
+    };
+    /**
+    * @brief The data.
+    */
+    const PatternsManager& m_pm;
+    /**
+    * @brief The two slots, used in turn.
+    */
+    Slot m_slots[2];
+    /**
+    * @brief Patterns of the current epoch, NULL between epochs.
+    */
+    const std::vector<unsigned>* m_patterns;
+    /**
+    * @brief Number of patterns in each batch of the current epoch.
+    */
+    unsigned m_batchSize;
+    /**
+    * @brief Number of batches of the current epoch.
+    */
+    unsigned m_nBatches;
+    /**
+    * @brief Number of batches gathered by the loader in the current epoch.
+    */
+    unsigned m_nGathered;
+    /**
+    * @brief Number of batches returned by @ref next in the current epoch.
+    */
+    unsigned m_nTaken;
+    /**
+    * @brief Set to stop the thread.
+    */
+    bool m_stop;
+    /**
+    * @brief Protects the state of the slots and of the epoch.
+    */
+    std::mutex m_mutex;
+    /**
+    * @brief Signals the thread of the loader that a slot is free or an epoch has started.
+    */
+    std::condition_variable m_slotFree;
+    /**
+    * @brief Signals @ref next that a batch is ready.
+    */
+    std::condition_variable m_batchReady;
+    /**
+    * @brief Thread of the loader, started last.
+    */
+    std::thread m_thread;
+    /**
+    * @brief Function run by the thread of the loader.
+    */
+    void loaderLoop();
+    BatchLoader(const BatchLoader&);
+    BatchLoader& operator=(const BatchLoader&);
+};
+#endif // BATCH_LOADER_H
@@ -0,0 +1,71 @@
+#ifndef BATCH_SCORER_H
+#define BATCH_SCORER_H
+
+#include <string>
+#include <vector>
+#include "inferenceengine.h"
+/**
+ * @file batchscorer.h
+ * @brief Contains class @ref BatchScorer.
+ */
+class ThreadPool;
+
+ /**
+ * @brief Computes the outputs of a trained net for every row of a data file holding
+ * only inputs, and writes them to a text file, one line per row, in the order of the rows.
+ *
+ * The input file (in the format of @ref PatternReader, with as many columns as inputs of
+ * the net) is read by a @ref ParallelPatternReader in chunks of a few ranges per thread,
+ * so that the memory used does not depend on the size of the file. Each chunk is parsed in
+ * parallel, split in one slice of rows per thread, whose outputs are computed in batches
+ * and formatted by the thread, and the slices are written in order before the next chunk
+ * is read.
+ */
+class BatchScorer
+{
+public:
+    /**
+    * @brief Constructor.
+    *
+    * @param engine The trained net.
+    * @param pool Threads sharing the parsing, the forward passes and the formatting.
+    * @param batchSize Number of patterns propagated at once by each thread.
+    */
+    BatchScorer(const InferenceEngine& engine, ThreadPool& pool, unsigned batchSize);
+    /**
+    * @brief Scores all the rows of a file.
+    *
+    * @param inputFileName Name of the file of inputs.
+    * @param outputFileName Name of the file of outputs, overwritten.
+    * @return Number of rows scored.
+    */
+    unsigned long long score(const std::string& inputFileName, const std::string& outputFileName);
+private:
+    /**
+    * @brief The trained net.
+    */
+    const InferenceEngine& m_engine;
+    /**
+    * @brief Threads sharing the work.
+    */
+    ThreadPool& m_pool;
+    /**
+    * @brief One workspace per slice of a chunk.
+    */
+    std::vector<InferenceWorkspace> m_workspaces;
+    /**
+    * @brief Inputs of the chunk, one padded row per pattern.
+    */
+    AlignedVector m_inputs;
+    /**
+    * @brief Outputs of the chunk, one row per pattern.
+    */
+    std::vector<double> m_outputs;
+    /**
+    * @brief Text of the outputs of each slice of the chunk.
+    */
+    std::vector<std::string> m_text;
+    BatchScorer(const BatchScorer&);
+    BatchScorer& operator=(const BatchScorer&);
+};
+#endif // BATCH_SCORER_H
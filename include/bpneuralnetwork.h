@@ -3,9 +3,17 @@
 
 #include <vector>
 #include <utility>
+#include <string>
+#include <sstream>
+#include <random>
 #include "patternsmanager.h"
 #include "inputreader.h"
-#include "activationfunction.h"
+#include "networkengine.h"
+#include "alignedallocator.h"
+#include "threadpool.h"
+#include "batchloader.h"
+#include "foldpartition.h"
+#include "inferenceengine.h"
 
 /**
  * @file bpneuralnetwork.h
@@ -23,37 +31,25 @@
  * it includes input and output tasks. It is meant as a solution 
  * for the MESIIA exercise of Activity 1, and not as a optimal solution
  * to use for real applications.
+ * The parameters and the data are only read, so that several nets
+ * (e.g. one per cross-validation fold) can share them and run in 
+ * parallel. The text each net would write to the output file is 
+ * collected in memory, see @ref report.
  */
 class BPNeuralNetwork
 {
-    /**
-     * @brief Private Structure which holds information defining a "Neuron"
-     * 
-     * Each Neuron hold its output, obtained by applying the activation function
-     * to the weighted sum, the derivative of the activation function computed
-     * with the same argument, a vector of weights for each of the inputs,
-     * the difference to apply to each weight after update, the previous value
-     * of such weights, the eventual threshold (bias) and the delta computed
-     * during backpropagation.
-     */
-    typedef struct
-    { 
-        double output; 
-        double derOutput; 
-        std::vector<double> weights; 
-        std::vector<double> deltaWeights;
-        std::vector<double> oldDeltaWeights;
-        double threshold;
-        double deltaThreshold;
-        double oldDeltaThreshold;
-        double delta;
-    } Neuron;
 public:
     /**
-    * @brief Constructor reads the parameters file "Input.txt",
-    * reads the data and initialises the net.
+    * @brief Constructor initialising the net with its own random
+    * number generator.
+    *
+    * @param ir Parameters of the net, read from "Input.txt".
+    * @param pm Data, already read and scaled.
+    * @param folds Folds of the cross-validation.
+    * @param pool Threads used to train in BATCH and ASYNCHRONOUS mode.
+    * @param seed Seed of the random number generator of this net.
     */
-    BPNeuralNetwork();
+    BPNeuralNetwork(const InputReader& ir, const PatternsManager& pm, const FoldPartition& folds, ThreadPool& pool, unsigned seed);
     /**
     * @brief Destructor cleaning the dynamic allocated memory.
     */
@@ -61,8 +57,8 @@ public:
     /**
     * @brief A call to this function will train the net on the 
     * selected data.
-    * @param excluded Every \p excluded pattern is <b>not</b> used 
-    * for training.
+    * @param excluded The patterns of fold \p excluded (see @ref FoldPartition)
+    * are <b>not</b> used for training.
     */
     void train(unsigned excluded);
     /**
@@ -79,106 +75,294 @@ public:
     */
     void crossvalidate(unsigned included);
     /**
+    * @brief Folds the scaling of the data into the trained net (see
+    * @ref NetworkEngine::foldScaling), so that it can be used on unscaled data, and
+    * prints the new weights to output. To be called after @ref test and @ref crossvalidate,
+    * which use scaled data.
+    */
+    void foldScaling();
+    /**
+    * @brief Writes the trained net, with the scaling of the data, to a binary model file
+    * (see @ref ModelFile). To be called before @ref foldScaling.
+    *
+    * @param fileName Name of the model file.
+    */
+    void saveModel(const std::string& fileName) const;
+    /**
+    * @brief Creates a frozen copy of the trained net, which can be shared by threads
+    * computing outputs (see @ref InferenceEngine). To be called before @ref foldScaling.
+    *
+    * @return Pointer to the engine, owned by the caller.
+    */
+    InferenceEngine* inferenceEngine() const;
+    /**
     * @brief Allows access to the parameter file reader.
     *
     * @return Constant reference to the parameter @ref InputReader class.
     */
     const InputReader& ir() const {return m_ir;}
+    /**
+    * @brief Text written by @ref train, @ref test and @ref crossvalidate
+    * for the output file.
+    *
+    * @return The text, in the order it was written.
+    */
+    std::string report() const {return m_report.str();}
+    /**
+    * @brief Outputs and expected outputs of the last call to @ref test,
+    * one per line, for scatter plots.
+    *
+    * @return The text for the file "Results.txt".
+    */
+    std::string testResults() const {return m_testResults.str();}
+    /**
+    * @brief Prints the parameters used and the statistics of the data,
+    * the header of the output file.
+    *
+    * @param os Stream where to print.
+    * @param ir Parameters of the nets.
+    * @param pm Data used.
+    */
+    static void printHeader(std::ostream& os, const InputReader& ir, const PatternsManager& pm);
 private:
     /**
     * @brief Object of @ref InputReader class containing all the parameters
     * defined in "Input.txt".
     */
-    InputReader m_ir;
+    const InputReader& m_ir;
     /**
     * @brief Object of @ref PatternsManager class containig the training data.
     */
-    PatternsManager m_pm;
+    const PatternsManager& m_pm;
     /**
-    * @brief Pointer to @ref ActivationFunction used for the hidden layers.
+    * @brief Folds of the cross-validation, shared by the nets.
     */
-    ActivationFunction* m_hFunction;
+    const FoldPartition& m_folds;
     /**
-    * @brief Pointer to @ref ActivationFunction used for the output layers.
+    * @brief Threads sharing the training patterns in BATCH and ASYNCHRONOUS mode.
     */
-    ActivationFunction* m_oFunction;
-     /**
-    * @brief The actual net, defined as a vector containing layers, which are defined as
-    * vectors of nodes, which are of type @ref Neuron.
+    ThreadPool& m_pool;
+    /**
+    * @brief Random number generator of this net.
     */
-    std::vector<std::vector<Neuron> > m_net;
+    std::mt19937 m_generator;
     /**
-    * @brief Last layer (output) of the net, handled separetely from the rest of the net.
+    * @brief Seed of this net, from which the order of the patterns of each epoch is
+    * drawn when they are shuffled.
     */
-    std::vector<Neuron> m_outputs;
+    unsigned m_seed;
     /**
-    * @brief Initialisation function for the neural network.
+    * @brief The actual net: layers, activation functions and all of the numerical
+    * work, specialised for the requested activation functions (see @ref NetworkEngine).
     */
-    void initialiseNet();
+    NetworkEngine* m_engine;
     /**
-    * @brief Setup the activation function for the hidden layer, as defined in the 
-    * @ref InputReader.
+    * @brief Maximum number of patterns propagated together, the size of the
+    * batch buffers in each @ref LayerWorkspace.
     */
-    void initialiseHiddenFunction();
+    unsigned m_batchCapacity;
     /**
-    * @brief Setup the activation function for the output layer, as defined in the 
-    * @ref InputReader.
+    * @brief Number of shards the training patterns are split in: in BATCH and ASYNCHRONOUS
+    * mode one per thread left free by the folds running in parallel (at least 1), otherwise 1.
+    * Each has its own workspace in @ref m_engine.
     */
-    void initialiseOutFunction();
+    unsigned m_nShards;
     /**
-    * @brief Helper function which defines a single propagation epoch for a single
-    * pattern.
+    * @brief Row stride of @ref m_inputs, as in the data (number of inputs rounded up to a cache line).
+    */
+    unsigned m_inputStride;
+    /**
+    * @brief Row stride of @ref m_targets, as in the data.
+    */
+    unsigned m_targetStride;
+    /**
+    * @brief Input patterns of the current batch of each shard, copied in a matrix
+    * with one row per pattern and @ref m_inputStride entries per row.
+    */
+    std::vector<AlignedVector> m_inputs;
+    /**
+    * @brief Expected outputs of the current batch of each shard, one row per pattern
+    * and @ref m_targetStride entries per row.
+    */
+    std::vector<AlignedVector> m_targets;
+    /**
+    * @brief Current batch of each shard, set by @ref stage, @ref stagePattern or @ref usePattern.
+    */
+    std::vector<PatternBatch> m_batches;
+    /**
+    * @brief Loader gathering the shuffled mini-batches in the background, NULL if
+    * the batches are gathered when they are trained on (see @ref trainEpoch).
+    */
+    BatchLoader* m_loader;
+    /**
+    * @brief Patterns waiting in the shuffle buffer when the data are streamed, one row
+    * with inputs and outputs per pattern.
+    */
+    std::vector<double> m_shuffleBuffer;
+    /**
+    * @brief Text for the output file, see @ref report.
+    */
+    std::ostringstream m_report;
+    /**
+    * @brief Text for the file "Results.txt", see @ref testResults.
+    */
+    std::ostringstream m_testResults;
+    /**
+    * @brief Helper function training the net for one epoch in ONLINE and MINIBATCH mode:
+    * @ref propagate, @ref backPropagate and @ref update for each batch of patterns in turn.
+    * The batches come from @ref m_loader, if any.
     *
-    * @param nPattern Index of the considered pattern.
+    * @param patterns Indices of the training patterns.
     */
-    void propagate(unsigned nPattern);
+    void trainEpoch(const std::vector<unsigned>& patterns);
     /**
-    * @brief Helper function which defines a single backpropagation epoch for a single
-    * pattern.
+    * @brief Helper function training the net for one epoch in BATCH mode: the patterns
+    * are split in @ref m_nShards shards, processed in parallel, and the deltaWeights of
+    * the shards are summed with a tree reduction before @ref update.
     *
-    * @param nPattern Index of the considered pattern.
+    * @param patterns Indices of the training patterns.
     */
-    void backPropagate(unsigned nPattern);
+    void trainEpochSharded(const std::vector<unsigned>& patterns);
     /**
-    * @brief Helper function which updates the weights of all nodes, using deltas 
-    * computed during @ref backPropagate.
+    * @brief Helper function training the net for one epoch in ASYNCHRONOUS mode: each of
+    * the @ref m_nShards threads trains online on its own patterns, updating the shared
+    * weights after each of them without synchronisation.
+    *
+    * @param patterns Indices of the training patterns.
     */
-    void update();
+    void trainEpochAsynchronous(const std::vector<unsigned>& patterns);
     /**
-    * @brief Helper function which computes the output of intermediate layers, used during  
-    * @ref propagate .
-    * 
-    * @param layer The layer containing the node for which to compute the output.
-    * @param neuroIndex Index of the @ref Neuron in the \p layer. 
-    * @param nPattern Index of the considered pattern.
+    * @brief Helper function training the net for one epoch on the patterns streamed from
+    * the data file, in the order given by the shuffle buffer. All modes train on a single
+    * thread, ASYNCHRONOUS as ONLINE.
+    *
+    * @param excluded See @ref train.
+    */
+    void trainEpochStreamed(unsigned excluded);
+    /**
+    * @brief Helper function computing the energy of the net (half the squared error,
+    * averaged over the patterns), to follow the convergence of the training.
+    *
+    * @param patterns Indices of the training patterns, for data in memory.
+    * @param excluded See @ref train, for streamed data.
+    * @param nTraining Number of training patterns, set by the function.
+    * @return The energy, 0 if there are no training patterns (e.g. with k = 1).
+    */
+    double trainingEnergy(const std::vector<unsigned>& patterns, unsigned excluded, unsigned& nTraining);
+    /**
+    * @brief Helper function computing the energy of the patterns staged in shard 0,
+    * after @ref propagate.
+    *
+    * @param nPatterns Number of patterns staged.
+    * @return The sum of the energies of the patterns.
+    */
+    double stagedEnergy(unsigned nPatterns) const;
+    /**
+    * @brief Whether the data are streamed from the file rather than kept in memory.
+    */
+    bool streaming() const {return m_ir.streamBuffer() > 0;}
+    /**
+    * @brief Patterns selected by @ref streamPatterns.
+    */
+    enum PatternSelection{TRAINING_PATTERNS, VALIDATION_PATTERNS, TEST_PATTERNS};
+    /**
+    * @brief Helper function reading the data file sequentially and calling \p body with
+    * each selected pattern, scaled. Only the shuffle buffer and the file blocks are kept in
+    * memory.
+    *
+    * @param selection Which patterns are passed to \p body.
+    * @param fold Patterns excluded from training, or included in validation, see @ref train.
+    * @param body Function called with the inputs and the outputs of each pattern.
+    * @param shuffle Whether the patterns go through the shuffle buffer, whose random
+    * choices come from the generator of this net.
+    */
+    template<class Body>
+    void streamPatterns(PatternSelection selection, unsigned fold, const Body& body, bool shuffle = true);
+    /**
+    * @brief Helper function setting the patterns of the current batch of a shard, with
+    * @ref BatchLoader::gather and the batch buffers of the shard.
+    *
+    * @param shard Shard whose buffers are filled.
+    * @param patterns Indices of the patterns.
+    * @param nPatterns Number of patterns, at most @ref m_batchCapacity.
+    */
+    void stage(unsigned shard, const unsigned* patterns, unsigned nPatterns);
+    /**
+    * @brief Helper function copying a pattern in a row of the batch buffers of a shard.
+    *
+    * @param shard Shard whose buffers are filled.
+    * @param nRow Row of the batch.
+    * @param inputPattern Inputs of the pattern.
+    * @param output Expected outputs of the pattern.
+    */
+    void stagePattern(unsigned shard, unsigned nRow, const double* inputPattern, const double* output);
+    /**
+    * @brief Helper function making a single pattern the current batch of a shard,
+    * without copying it. The pattern must not change until it has been propagated.
+    *
+    * @param shard Shard whose batch is set.
+    * @param inputPattern Inputs of the pattern.
+    * @param output Expected outputs of the pattern.
+    */
+    void usePattern(unsigned shard, const double* inputPattern, const double* output);
+    /**
+    * @brief Helper function which defines a single propagation epoch for the patterns
+    * staged in a shard, propagated together through each layer.
+    *
+    * @param shard Shard the patterns belong to, and workspace of the engine used.
+    * @param nPatterns Number of patterns staged.
+    */
+    void propagate(unsigned shard, unsigned nPatterns);
+    /**
+    * @brief Helper function which defines a single backpropagation epoch for the patterns
+    * staged in a shard. Must follow a call to @ref propagate with the same patterns.
+    *
+    * @param shard See @ref propagate.
+    * @param nPatterns Number of patterns staged.
     */
-    void computeOutput(unsigned layer, unsigned neuroIndex, unsigned nPattern);
+    void backPropagate(unsigned shard, unsigned nPatterns);
     /**
-    * @brief Helper function printing the parameters used to the output file.
+    * @brief Helper function which updates the weights of all nodes, using deltas 
+    * computed during @ref backPropagate.
+    *
+    * @param shard Shard whose deltas (and momentum) are used.
     */
-    void printHeaderToFile();
+    void update(unsigned shard);
     /**
     * @brief Helper function printing the weights after a complete training to output.
     * 
     * @param excluded See @ref train.
     */
-    void printWeightsToFile(unsigned excluded);
+    void printWeights(unsigned excluded);
+    /**
+    * @brief Helper function printing the weights and thresholds of all layers to output.
+    */
+    void printLayers();
     /** 
     * @brief Helper function printing the results of cross-validation to output.
     *
     * @param included See @ref crossvalidate .
-    * @param results Results obtained from @ref crossvalidate .
-    * @param expectedResults Expected outcome, given in the data.
+    * @param nWrongClass Number of patterns wrongly classified, for each output.
+    * @param nPatterns Number of patterns used for cross-validation.
     */
-    void printCrossValidationResults(unsigned included, const std::vector<std::vector<double> >& results, const std::vector<std::vector<double> >& expectedResults);
+    void printCrossValidationResults(unsigned included, const std::vector<int>& nWrongClass, unsigned nPatterns);
     /** 
     * @brief Helper function printing the results of tests to output. Also prints 
-    * data for scatter plot.
+    * data for scatter plot, see @ref testResults.
     *
     * @param results Results obtained from @ref crossvalidate().
     * @param expectedResults Expected outcome, given in the data.
     */
     void printTestResults(const std::vector<std::vector<double> >& results, const std::vector<std::vector<double> >& expectedResults);
+    /**
+    * @brief Helper function quantising the net to 8 bits (see @ref QuantisedEngine),
+    * calibrated on a sample of the training patterns, and printing to output how the
+    * errors and the outputs on the test patterns change.
+    *
+    * @param testInputs Unscaled inputs of the test patterns, one after the other.
+    * @param expectedResults Scaled expected outputs of the test patterns.
+    */
+    void printQuantisationResults(const std::vector<double>& testInputs, const std::vector<std::vector<double> >& expectedResults);
 };
 
 #endif // BP_NEURALNETWORK_H
@@ -0,0 +1,79 @@
+#ifndef FOLD_PARTITION_H
+#define FOLD_PARTITION_H
+
+#include <vector>
+#include "inputreader.h"
+#include "patternsmanager.h"
+/**
+ * @file foldpartition.h
+ * @brief Contains class @ref FoldPartition.
+ */
+ /**
+ * @brief Assignment of the training patterns (all but the test patterns at the end of
+ * the data) to the k folds of the cross-validation, computed once and shared by the nets.
+ *
+ * By default pattern n belongs to fold n % k. Stratified folds group the patterns by the
+ * value of their outputs, and deal each group in turn among the folds, so that every fold
+ * holds the same share of each class (within one pattern), even if the data are sorted
+ * by class. Stratification needs the outputs, so it is only available for data in memory.
+ */
+class FoldPartition
+{
+public:
+    /**
+    * @brief Constructor assigning the patterns to the folds. Stops the program if
+    * stratified folds are requested for streamed data.
+    *
+    * @param ir Parameters: k, number of test patterns, stratification and streaming.
+    * @param pm Data, in memory unless streamed.
+    */
+    FoldPartition(const InputReader& ir, const PatternsManager& pm);
+    /**
+    * @brief Fold of a training pattern.
+    *
+    * @param nPattern Index of the pattern in the data.
+    * @return Its fold.
+    */
+    unsigned fold(unsigned nPattern) const {return m_foldOf.empty() ? nPattern % m_k : m_foldOf[nPattern];}
+    /**
+    * @brief Patterns of a fold, used for its cross-validation, in the order of the data.
+    * Only for data in memory.
+    *
+    * @param fold The fold.
+    * @return Indices of the patterns.
+    */
+    const std::vector<unsigned>& validationPatterns(unsigned fold) const {return m_folds[fold];}
+    /**
+    * @brief Patterns of all the other folds, used for training, in the order of the data.
+    *
+    * @param excluded The fold excluded.
+    * @return Indices of the patterns.
+    */
+    std::vector<unsigned> trainingPatterns(unsigned excluded) const;
+    /**
+    * @brief Whether the folds are stratified.
+    */
+    bool stratified() const {return m_stratified;}
+private:
+    /**
+    * @brief Number of folds.
+    */
+    unsigned m_k;
+    /**
+    * @brief Number of training patterns.
+    */
+    unsigned m_nTraining;
+    /**
+    * @brief Whether the folds are stratified.
+    */
+    bool m_stratified;
+    /**
+    * @brief Fold of each training pattern, empty for folds n % k.
+    */
+    std::vector<unsigned> m_foldOf;
+    /**
+    * @brief Patterns of each fold, empty for streamed data.
+    */
+    std::vector<std::vector<unsigned> > m_folds;
+};
+#endif // FOLD_PARTITION_H
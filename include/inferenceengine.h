@@ -0,0 +1,256 @@
+#ifndef INFERENCE_ENGINE_H
+#define INFERENCE_ENGINE_H
+
+#include <vector>
+#include <cstdint>
+#include "layer.h"
+/**
+ * @file inferenceengine.h
+ * @brief Contains structs @ref InferenceLayer and @ref InferenceWorkspace, and classes
+ * @ref InferenceEngine and @ref InferenceEngineImpl.
+ */
+class InputReader;
+class NetworkEngine;
+class PatternsManager;
+class ModelFile;
+
+ /**
+ * @brief Weights and thresholds of a layer of a frozen net, in double precision, with
+ * rows padded as in @ref Layer. They are either owned by the engine or mapped from a
+ * model file.
+ */
+struct InferenceLayer
+{
+    /**
+    * @brief Number of nodes of the layer.
+    */
+    unsigned nNodes;
+    /**
+    * @brief Number of inputs of each node.
+    */
+    unsigned nInputs;
+    /**
+    * @brief Number of entries between the weights of consecutive nodes.
+    */
+    unsigned stride;
+    /**
+    * @brief Number of entries between the outputs of consecutive patterns.
+    */
+    unsigned outputStride;
+    /**
+    * @brief Weights, one padded row per node.
+    */
+    const double* weights;
+    /**
+    * @brief Thresholds of the nodes.
+    */
+    const double* thresholds;
+};
+
+ /**
+ * @brief Scratch space of a thread using an @ref InferenceEngine, for batches of up to
+ * @ref batchCapacity patterns. Obtained from @ref InferenceEngine::workspace, and only
+ * valid for the engine which created it.
+ */
+struct InferenceWorkspace
+{
+    /**
+    * @brief Maximum number of patterns propagated at once.
+    */
+    unsigned batchCapacity;
+    /**
+    * @brief Scaled inputs of the batch, in padded rows.
+    */
+    AlignedVector inputs;
+    /**
+    * @brief Outputs of the layers, alternately in each of the two arrays, in padded rows.
+    */
+    AlignedVector outputs[2];
+    /**
+    * @brief Quantised inputs of a layer, for a quantised engine (see @ref QuantisedEngine).
+    */
+    AlignedArray<std::uint8_t> quantised;
+};
+
+ /**
+ * @brief Frozen copy of a trained net, which only computes outputs.
+ *
+ * Unlike @ref NetworkEngine, the engine holds no activations and computes no derivatives:
+ * all the values of a forward pass are kept in an @ref InferenceWorkspace given by the
+ * caller, and @ref predict is const, so that any number of threads can use the same
+ * engine at once, each with its own workspace. The engine takes and gives values in the
+ * units of the data: the inputs are scaled, and the outputs scaled back, as the data the
+ * net was trained on. The computations are those of a @ref NetworkEngine in double
+ * precision, whose outputs are reproduced exactly.
+ */
+class InferenceEngine
+{
+public:
+    /**
+    * @brief Factory creating an engine for the net of a model file, whose weights are
+    * used where they are mapped. The model file must outlive the engine.
+    *
+    * @param model The mapped model file.
+    * @return Pointer to the engine, owned by the caller.
+    */
+    static InferenceEngine* create(const ModelFile& model);
+    /**
+    * @brief Factory creating an engine with a copy of a trained net (converted to double
+    * precision). To be called before the scaling is folded into the net (see
+    * @ref NetworkEngine::foldScaling), as the scaling is taken from the data.
+    *
+    * @param ir Parameters of the net (activation functions).
+    * @param engine The trained net.
+    * @param pm The data the net was trained on, for their scaling.
+    * @return Pointer to the engine, owned by the caller.
+    */
+    static InferenceEngine* create(const InputReader& ir, const NetworkEngine& engine, const PatternsManager& pm);
+    /**
+    * @brief Virtual destructor.
+    */
+    virtual ~InferenceEngine(){}
+    /**
+    * @brief Number of inputs of the net.
+    */
+    unsigned inColumns() const {return m_layers.front().nInputs;}
+    /**
+    * @brief Number of outputs of the net.
+    */
+    unsigned outColumns() const {return m_layers.back().nNodes;}
+    /**
+    * @brief Allocates the scratch space of a thread.
+    *
+    * @param batchCapacity Maximum number of patterns propagated at once.
+    * @return The workspace.
+    */
+    virtual InferenceWorkspace workspace(unsigned batchCapacity) const;
+    /**
+    * @brief Computes the outputs of a set of patterns, propagated in batches of up to
+    * the capacity of the workspace.
+    *
+    * @param inputs Unscaled inputs, one row per pattern.
+    * @param inputStride Number of entries between the inputs of consecutive patterns.
+    * @param nPatterns Number of patterns.
+    * @param outputs Unscaled outputs, one row per pattern, overwritten.
+    * @param outputStride Number of entries between the outputs of consecutive patterns.
+    * @param work Workspace of the calling thread.
+    */
+    void predict(const double* inputs, unsigned inputStride, unsigned nPatterns, double* outputs, unsigned outputStride, InferenceWorkspace& work) const;
+    /**
+    * @brief Applies the activation function of a layer to its weighted sums.
+    *
+    * @param layer Index of the layer.
+    * @param values Weighted sums, overwritten with the outputs.
+    * @param n Number of values.
+    */
+    virtual void activate(unsigned layer, double* values, unsigned n) const = 0;
+protected:
+    /**
+    * @brief Constructor of an engine without layers, filled by the factories.
+    */
+    InferenceEngine(){}
+    /**
+    * @brief Takes the layers and the scaling of another engine, whose weights are used
+    * where they are: the other engine must outlive this one.
+    *
+    * @param source The other engine.
+    */
+    void copyNet(const InferenceEngine& source);
+    /**
+    * @brief The layers, hidden then output.
+    */
+    std::vector<InferenceLayer> m_layers;
+    /**
+    * @brief Weights and thresholds of each layer, when the engine owns them.
+    */
+    std::vector<AlignedVector> m_storage;
+    /**
+    * @brief Value subtracted from each input by the scaling, empty for no scaling.
+    */
+    std::vector<double> m_inOffsets;
+    /**
+    * @brief Value dividing each input by the scaling.
+    */
+    std::vector<double> m_inDivisors;
+    /**
+    * @brief Value subtracted from each output by the scaling.
+    */
+    std::vector<double> m_outOffsets;
+    /**
+    * @brief Value dividing each output by the scaling.
+    */
+    std::vector<double> m_outDivisors;
+    /**
+    * @brief Scales the inputs of a batch, as the data the net was trained on.
+    *
+    * @param inputs Unscaled inputs, one row per pattern.
+    * @param inputStride Number of entries between the inputs of consecutive patterns,
+    * overwritten with that of the scaled inputs.
+    * @param nPatterns Number of patterns, up to the capacity of the workspace.
+    * @param work Workspace holding the scaled inputs.
+    * @return The scaled inputs (\p inputs itself for an unscaled net).
+    */
+    const double* scaleInputs(const double* inputs, unsigned& inputStride, unsigned nPatterns, InferenceWorkspace& work) const;
+    /**
+    * @brief Propagates a batch through all the layers.
+    *
+    * @param work Workspace of the calling thread.
+    * @param inputs Scaled inputs of the batch, one row per pattern.
+    * @param inputStride Number of entries between the inputs of consecutive patterns.
+    * @param nPatterns Number of patterns, up to the capacity of the workspace.
+    * @return The outputs of the output layer, in rows of its outputStride entries.
+    */
+    virtual const double* propagate(InferenceWorkspace& work, const double* inputs, unsigned inputStride, unsigned nPatterns) const = 0;
+private:
+    InferenceEngine(const InferenceEngine&);
+    InferenceEngine& operator=(const InferenceEngine&);
+};
+
+ /**
+ * @brief Implementation of @ref InferenceEngine for given activation functions, which
+ * are called without virtual dispatch.
+ */
+template<class Hidden, class Out>
+class InferenceEngineImpl final : public InferenceEngine
+{
+public:
+    /**
+    * @brief Constructor, the layers and the scaling are set by the factories of
+    * @ref InferenceEngine.
+    *
+    * @param hidden Activation function of the hidden layers.
+    * @param out Activation function of the output layer.
+    */
+    InferenceEngineImpl(const Hidden& hidden, const Out& out)
+    : m_hFunction(hidden)
+    , m_oFunction(out){}
+    /**
+    * @brief See @ref InferenceEngine::activate.
+    */
+    void activate(unsigned layer, double* values, unsigned n) const
+    {
+        if(layer + 1 < m_layers.size())
+        {
+            m_hFunction.equation(values, n);
+        }
+        else
+        {
+            m_oFunction.equation(values, n);
+        }
+    }
+protected:
+    /**
+    * @brief See @ref InferenceEngine::propagate.
+    */
+    const double* propagate(InferenceWorkspace& work, const double* inputs, unsigned inputStride, unsigned nPatterns) const;
+private:
+    /**
+    * @brief Activation function of the hidden layers.
+    */
+    Hidden m_hFunction;
+    /**
+    * @brief Activation function of the output layer.
+    */
+    Out m_oFunction;
+};
+#endif // INFERENCE_ENGINE_H
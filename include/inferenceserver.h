@@ -0,0 +1,173 @@
+#ifndef INFERENCE_SERVER_H
+#define INFERENCE_SERVER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "inferenceengine.h"
+/**
+ * @file inferenceserver.h
+ * @brief Contains struct @ref ServerStatistics and class @ref InferenceServer.
+ */
+
+ /**
+ * @brief Counters of an @ref InferenceServer.
+ */
+struct ServerStatistics
+{
+    /**
+    * @brief Number of rows computed.
+    */
+    unsigned long long nRequests;
+    /**
+    * @brief Number of forward passes.
+    */
+    unsigned long long nBatches;
+    /**
+    * @brief Median latency of the last requests, in microseconds.
+    */
+    double p50;
+    /**
+    * @brief 99th percentile of the latency of the last requests, in microseconds.
+    */
+    double p99;
+};
+
+ /**
+ * @brief Long-running server computing the outputs of a trained net for the rows sent by
+ * local clients, on a Unix domain socket or a TCP port of the loopback interface.
+ *
+ * Each client sends rows of inputs, one per line, in the format of the data files, and
+ * receives one line per row with the outputs, in the same order (see README.md for the
+ * protocol). Every connection is served by its own thread, which parses the lines received
+ * and queues one request per row. A single thread gathers the queued requests, of all the
+ * connections, in batches of up to a maximum size, waiting at most a given time after the
+ * oldest one arrived, and computes each batch with one forward pass of the engine. The
+ * latency of a request runs from its arrival in the queue to the end of its forward pass.
+ * The connections beyond a maximum number are refused, and a line longer than a maximum
+ * length is answered with an error and ends its connection.
+ * Only available on POSIX systems.
+ */
+class InferenceServer
+{
+public:
+    /**
+    * @brief Constructor.
+    *
+    * @param engine The trained net.
+    * @param maxBatch Largest number of rows computed at once, at least 1.
+    * @param maxWait Longest time, in microseconds, a request waits for others to join its batch.
+    */
+    InferenceServer(const InferenceEngine& engine, unsigned maxBatch, unsigned maxWait);
+    /**
+    * @brief Destructor closing the socket, if still open.
+    */
+    ~InferenceServer();
+    /**
+    * @brief Opens the socket the clients connect to. Stops the program if the address
+    * cannot be listened on.
+    *
+    * @param address "unix:" followed by the path of the socket, which is replaced if it
+    * exists and removed when the server stops, or the number of a TCP port of 127.0.0.1.
+    */
+    void listen(const std::string& address);
+    /**
+    * @brief Serves the clients of the socket opened by @ref listen until the process
+    * receives SIGINT or SIGTERM, then closes the socket.
+    */
+    void run();
+    /**
+    * @brief Returns the counters, the latencies being those of the last requests.
+    */
+    ServerStatistics statistics();
+private:
+    /**
+    * @brief A row waiting for its outputs, owned by its connection.
+    */
+    struct Request
+    {
+        const double* inputs;
+        double* outputs;
+        std::chrono::steady_clock::time_point arrival;
+        bool done;
+    };
+    /**
+    * @brief The trained net.
+    */
+    const InferenceEngine& m_engine;
+    /**
+    * @brief Largest number of rows computed at once.
+    */
+    unsigned m_maxBatch;
+    /**
+    * @brief Longest wait of a request for a batch.
+    */
+    std::chrono::microseconds m_maxWait;
+    /**
+    * @brief Socket the clients connect to, -1 if not open.
+    */
+    int m_listener;
+    /**
+    * @brief Path of the Unix domain socket, empty for TCP.
+    */
+    std::string m_socketPath;
+    /**
+    * @brief Protects all the following members.
+    */
+    std::mutex m_mutex;
+    /**
+    * @brief Requests waiting for a batch, oldest first.
+    */
+    std::deque<Request*> m_pending;
+    /**
+    * @brief Signalled when a request is queued, or the batching stops.
+    */
+    std::condition_variable m_requestQueued;
+    /**
+    * @brief Signalled when a batch is done.
+    */
+    std::condition_variable m_batchDone;
+    /**
+    * @brief Signalled when a connection is closed.
+    */
+    std::condition_variable m_connectionClosed;
+    /**
+    * @brief Number of connections open.
+    */
+    unsigned m_nConnections;
+    /**
+    * @brief Whether the batching thread has to stop.
+    */
+    bool m_stopBatching;
+    /**
+    * @brief Counters, but the latencies.
+    */
+    ServerStatistics m_statistics;
+    /**
+    * @brief Latencies of the last requests, in microseconds, in a circular buffer.
+    */
+    std::vector<double> m_latencies;
+    /**
+    * @brief Gathers the requests in batches and computes them, until @ref m_stopBatching.
+    */
+    void batchRequests();
+    /**
+    * @brief Answers the rows sent on a connection, until the client closes it or the
+    * server stops, then closes it.
+    *
+    * @param connection Socket of the connection.
+    */
+    void serveConnection(int connection);
+    /**
+    * @brief Queues the requests of a connection and waits for their outputs.
+    *
+    * @param requests The requests.
+    */
+    void compute(std::vector<Request>& requests);
+    InferenceServer(const InferenceServer&);
+    InferenceServer& operator=(const InferenceServer&);
+};
+#endif // INFERENCE_SERVER_H
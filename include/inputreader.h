@@ -7,14 +7,26 @@
 #include <iostream>
 /**
  * @file inputreader.h
- * @brief Contains enum @ref Mode and class @ref InputReader.
+ * @brief Contains enums @ref Mode, @ref Precision and @ref Storage and class @ref InputReader.
  * @author B. M. Manzi
  * @date 20/11/2017
  */
  /**
- * @brief Enumeration used to define batch or online mode of NN.
+ * @brief Enumeration used to define batch, online or mini-batch mode of NN.
+ * ASYNCHRONOUS is online learning in which several threads train on different
+ * patterns at the same time, updating the shared weights without locks.
  */
-enum Mode{BATCH, ONLINE};
+enum Mode{BATCH, ONLINE, MINIBATCH, ASYNCHRONOUS};
+ /**
+ * @brief Enumeration used to define the floating point precision of the net: double,
+ * single, or mixed (single precision with double precision accumulation of the updates).
+ */
+enum Precision{DOUBLE_PRECISION, SINGLE_PRECISION, MIXED_PRECISION};
+ /**
+ * @brief Enumeration used to define how the input patterns are kept in memory: as doubles,
+ * or quantised to 8 or 16 bit integers, with a scale and an offset per column.
+ */
+enum Storage{DOUBLE_STORAGE, UINT8_STORAGE, UINT16_STORAGE};
 /**
 * @brief Class reading the parameters of the neural network from
 * file "Input.txt" (hard coded).
@@ -95,10 +107,16 @@ public:
     /**
     * @brief Getter for the traing mode. See @ref Mode.
     *
-    * @return Learning mode (batch, online).
+    * @return Learning mode (batch, online, minibatch, asynchronous).
     */
     Mode mode() const {return m_mode;}
     /**
+    * @brief Getter for the number of patterns in each mini-batch.
+    *
+    * @return Patterns per weight update in MINIBATCH mode, 1 otherwise.
+    */
+    unsigned batchSize() const {return m_batchSize;}
+    /**
     * @brief Getter for number of patterns used for testing.
     *
     * @return Number of patterns used for testing.
@@ -146,6 +164,81 @@ public:
     * @return std::string of output file name.
     */
     const std::string& outFileName() const {return m_outFileName;}
+    /**
+    * @brief Getter for the floating point precision of the net. See @ref Precision.
+    *
+    * @return Precision (double, float, mixed), double if not given in the file.
+    */
+    Precision precision() const {return m_precision;}
+    /**
+    * @brief Getter for the number of threads running the cross-validation folds.
+    *
+    * @return Number of threads, 0 (the default) for one per hardware thread.
+    */
+    unsigned nThreads() const {return m_nThreads;}
+    /**
+    * @brief Getter for the minimum number of neurons of a layer split across the threads.
+    * Optional entry, 1024 if omitted.
+    *
+    * @return Minimum number of neurons, 0 to never split a layer.
+    */
+    unsigned splitThreshold() const {return m_splitThreshold;}
+    /**
+    * @brief Getter for the size of the shuffle buffer used when the data are streamed
+    * from the file during training. Optional entry, 0 if omitted.
+    *
+    * @return Number of patterns in the shuffle buffer, 0 to keep the data in memory.
+    */
+    unsigned streamBuffer() const {return m_streamBuffer;}
+    /**
+    * @brief Getter for the shuffling of the training patterns at every epoch, in a
+    * different order for each epoch and fold. Optional entry, false if omitted.
+    *
+    * @return Whether the training patterns are shuffled.
+    */
+    bool shuffle() const {return m_shuffle;}
+    /**
+    * @brief Getter for the stratification of the cross-validation folds, each holding
+    * the same share of every output value. Optional entry, false if omitted.
+    *
+    * @return Whether the folds are stratified.
+    */
+    bool stratify() const {return m_stratify;}
+    /**
+    * @brief Getter for the folding of the data scaling into the nets: the data are kept
+    * unscaled, each batch is scaled when it is used, and after training the scaling is
+    * folded into the first and output layers. Optional entry, false if omitted.
+    *
+    * @return Whether the scaling is folded into the nets.
+    */
+    bool foldScaling() const {return m_foldScaling;}
+    /**
+    * @brief Getter for the storage of the input patterns in memory. See @ref Storage.
+    * Optional entry, double if omitted.
+    *
+    * @return Storage (double, uint8, uint16).
+    */
+    Storage storage() const {return m_storage;}
+    /**
+    * @brief Getter for the name of the binary model file written with the net of the last
+    * fold (see @ref ModelFile). Optional entry, "none" (no model file) if omitted.
+    *
+    * @return Name of the model file, or "none".
+    */
+    const std::string& modelFileName() const {return m_modelFileName;}
+    /**
+    * @brief Getter for whether a model file is written.
+    *
+    * @return true unless the name of the model file is "none".
+    */
+    bool saveModel() const {return m_modelFileName != "none";}
+    /**
+    * @brief Getter for whether the nets are also tested after quantisation to 8 bits
+    * (see @ref QuantisedEngine), data in memory only. Optional entry, false if omitted.
+    *
+    * @return Whether the quantised nets are tested.
+    */
+    bool quantise() const {return m_quantise;}
 private:
     /**
     * @brief Holds name of data file.
@@ -192,10 +285,14 @@ private:
     */
     double m_momentum;
      /**
-    * @brief Holds batch or online.
+    * @brief Holds batch, online or minibatch.
     */
     Mode m_mode;
      /**
+    * @brief Holds number of patterns per mini-batch.
+    */
+    unsigned m_batchSize;
+     /**
     * @brief Holds number of patterns used for testing.
     */
     unsigned m_nTestPatterns;
@@ -228,10 +325,60 @@ private:
     */
     std::string m_outFileName;
     /**
+    * @brief Holds double, float or mixed.
+    */
+    Precision m_precision;
+    /**
+    * @brief Holds number of threads.
+    */
+    unsigned m_nThreads;
+    /**
+    * @brief Holds the minimum number of neurons of a layer split across the threads.
+    */
+    unsigned m_splitThreshold;
+    /**
+    * @brief Holds the size of the shuffle buffer for streaming, 0 for data in memory.
+    */
+    unsigned m_streamBuffer;
+    /**
+    * @brief Holds whether the training patterns are shuffled at every epoch.
+    */
+    bool m_shuffle;
+    /**
+    * @brief Holds whether the cross-validation folds are stratified.
+    */
+    bool m_stratify;
+    /**
+    * @brief Holds whether the data scaling is folded into the nets.
+    */
+    bool m_foldScaling;
+    /**
+    * @brief Holds double, uint8 or uint16.
+    */
+    Storage m_storage;
+    /**
+    * @brief Holds the name of the model file, or "none".
+    */
+    std::string m_modelFileName;
+    /**
+    * @brief Holds whether the quantised nets are tested.
+    */
+    bool m_quantise;
+    /**
     * @brief Helper function which actually does all of the work.
     */
     void readFile();
     /**
+    * @brief Helper function reading an optional pair of lines, which parameter files
+    * written for earlier versions do not have.
+    *
+    * @param file The parameter file.
+    * @param commentLine The comment line, as read.
+    * @param line The parameter line, without trailing '\r'.
+    * @return false if the file ends before the pair, in which case the default is used.
+    */
+    bool readOptionalEntry(std::istream& file, std::string& commentLine, std::string& line);
+    /**
     * @brief Helper function which checks input consistency.
     */
     void errorcheck(std::iostream& inStream, const std::string& comment);
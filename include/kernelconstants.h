@@ -0,0 +1,35 @@
+#ifndef KERNEL_CONSTANTS_H
+#define KERNEL_CONSTANTS_H
+/**
+ * @file kernelconstants.h
+ * @brief Contains the constants shared by the vector kernels of all instruction sets.
+ */
+//Constants of the exponential: exp(x) = 2^n exp(r), with n = round(x log2(e)) and
+//r = x - n ln(2) (ln(2) split in two parts for accuracy), and exp(r) from a Pade
+//approximant (Cephes library). The argument is clamped so that 2^n is a normal number.
+const double expLimit = 708.0;
+const double log2e = 1.4426950408889634074;
+const double ln2High = 6.93145751953125e-1;
+const double ln2Low = 1.42860682030941723212e-6;
+const double expP0 = 1.26177193074810590878e-4;
+const double expP1 = 3.02994407707441961300e-2;
+const double expP2 = 9.99999999999999999910e-1;
+const double expQ0 = 3.00198505138664455042e-6;
+const double expQ1 = 2.52448340349684104192e-3;
+const double expQ2 = 2.27265548208155028766e-1;
+const double expQ3 = 2.00000000000000000009e0;
+//Adding this constant rounds a double to an integer, stored in the low bits of the mantissa.
+const double roundingMagic = 6755399441055744.0;
+//Constants of the single precision exponential: same reduction as above, with exp(r) from
+//a polynomial of degree 7 (Cephes expf). The clamp keeps 2^n a normal single precision number.
+const float expLimitFloat = 87.0f;
+const float log2eFloat = 1.44269504088896341f;
+const float ln2HighFloat = 0.693359375f;
+const float ln2LowFloat = -2.12194440e-4f;
+const float expPFloat0 = 1.9875691500e-4f;
+const float expPFloat1 = 1.3981999507e-3f;
+const float expPFloat2 = 8.3334519073e-3f;
+const float expPFloat3 = 4.1665795894e-2f;
+const float expPFloat4 = 1.6666665459e-1f;
+const float expPFloat5 = 5.0000001201e-1f;
+#endif // KERNEL_CONSTANTS_H
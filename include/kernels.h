@@ -0,0 +1,271 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstdint>
+/**
+ * @file kernels.h
+ * @brief Contains struct @ref KernelTable and class @ref Kernels.
+ */
+ /**
+ * @brief Table of function pointers implementing the vector kernels for one instruction set.
+ *
+ * Each instruction set specific translation unit (compiled with its own flags) fills one
+ * table, and @ref Kernels selects the widest one supported by the running CPU.
+ * Every kernel exists in double and single precision; the mixed versions read single
+ * precision values and accumulate them into double precision ones. The integer dot product
+ * of the quantised nets is exact in every version.
+ */
+struct KernelTable
+{
+    const char* name;
+    double (*dot)(const double* x, const double* y, unsigned n);
+    void (*axpy)(double alpha, const double* x, double* y, unsigned n);
+    void (*momentumUpdate)(double* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n);
+    void (*logistic)(double* values, unsigned n, double beta);
+    void (*logisticDerivative)(const double* outputs, double* derivatives, unsigned n, double beta);
+    void (*tanh)(double* values, unsigned n, double beta);
+    void (*tanhDerivative)(const double* outputs, double* derivatives, unsigned n, double beta);
+    float (*dotFloat)(const float* x, const float* y, unsigned n);
+    void (*axpyFloat)(double alpha, const float* x, float* y, unsigned n);
+    void (*momentumUpdateFloat)(float* weights, float* deltaWeights, float* oldDeltaWeights, double momentum, unsigned n);
+    void (*logisticFloat)(float* values, unsigned n, double beta);
+    void (*logisticDerivativeFloat)(const float* outputs, float* derivatives, unsigned n, double beta);
+    void (*tanhFloat)(float* values, unsigned n, double beta);
+    void (*tanhDerivativeFloat)(const float* outputs, float* derivatives, unsigned n, double beta);
+    void (*axpyMixed)(double alpha, const float* x, double* y, unsigned n);
+    void (*momentumUpdateMixed)(float* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n);
+    void (*dequantise8)(const std::uint8_t* values, const double* scales, const double* shifts, double* y, unsigned n);
+    void (*dequantise16)(const std::uint16_t* values, const double* scales, const double* shifts, double* y, unsigned n);
+    void (*multiplyInt8)(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y);
+    void (*quantise8)(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n);
+    unsigned tileColumns;
+    unsigned tileColumnsFloat;
+    void (*multiplyTile)(const double* a, unsigned aRowStride, unsigned aColumnStride, const double* b, unsigned ldb, double* c, unsigned ldc, unsigned k, double alpha, bool accumulate);
+    void (*multiplyTileFloat)(const float* a, unsigned aRowStride, unsigned aColumnStride, const float* b, unsigned ldb, float* c, unsigned ldc, unsigned k, double alpha, bool accumulate);
+};
+
+ /**
+ * @brief Class containing static functions for the innermost vector loops of the network,
+ * dispatched at runtime to the widest instruction set supported by the CPU.
+ *
+ * Portable, SSE2, AVX2 and AVX-512 versions are built into the executable, the latter also
+ * with the VNNI integer dot product; the choice is made from CPUID the first time a kernel is
+ * used. The environment variable <code>NN_KERNELS</code> (portable, sse2, avx2, avx512,
+ * avx512vnni) can restrict the choice, e.g. to
+ * compare results against the portable version, which sums in sequential order.
+ *
+ * Each kernel is overloaded for single precision (and, where a single precision vector is
+ * accumulated into a double precision one, for the mixed case), so that code templated on
+ * the floating point type calls the right version without further dispatch.
+ */
+class Kernels
+{
+public:
+    /**
+    * @brief Dot product of two vectors.
+    *
+    * @param x First vector.
+    * @param y Second vector.
+    * @param n Number of entries.
+    * @return @f$ \sum_i x_i y_i @f$ .
+    */
+    static double dot(const double* x, const double* y, unsigned n) {return table().dot(x, y, n);}
+    /**
+    * @brief Computes @f$ y = y + \alpha x @f$ .
+    *
+    * @param alpha Scaling factor.
+    * @param x Vector to add.
+    * @param y Vector updated.
+    * @param n Number of entries.
+    */
+    static void axpy(double alpha, const double* x, double* y, unsigned n) {table().axpy(alpha, x, y, n);}
+    /**
+    * @brief Fused update with momentum: @f$ w = w + \Delta w + m \Delta w_{old} @f$, then
+    * @f$ \Delta w_{old} = \Delta w @f$ and @f$ \Delta w = 0 @f$ .
+    *
+    * @param weights Weights (or thresholds) to update.
+    * @param deltaWeights Differences computed during backpropagation, reset to zero.
+    * @param oldDeltaWeights Differences of the previous update, overwritten.
+    * @param momentum Momentum.
+    * @param n Number of entries.
+    */
+    static void momentumUpdate(double* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n) {table().momentumUpdate(weights, deltaWeights, oldDeltaWeights, momentum, n);}
+    /**
+    * @brief Logistic function @f$ 1 / (1 + \exp(-2\beta x)) @f$ applied in place.
+    *
+    * The vector versions evaluate the exponential with a polynomial approximation
+    * accurate to a few units in the last place.
+    * @param values Points where to compute the function, overwritten with its values.
+    * @param n Number of entries.
+    * @param beta Parameter of the function.
+    */
+    static void logistic(double* values, unsigned n, double beta) {table().logistic(values, n, beta);}
+    /**
+    * @brief Derivative of the logistic function from its values, @f$ 2\beta f (1 - f) @f$ .
+    *
+    * @param outputs Values of the logistic function.
+    * @param derivatives Values of the derivative.
+    * @param n Number of entries.
+    * @param beta Parameter of the function.
+    */
+    static void logisticDerivative(const double* outputs, double* derivatives, unsigned n, double beta) {table().logisticDerivative(outputs, derivatives, n, beta);}
+    /**
+    * @brief Function @f$ \tanh(\beta x) @f$ applied in place.
+    *
+    * The vector versions compute @f$ 1 - 2 / (\exp(2\beta x) + 1) @f$, with the same
+    * approximation of the exponential as @ref logistic.
+    * @param values Points where to compute the function, overwritten with its values.
+    * @param n Number of entries.
+    * @param beta Parameter of the function.
+    */
+    static void tanh(double* values, unsigned n, double beta) {table().tanh(values, n, beta);}
+    /**
+    * @brief Derivative of the tanh function from its values, @f$ \beta (1 - f^2) @f$ .
+    *
+    * @param outputs Values of the tanh function.
+    * @param derivatives Values of the derivative.
+    * @param n Number of entries.
+    * @param beta Parameter of the function.
+    */
+    static void tanhDerivative(const double* outputs, double* derivatives, unsigned n, double beta) {table().tanhDerivative(outputs, derivatives, n, beta);}
+    /**
+    * @brief Single precision version of @ref dot.
+    */
+    static float dot(const float* x, const float* y, unsigned n) {return table().dotFloat(x, y, n);}
+    /**
+    * @brief Single precision version of @ref axpy (\p alpha is rounded to single precision).
+    */
+    static void axpy(double alpha, const float* x, float* y, unsigned n) {table().axpyFloat(alpha, x, y, n);}
+    /**
+    * @brief Mixed precision version of @ref axpy: single precision \p x added to double precision \p y.
+    */
+    static void axpy(double alpha, const float* x, double* y, unsigned n) {table().axpyMixed(alpha, x, y, n);}
+    /**
+    * @brief Single precision version of @ref momentumUpdate.
+    */
+    static void momentumUpdate(float* weights, float* deltaWeights, float* oldDeltaWeights, double momentum, unsigned n) {table().momentumUpdateFloat(weights, deltaWeights, oldDeltaWeights, momentum, n);}
+    /**
+    * @brief Mixed precision version of @ref momentumUpdate: the update is computed in double
+    * precision from the double precision differences, and rounded once when stored in \p weights.
+    */
+    static void momentumUpdate(float* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n) {table().momentumUpdateMixed(weights, deltaWeights, oldDeltaWeights, momentum, n);}
+    /**
+    * @brief Single precision version of @ref logistic, with a single precision exponential.
+    */
+    static void logistic(float* values, unsigned n, double beta) {table().logisticFloat(values, n, beta);}
+    /**
+    * @brief Single precision version of @ref logisticDerivative.
+    */
+    static void logisticDerivative(const float* outputs, float* derivatives, unsigned n, double beta) {table().logisticDerivativeFloat(outputs, derivatives, n, beta);}
+    /**
+    * @brief Single precision version of @ref tanh, with a single precision exponential.
+    */
+    static void tanh(float* values, unsigned n, double beta) {table().tanhFloat(values, n, beta);}
+    /**
+    * @brief Single precision version of @ref tanhDerivative.
+    */
+    static void tanhDerivative(const float* outputs, float* derivatives, unsigned n, double beta) {table().tanhDerivativeFloat(outputs, derivatives, n, beta);}
+    /**
+    * @brief Converts quantised values to double precision, @f$ y_i = s_i q_i + o_i @f$, with a
+    * scale and an offset per entry.
+    *
+    * @param values Quantised values @f$ q_i @f$.
+    * @param scales Scales @f$ s_i @f$.
+    * @param shifts Offsets @f$ o_i @f$.
+    * @param y Converted values, overwritten.
+    * @param n Number of entries.
+    */
+    static void dequantise(const std::uint8_t* values, const double* scales, const double* shifts, double* y, unsigned n) {table().dequantise8(values, scales, shifts, y, n);}
+    /**
+    * @brief 16 bit version of @ref dequantise.
+    */
+    static void dequantise(const std::uint16_t* values, const double* scales, const double* shifts, double* y, unsigned n) {table().dequantise16(values, scales, shifts, y, n);}
+    /**
+    * @brief Product of a matrix of signed bytes and a vector of unsigned bytes, computed in
+    * 32 bit integers, and converted to double precision with a scale and an offset per row,
+    * @f$ y_r = s_r \sum_i w_{ri} x_i + b_r @f$, as used by the quantised nets.
+    *
+    * @param x Unsigned vector.
+    * @param weights Signed matrix, one row after the other.
+    * @param stride Number of entries between the rows of the matrix.
+    * @param nRows Number of rows.
+    * @param n Number of entries of the vector and of each row, up to 65536.
+    * @param scales Scales @f$ s_r @f$.
+    * @param biases Offsets @f$ b_r @f$.
+    * @param y Results, overwritten.
+    */
+    static void multiply(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y) {table().multiplyInt8(x, weights, stride, nRows, n, scales, biases, y);}
+    /**
+    * @brief Converts values to unsigned bytes, @f$ q_i = \mathrm{round}(x_i / a_i + o_i) @f$,
+    * clamped to [0, 255], with a step and an offset per entry. The inverse of
+    * @ref dequantise, as used by the quantised nets.
+    *
+    * @param x Values @f$ x_i @f$.
+    * @param inverseSteps Inverse steps @f$ 1 / a_i @f$.
+    * @param shifts Offsets @f$ o_i @f$.
+    * @param values Quantised values @f$ q_i @f$, overwritten.
+    * @param n Number of entries.
+    */
+    static void quantise(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n) {table().quantise8(x, inverseSteps, shifts, values, n);}
+    /**
+    * @brief Number of rows of the tiles computed by @ref multiplyTile.
+    */
+    static constexpr unsigned tileRows = 4;
+    /**
+    * @brief Number of columns of the tiles computed by @ref multiplyTile, two vectors of
+    * the instruction set in use.
+    */
+    static unsigned tileColumns() {return table().tileColumns;}
+    /**
+    * @brief Number of columns of the single precision tiles.
+    */
+    static unsigned tileColumnsFloat() {return table().tileColumnsFloat;}
+    /**
+    * @brief Tile of a matrix product, held in registers while it is accumulated: computes
+    * @f$ s_{ij} = \sum_{p<k} a_{ip} b_{pj} @f$, summed in order of p, for the @ref tileRows x
+    * @ref tileColumns entries of the tile, then @f$ c_{ij} = \alpha s_{ij} @f$, or
+    * @f$ c_{ij} = c_{ij} + \alpha s_{ij} @f$ if \p accumulate.
+    *
+    * Each row of B is loaded once for all the rows of the tile, and each entry of A once
+    * for all its columns. Every entry is computed in the same way, whatever its place in
+    * the tile.
+    * @param a Pointer to @f$ a_{00} @f$.
+    * @param aRowStride Distance between @f$ a_{ip} @f$ and @f$ a_{i+1,p} @f$.
+    * @param aColumnStride Distance between @f$ a_{ip} @f$ and @f$ a_{i,p+1} @f$.
+    * @param b Pointer to the first row of B, whose rows hold the columns of the tile contiguously.
+    * @param ldb Leading dimension of B.
+    * @param c Pointer to the tile.
+    * @param ldc Leading dimension of C.
+    * @param k Number of terms of the sums.
+    * @param alpha Scaling factor.
+    * @param accumulate Whether the tile is added to C, rather than overwriting it.
+    */
+    static void multiplyTile(const double* a, unsigned aRowStride, unsigned aColumnStride, const double* b, unsigned ldb, double* c, unsigned ldc, unsigned k, double alpha, bool accumulate) {table().multiplyTile(a, aRowStride, aColumnStride, b, ldb, c, ldc, k, alpha, accumulate);}
+    /**
+    * @brief Single precision version of @ref multiplyTile (\p alpha is rounded to single
+    * precision), with tiles of @ref tileColumnsFloat columns.
+    */
+    static void multiplyTile(const float* a, unsigned aRowStride, unsigned aColumnStride, const float* b, unsigned ldb, float* c, unsigned ldc, unsigned k, double alpha, bool accumulate) {table().multiplyTileFloat(a, aRowStride, aColumnStride, b, ldb, c, ldc, k, alpha, accumulate);}
+    /**
+    * @brief Name of the instruction set in use.
+    *
+    * @return "portable", "sse2", "avx2", "avx512" or "avx512vnni".
+    */
+    static const char* instructionSet() {return table().name;}
+private:
+    /**
+    * @brief Returns the table selected for the running CPU, chosen on the first call.
+    */
+    static const KernelTable& table();
+};
+
+/**
+* @brief Kernel tables of each instruction set, NULL if not built for this architecture
+* (the portable table always exists).
+*/
+const KernelTable* portableKernels();
+const KernelTable* sse2Kernels();
+const KernelTable* avx2Kernels();
+const KernelTable* avx512Kernels();
+const KernelTable* avx512VnniKernels();
+#endif // KERNELS_H
@@ -0,0 +1,73 @@
+#ifndef LAYER_H
+#define LAYER_H
+
+#include "alignedallocator.h"
+/**
+ * @file layer.h
+ * @brief Contains struct templates @ref Layer and @ref LayerWorkspace.
+ */
+ /**
+ * @brief Structure which holds the parameters of a whole layer of "Neurons" in contiguous memory.
+ * 
+ * The weights of the layer are stored as a single row-major matrix, with one row per
+ * neuron and @ref Layer::stride entries per row. The stride is the number of inputs
+ * rounded up to a cache line, so that every row starts on a 64-byte boundary; the padding
+ * entries are always zero. The thresholds (biases) are stored as one entry per neuron.
+ * The values which change while training, including the differences, are in
+ * @ref LayerWorkspace.
+ */
+template<typename Real, typename Accumulator = Real>
+struct Layer
+{
+    unsigned nNodes;
+    unsigned nInputs;
+    unsigned stride;
+    unsigned outputStride;
+    AlignedArray<Real> weights;
+    AlignedArray<Real> thresholds;
+};
+
+ /**
+ * @brief Structure which holds the values computed for a @ref Layer while training on
+ * a batch of patterns.
+ *
+ * The differences to apply to the weights and thresholds at the next update, and those
+ * applied at the previous one (for the momentum term), share the layout of the
+ * corresponding parameters. The differences are stored as \p Accumulator, which is
+ * double in mixed precision, so that many small contributions are not lost when added
+ * to single precision values. The output of each neuron (activation function
+ * applied to the weighted sum), the derivative of the activation function computed with
+ * the same argument and the delta computed during backpropagation are stored for a whole
+ * batch of patterns, as matrices with one row per pattern and @ref Layer::outputStride
+ * entries per row (the number of neurons rounded up to a cache line, i.e. the stride of
+ * the following layer).
+ * Several workspaces can be used with the same layer, so that different threads train
+ * on different patterns, each accumulating its own differences and, when each thread
+ * updates the weights itself, keeping its own momentum.
+ */
+template<typename Real, typename Accumulator = Real>
+struct LayerWorkspace
+{
+    AlignedArray<Accumulator> deltaWeights;
+    AlignedArray<Accumulator> deltaThresholds;
+    AlignedArray<Accumulator> oldDeltaWeights;
+    AlignedArray<Accumulator> oldDeltaThresholds;
+    AlignedArray<Real> outputs;
+    AlignedArray<Real> derOutputs;
+    AlignedArray<Real> deltas;
+};
+
+/**
+* @brief Rounds a number of entries of type \p Real up to a whole number of cache lines
+* (8 doubles or 16 floats).
+*
+* @param n Number of entries.
+* @return Padded number of entries, used as row stride.
+*/
+template<typename Real>
+inline unsigned paddedStride(unsigned n)
+{
+    const unsigned perLine = 64 / sizeof(Real);
+    return (n + perLine - 1) / perLine * perLine;
+}
+#endif // LAYER_H
@@ -0,0 +1,80 @@
+#ifndef LINEAR_ALGEBRA_H
+#define LINEAR_ALGEBRA_H
+/**
+ * @file linearalgebra.h
+ * @brief Contains class @ref LinearAlgebra
+ */
+ /**
+ * @brief Class containing static functions for the matrix products used by the
+ * network when a batch of patterns is propagated at once.
+ *
+ * All matrices are row-major and described by a pointer to the first element and
+ * a leading dimension (the distance, in elements, between two consecutive rows).
+ * From 4 patterns up, the products are computed in tiles of C held in registers while
+ * they are accumulated (see Kernels::multiplyTile), so that each value of the operands
+ * loaded from memory is used for a whole row or column of the tile; smaller batches use
+ * dot products and axpy, which read the operands where they are.
+ * The functions are templates on the floating point types, instantiated in
+ * linearalgebra.cpp for double, float and (for the accumulation) float into double.
+ */
+class LinearAlgebra
+{
+public:
+    /**
+    * @brief Computes @f$ C = A B^T @f$, where \p A is \p m x \p k and \p B is \p n x \p k.
+    *
+    * Used for the forward pass: with \p A the inputs of a batch (one pattern per row)
+    * and \p B the weights of a layer (one neuron per row), \p C holds the weighted sums.
+    * @param a Pointer to \p A.
+    * @param lda Leading dimension of \p A.
+    * @param b Pointer to \p B.
+    * @param ldb Leading dimension of \p B.
+    * @param c Pointer to \p C, overwritten.
+    * @param ldc Leading dimension of \p C.
+    * @param m Rows of \p A and \p C.
+    * @param n Rows of \p B, columns of \p C.
+    * @param k Columns of \p A and \p B.
+    */
+    template<typename Real>
+    static void multiplyTransposed(const Real* a, unsigned lda, const Real* b, unsigned ldb, Real* c, unsigned ldc, unsigned m, unsigned n, unsigned k);
+    /**
+    * @brief Computes @f$ C = A B @f$, where \p A is \p m x \p k and \p B is \p k x \p n.
+    *
+    * Used to propagate the deltas backwards: with \p A the deltas of a batch and \p B
+    * the weights of the following layer, \p C holds the deltas of the current layer
+    * (before multiplication by the derivative of the activation function).
+    * @param a Pointer to \p A.
+    * @param lda Leading dimension of \p A.
+    * @param b Pointer to \p B.
+    * @param ldb Leading dimension of \p B.
+    * @param c Pointer to \p C, overwritten.
+    * @param ldc Leading dimension of \p C.
+    * @param m Rows of \p A and \p C.
+    * @param n Columns of \p B and \p C.
+    * @param k Columns of \p A, rows of \p B.
+    */
+    template<typename Real>
+    static void multiply(const Real* a, unsigned lda, const Real* b, unsigned ldb, Real* c, unsigned ldc, unsigned m, unsigned n, unsigned k);
+    /**
+    * @brief Computes @f$ C = C + \alpha A^T B @f$, where \p A is \p m x \p n and \p B is \p m x \p k.
+    *
+    * Used to accumulate the deltaWeights: with \p A the deltas of a batch and \p B the
+    * inputs of the layer, the contributions of all the patterns are added to \p C.
+    * The contributions of the patterns are summed in order, and the sum added to each entry
+    * of \p C, except in mixed precision and for fewer than 4 patterns, where they are added
+    * one at a time.
+    * @param alpha Scaling factor (learning rate).
+    * @param a Pointer to \p A.
+    * @param lda Leading dimension of \p A.
+    * @param b Pointer to \p B.
+    * @param ldb Leading dimension of \p B.
+    * @param c Pointer to \p C, updated.
+    * @param ldc Leading dimension of \p C.
+    * @param m Rows of \p A and \p B (patterns in the batch).
+    * @param n Columns of \p A, rows of \p C.
+    * @param k Columns of \p B and \p C.
+    */
+    template<typename Real, typename Accumulator>
+    static void accumulateTransposedProduct(double alpha, const Real* a, unsigned lda, const Real* b, unsigned ldb, Accumulator* c, unsigned ldc, unsigned m, unsigned n, unsigned k);
+};
+#endif // LINEAR_ALGEBRA_H
@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include "activationfunction.h"
+#include "kernels.h"
 /**
  * @file logistic.h
  * @brief Contains class @ref Logistic.
@@ -16,9 +17,13 @@
  * This class defines an activation function of the type: 
  * @f[ f(x) = \frac{1}{1+\exp(-2\beta x)} @f]
  */
-class Logistic : public ActivationFunction
+class Logistic final : public ActivationFunction
 {
 public:
+    /**
+    * @brief The derivative is not constant, and has to be computed.
+    */
+    static const bool unitDerivative = false;
     /**
     * @brief Constructor of the logistic activation function.
     *
@@ -40,7 +45,30 @@ public:
     * @param x Point where to compute the derivative of the activation function.
     * @return Value of the derivative of the logistic function at \p x.
     */
-    double firstDerivative(double x) const {return 2.0 * m_beta * equation(x) * (1.0 - equation(x));}
+    double firstDerivative(double x) const {double f = equation(x); return 2.0 * m_beta * f * (1.0 - f);}
+    /**
+    * @brief Computes the logistic function for a whole layer, in place.
+    * 
+    * @param values Points where to compute the function, overwritten with its values.
+    * @param n Number of entries.
+    */
+    void equation(double* values, unsigned n) const {Kernels::logistic(values, n, m_beta);}
+    /**
+    * @brief Computes the derivative @f[ f'(x) = 2\beta f(x) (1-f(x)) @f] for a whole layer.
+    * 
+    * @param outputs Values of the logistic function.
+    * @param derivatives Values of the derivative.
+    * @param n Number of entries.
+    */
+    void firstDerivativeFromOutput(const double* outputs, double* derivatives, unsigned n) const {Kernels::logisticDerivative(outputs, derivatives, n, m_beta);}
+    /**
+    * @brief Single precision version of the logistic function for a whole layer.
+    */
+    void equation(float* values, unsigned n) const {Kernels::logistic(values, n, m_beta);}
+    /**
+    * @brief Single precision version of the derivative for a whole layer.
+    */
+    void firstDerivativeFromOutput(const float* outputs, float* derivatives, unsigned n) const {Kernels::logisticDerivative(outputs, derivatives, n, m_beta);}
 private:
     /**
     * @brief Parameter of logistic function.
@@ -0,0 +1,63 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+/**
+ * @file mappedfile.h
+ * @brief Contains class @ref MappedFile.
+ */
+ /**
+ * @brief Read only view of a whole file, mapped in memory.
+ *
+ * On POSIX systems the file is mapped with mmap, so that opening it costs nothing until
+ * the pages are used, and several processes reading the same file share the page cache.
+ * Elsewhere the file is read into memory. The mapping starts on a page boundary, so data
+ * stored at offsets multiple of 64 bytes in the file are cache line aligned in memory.
+ * A file can also be mapped copy-on-write: it can then be modified in memory, and only
+ * the pages written are copied, the file itself is never changed.
+ */
+class MappedFile
+{
+public:
+    /**
+    * @brief Constructor mapping the file. Stops the program if the file cannot be mapped.
+    *
+    * @param fileName Name of the file.
+    * @param copyOnWrite Whether the mapping can be modified (see @ref mutableData).
+    */
+    explicit MappedFile(const std::string& fileName, bool copyOnWrite = false);
+    /**
+    * @brief Destructor releasing the mapping.
+    */
+    ~MappedFile();
+    /**
+    * @brief First byte of the file.
+    */
+    const char* data() const {return m_data;}
+    /**
+    * @brief First byte of the file, which can be modified if it was mapped copy-on-write.
+    */
+    char* mutableData() {return m_data;}
+    /**
+    * @brief Size of the file in bytes.
+    */
+    std::size_t size() const {return m_size;}
+private:
+    /**
+    * @brief First byte of the file.
+    */
+    char* m_data;
+    /**
+    * @brief Size of the file in bytes.
+    */
+    std::size_t m_size;
+    /**
+    * @brief Contents of the file, where mmap is not available.
+    */
+    std::vector<double> m_contents;
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+#endif // MAPPED_FILE_H
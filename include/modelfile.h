@@ -0,0 +1,186 @@
+#ifndef MODEL_FILE_H
+#define MODEL_FILE_H
+
+#include <cstdint>
+#include <string>
+#include "mappedfile.h"
+/**
+ * @file modelfile.h
+ * @brief Contains enum @ref Activation, structs @ref ModelFileHeader and @ref ModelLayerHeader
+ * and class @ref ModelFile.
+ */
+class InputReader;
+class NetworkEngine;
+class PatternsManager;
+
+/**
+ * @brief Activation functions, as stored in a model file.
+ */
+enum Activation{TRANSFER_ACTIVATION, LOGISTIC_ACTIVATION, TANH_ACTIVATION};
+
+ /**
+ * @brief Header at the start of a binary model file (64 bytes).
+ *
+ * The header is followed, at @ref layersOffset, by one @ref ModelLayerHeader per layer (the
+ * hidden layers, then the output layer) and, at @ref scalingOffset, by the scaling of the
+ * data: inOffsets and inDivisors, with @ref inColumns doubles each, then outOffsets and
+ * outDivisors, with as many doubles as nodes in the output layer. The scaling is omitted
+ * (and @ref scalingOffset is 0) when the data are not scaled. All values are stored in the
+ * byte order of the machine which wrote the file, checked through @ref byteOrder.
+ */
+struct ModelFileHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t nLayers;
+    std::uint32_t inColumns;
+    std::uint32_t hiddenFunction;
+    std::uint32_t outFunction;
+    double betaHidden;
+    double betaOut;
+    std::uint64_t layersOffset;
+    std::uint64_t scalingOffset;
+};
+
+ /**
+ * @brief Description of a layer in a binary model file (32 bytes).
+ *
+ * The weights are a row-major matrix of doubles, one row of @ref nInputs weights per node,
+ * padded with zeros to @ref stride entries (a multiple of 64 bytes); the thresholds are
+ * @ref nNodes doubles. Both start at offsets multiple of 64 bytes.
+ */
+struct ModelLayerHeader
+{
+    std::uint32_t nNodes;
+    std::uint32_t nInputs;
+    std::uint32_t stride;
+    std::uint32_t reserved;
+    std::uint64_t weightsOffset;
+    std::uint64_t thresholdsOffset;
+};
+
+ /**
+ * @brief Binary file holding a trained net: architecture, activation functions, weights,
+ * thresholds and the scaling of the data it was trained on.
+ *
+ * The net is stored as trained, for scaled inputs and outputs, together with the scaling,
+ * so that raw inputs can be scaled and the outputs brought back to the units of the data.
+ * The file is mapped, and its contents are used where they are, without parsing: the
+ * weights are already in the padded layout used by the engines.
+ */
+class ModelFile
+{
+public:
+    /**
+    * @brief Constructor mapping a model file and checking its header and layers. The
+    * program stops if the file is not a valid model file for this machine.
+    *
+    * @param fileName Name of the model file.
+    */
+    explicit ModelFile(const std::string& fileName);
+    /**
+    * @brief Number of layers, including the output layer.
+    */
+    unsigned nLayers() const {return m_header->nLayers;}
+    /**
+    * @brief Number of inputs of the net.
+    */
+    unsigned inColumns() const {return m_header->inColumns;}
+    /**
+    * @brief Number of outputs of the net.
+    */
+    unsigned outColumns() const {return m_layers[m_header->nLayers - 1].nNodes;}
+    /**
+    * @brief Number of nodes of a layer.
+    */
+    unsigned nNodes(unsigned layer) const {return m_layers[layer].nNodes;}
+    /**
+    * @brief Number of inputs of each node of a layer.
+    */
+    unsigned nInputs(unsigned layer) const {return m_layers[layer].nInputs;}
+    /**
+    * @brief Number of entries between the weights of consecutive nodes of a layer.
+    */
+    unsigned stride(unsigned layer) const {return m_layers[layer].stride;}
+    /**
+    * @brief Weights of a layer, one padded row per node.
+    */
+    const double* weights(unsigned layer) const {return block(m_layers[layer].weightsOffset);}
+    /**
+    * @brief Thresholds of a layer.
+    */
+    const double* thresholds(unsigned layer) const {return block(m_layers[layer].thresholdsOffset);}
+    /**
+    * @brief Activation function of the hidden layers.
+    */
+    Activation hiddenFunction() const {return static_cast<Activation>(m_header->hiddenFunction);}
+    /**
+    * @brief Parameter b of the activation function of the hidden layers.
+    */
+    double betaHidden() const {return m_header->betaHidden;}
+    /**
+    * @brief Activation function of the output layer.
+    */
+    Activation outFunction() const {return static_cast<Activation>(m_header->outFunction);}
+    /**
+    * @brief Parameter b of the activation function of the output layer.
+    */
+    double betaOut() const {return m_header->betaOut;}
+    /**
+    * @brief Whether the net was trained on scaled data.
+    */
+    bool scaled() const {return m_header->scalingOffset != 0;}
+    /**
+    * @brief Value subtracted from each input by the scaling, NULL for no scaling.
+    */
+    const double* inOffsets() const {return scaled() ? block(m_header->scalingOffset) : NULL;}
+    /**
+    * @brief Value dividing each input by the scaling, NULL for no scaling.
+    */
+    const double* inDivisors() const {return scaled() ? inOffsets() + inColumns() : NULL;}
+    /**
+    * @brief Value subtracted from each output by the scaling, NULL for no scaling.
+    */
+    const double* outOffsets() const {return scaled() ? inOffsets() + 2 * inColumns() : NULL;}
+    /**
+    * @brief Value dividing each output by the scaling, NULL for no scaling.
+    */
+    const double* outDivisors() const {return scaled() ? outOffsets() + outColumns() : NULL;}
+    /**
+    * @brief Writes a trained net, with the scaling of the data, to a model file.
+    *
+    * @param fileName Name of the model file.
+    * @param ir Parameters of the net (activation functions).
+    * @param engine The trained net, not folded (see @ref NetworkEngine::foldScaling).
+    * @param pm The data the net was trained on, for their scaling.
+    */
+    static void write(const std::string& fileName, const InputReader& ir, const NetworkEngine& engine, const PatternsManager& pm);
+    /**
+    * @brief Converts the name of an activation function, as in the parameter file.
+    *
+    * @param name Either of "transfer", "logistic", "tanh".
+    * @return The activation function.
+    */
+    static Activation activation(const std::string& name);
+private:
+    /**
+    * @brief The mapped file.
+    */
+    MappedFile m_file;
+    /**
+    * @brief Header of the file.
+    */
+    const ModelFileHeader* m_header;
+    /**
+    * @brief Descriptions of the layers.
+    */
+    const ModelLayerHeader* m_layers;
+    /**
+    * @brief Doubles starting at an offset in the file.
+    */
+    const double* block(std::uint64_t offset) const {return reinterpret_cast<const double*>(m_file.data() + offset);}
+    ModelFile(const ModelFile&);
+    ModelFile& operator=(const ModelFile&);
+};
+#endif // MODEL_FILE_H
@@ -0,0 +1,308 @@
+#ifndef NETWORK_ENGINE_H
+#define NETWORK_ENGINE_H
+
+#include <vector>
+#include <random>
+#include "inputreader.h"
+#include "layer.h"
+#include "threadpool.h"
+/**
+ * @file networkengine.h
+ * @brief Contains classes @ref NetworkEngine and @ref NetworkEngineImpl.
+ */
+ /**
+ * @brief Abstract class holding the layers of the net and doing all of the numerical work
+ * of propagation, backpropagation and update.
+ *
+ * The concrete engines are instances of @ref NetworkEngineImpl, one for each combination of
+ * hidden and output activation functions and floating point precision. @ref create selects
+ * the right one, once, from the @ref InputReader, so that the only virtual calls left are
+ * one per pass. The interface is in double precision whatever the precision of the engine.
+ * Layers are indexed from 0, the last one (index @ref nLayers - 1) being the output layer.
+ *
+ * The values computed while training (see @ref LayerWorkspace) are kept in one or more
+ * workspaces, indexed from 0. Different threads can propagate and backpropagate different
+ * patterns at the same time in different workspaces, each accumulating its own differences,
+ * which are then summed with @ref mergeGradients before @ref update.
+ * Each workspace can also update the weights with its own differences and momentum, while
+ * other workspaces are propagating: the weights are then read and written by several threads
+ * without synchronisation (asynchronous training, see @ref ASYNCHRONOUS).
+ */
+class NetworkEngine
+{
+public:
+    /**
+    * @brief Factory building the engine for the activation functions and precision requested in \p ir,
+    * with weights and thresholds initialised randomly in the requested ranges.
+    *
+    * @param ir Parameters of the net.
+    * @param batchCapacity Maximum number of patterns propagated together.
+    * @param nWorkspaces Number of workspaces.
+    * @param pool Threads sharing the neurons of the layers wider than @ref InputReader::splitThreshold,
+    * or NULL to always use the calling thread.
+    * @param generator Random number generator used for the initial weights and thresholds.
+    * @return Engine allocated with new, owned by the caller.
+    */
+    static NetworkEngine* create(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator);
+    /**
+    * @brief Destructor
+    */
+    virtual ~NetworkEngine(){}
+    /**
+    * @brief Propagates a batch of patterns through the net. In single and mixed precision
+    * the inputs are first converted into a buffer of the engine.
+    *
+    * @param workspace Index of the workspace.
+    * @param inputs Input patterns, one per row, which must not change until the following
+    * call to @ref backPropagate.
+    * @param inputStride Row stride of \p inputs.
+    * @param nPatterns Number of patterns, at most the batch capacity.
+    */
+    virtual void propagate(unsigned workspace, const double* inputs, unsigned inputStride, unsigned nPatterns) = 0;
+    /**
+    * @brief Backpropagates a batch of patterns, adding their contributions to the deltaWeights.
+    * Must follow a call to @ref propagate in the same workspace, whose inputs are used.
+    *
+    * @param workspace Index of the workspace.
+    * @param targets Expected outputs, one row per pattern.
+    * @param targetStride Row stride of \p targets.
+    * @param nPatterns Number of patterns.
+    */
+    virtual void backPropagate(unsigned workspace, const double* targets, unsigned targetStride, unsigned nPatterns) = 0;
+    /**
+    * @brief Adds the deltaWeights accumulated in workspace \p source to those of workspace
+    * \p target, and resets those of \p source. Different pairs of workspaces can be merged
+    * at the same time.
+    *
+    * @param target Index of the workspace receiving the sum.
+    * @param source Index of the workspace added.
+    */
+    virtual void mergeGradients(unsigned target, unsigned source) = 0;
+    /**
+    * @brief Updates weights and thresholds with the deltaWeights accumulated in a workspace
+    * and the momentum term kept in the same workspace, then resets the deltaWeights.
+    *
+    * @param workspace Index of the workspace.
+    */
+    virtual void update(unsigned workspace) = 0;
+    /**
+    * @brief Number of workspaces.
+    */
+    virtual unsigned nWorkspaces() const = 0;
+    /**
+    * @brief Output of the net for one pattern of the last batch propagated in workspace 0.
+    *
+    * @param nRow Index of the pattern in the batch.
+    * @param outIndex Index of the output.
+    * @return The requested output.
+    */
+    virtual double output(unsigned nRow, unsigned outIndex) const = 0;
+    /**
+    * @brief Number of layers, including the output layer.
+    */
+    virtual unsigned nLayers() const = 0;
+    /**
+    * @brief Number of neurons of a layer.
+    *
+    * @param layer Index of the layer.
+    */
+    virtual unsigned nNodes(unsigned layer) const = 0;
+    /**
+    * @brief Number of inputs (weights per neuron) of a layer.
+    *
+    * @param layer Index of the layer.
+    */
+    virtual unsigned nInputs(unsigned layer) const = 0;
+    /**
+    * @brief Read access to a weight.
+    *
+    * @param layer Index of the layer.
+    * @param node Index of the neuron in the layer.
+    * @param input Index of the input of the neuron.
+    * @return The requested weight.
+    */
+    virtual double weight(unsigned layer, unsigned node, unsigned input) const = 0;
+    /**
+    * @brief Read access to a threshold.
+    *
+    * @param layer Index of the layer.
+    * @param node Index of the neuron in the layer.
+    * @return The requested threshold.
+    */
+    virtual double threshold(unsigned layer, unsigned node) const = 0;
+    /**
+    * @brief Folds an affine scaling of the data into the trained net, so that it takes the
+    * unscaled inputs x where it was trained on (x - inOffsets) / inDivisors, and gives the
+    * unscaled outputs y * outDivisors + outOffsets (see @ref output). The input scaling is
+    * absorbed by the weights and thresholds of the first layer; the output scaling follows
+    * the activation function of the output layer, which in general cannot absorb it. The
+    * net must not be trained any further. Empty vectors stand for no scaling.
+    *
+    * @param inOffsets Offset subtracted from each input.
+    * @param inDivisors Divisor of each input.
+    * @param outOffsets Offset subtracted from each output.
+    * @param outDivisors Divisor of each output.
+    */
+    virtual void foldScaling(const std::vector<double>& inOffsets, const std::vector<double>& inDivisors,
+                             const std::vector<double>& outOffsets, const std::vector<double>& outDivisors) = 0;
+};
+
+ /**
+ * @brief Engine specialised at compile time for the activation functions \p Hidden and \p Out,
+ * and for the floating point types of the layers (see @ref Layer).
+ *
+ * The activation functions are held by value, so that their calls are resolved statically
+ * and inlined in the loops over the layers. Activation functions with unit derivative
+ * (@ref TransferActivation) skip the computation and the use of the derivatives altogether.
+ */
+template<class Hidden, class Out, typename Real, typename Accumulator>
+class NetworkEngineImpl : public NetworkEngine
+{
+public:
+    /**
+    * @brief Constructor allocating and initialising the layers.
+    *
+    * @param ir Parameters of the net.
+    * @param batchCapacity Maximum number of patterns propagated together.
+    * @param nWorkspaces Number of workspaces.
+    * @param pool Threads sharing the neurons of the layers wider than @ref InputReader::splitThreshold,
+    * or NULL to always use the calling thread.
+    * @param generator Random number generator used for the initial weights and thresholds.
+    * @param hidden Activation function of the hidden layers.
+    * @param out Activation function of the output layer.
+    */
+    NetworkEngineImpl(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator, const Hidden& hidden, const Out& out);
+    void propagate(unsigned workspace, const double* inputs, unsigned inputStride, unsigned nPatterns);
+    void backPropagate(unsigned workspace, const double* targets, unsigned targetStride, unsigned nPatterns);
+    void mergeGradients(unsigned target, unsigned source);
+    void update(unsigned workspace);
+    unsigned nWorkspaces() const {return m_workspaces.size();}
+    double output(unsigned nRow, unsigned outIndex) const
+    {
+        double value = m_workspaces[0].layers[m_net.size()].outputs[nRow * m_outputs.outputStride + outIndex];
+        return m_outScales.empty() ? value : value * m_outScales[outIndex] + m_outOffsets[outIndex];
+    }
+    unsigned nLayers() const {return m_net.size() + 1;}
+    unsigned nNodes(unsigned layer) const {return layerAt(layer).nNodes;}
+    unsigned nInputs(unsigned layer) const {return layerAt(layer).nInputs;}
+    double weight(unsigned layer, unsigned node, unsigned input) const {return layerAt(layer).weights[node * layerAt(layer).stride + input];}
+    double threshold(unsigned layer, unsigned node) const {return layerAt(layer).thresholds[node];}
+    void foldScaling(const std::vector<double>& inOffsets, const std::vector<double>& inDivisors,
+                     const std::vector<double>& outOffsets, const std::vector<double>& outDivisors);
+private:
+    /**
+    * @brief Layer of the net, in the precision of the engine.
+    */
+    typedef Layer<Real, Accumulator> LayerType;
+    /**
+    * @brief Workspace of a layer, in the precision of the engine.
+    */
+    typedef LayerWorkspace<Real, Accumulator> LayerWorkspaceType;
+    /**
+    * @brief Values computed while training on a batch, for all the layers.
+    */
+    struct Workspace
+    {
+        /**
+        * @brief One per layer, the last one for the output layer.
+        */
+        std::vector<LayerWorkspaceType> layers;
+        /**
+        * @brief Inputs of the current batch converted to \p Real (unused in double precision).
+        */
+        AlignedArray<Real> convertedInputs;
+        /**
+        * @brief Inputs of the last propagated batch, used again by @ref backPropagate.
+        */
+        const Real* batchInputs;
+        /**
+        * @brief Row stride of @ref batchInputs.
+        */
+        unsigned batchInputStride;
+    };
+    /**
+    * @brief Activation function of the hidden layers.
+    */
+    Hidden m_hFunction;
+    /**
+    * @brief Activation function of the output layer.
+    */
+    Out m_oFunction;
+    /**
+    * @brief The hidden layers of the net.
+    */
+    std::vector<LayerType> m_net;
+    /**
+    * @brief Last layer (output) of the net, handled separetely from the rest of the net.
+    */
+    LayerType m_outputs;
+    /**
+    * @brief Learning rate.
+    */
+    double m_learningRate;
+    /**
+    * @brief Momentum.
+    */
+    double m_momentum;
+    /**
+    * @brief The workspaces.
+    */
+    std::vector<Workspace> m_workspaces;
+    /**
+    * @brief Threads sharing the neurons of wide layers, can be NULL.
+    */
+    ThreadPool* m_pool;
+    /**
+    * @brief Minimum number of neurons of a layer split across the threads of @ref m_pool,
+    * 0 to never split.
+    */
+    unsigned m_splitThreshold;
+    /**
+    * @brief Layer access by index, the last one being the output layer.
+    */
+    const LayerType& layerAt(unsigned layer) const {return (layer < m_net.size()) ? m_net[layer] : m_outputs;}
+    /**
+    * @brief Scale of each output after a call to @ref foldScaling, otherwise empty.
+    */
+    std::vector<double> m_outScales;
+    /**
+    * @brief Offset of each output after a call to @ref foldScaling, otherwise empty.
+    */
+    std::vector<double> m_outOffsets;
+    /**
+    * @brief Calls \p body(first, last) on ranges of neurons covering [0, \p nNodes). Layers with
+    * at least @ref m_splitThreshold neurons are split in one range per thread of @ref m_pool,
+    * in multiples of 16 neurons, and the ranges are processed in parallel; smaller layers
+    * are processed in a single call. Returns when all the ranges are done.
+    *
+    * @param nNodes Number of neurons of the layer.
+    * @param body Function taking the first and one past the last neuron of a range.
+    */
+    template<class Body>
+    void forNodeRanges(unsigned nNodes, const Body& body);
+    /**
+    * @brief Computes the outputs (and derivatives) of all the neurons of a layer for a batch.
+    *
+    * @param layer The layer for which to compute the outputs.
+    * @param work The workspace of \p layer.
+    * @param function The activation function of the layer.
+    * @param inputs The inputs of the layer, one row per pattern.
+    * @param inputStride Row stride of \p inputs.
+    * @param nPatterns Number of patterns in the batch.
+    */
+    template<class Function>
+    void computeOutput(const LayerType& layer, LayerWorkspaceType& work, const Function& function, const Real* inputs, unsigned inputStride, unsigned nPatterns);
+    /**
+    * @brief Computes the deltas of a hidden layer from the deltas of the following layer.
+    *
+    * @param layer The hidden layer for which to compute the deltas.
+    * @param work The workspace of \p layer.
+    * @param next The layer following \p layer.
+    * @param nextWork The workspace of \p next.
+    * @param nPatterns Number of patterns in the batch.
+    * @param first First neuron of \p layer computed.
+    * @param last One past the last neuron of \p layer computed.
+    */
+    void computeDeltas(const LayerType& layer, LayerWorkspaceType& work, const LayerType& next, const LayerWorkspaceType& nextWork, unsigned nPatterns, unsigned first, unsigned last);
+};
+#endif // NETWORK_ENGINE_H
@@ -0,0 +1,124 @@
+#ifndef PARALLEL_PATTERN_READER_H
+#define PARALLEL_PATTERN_READER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "mappedfile.h"
+/**
+ * @file parallelpatternreader.h
+ * @brief Contains class @ref ParallelPatternReader.
+ */
+class ThreadPool;
+
+ /**
+ * @brief Reads all the rows of a text data file, parsing byte ranges of the file in parallel.
+ *
+ * The file (in the format of @ref PatternReader) is mapped, and the data, after the
+ * comments and empty lines at the start, are split in ranges of a fixed number of bytes,
+ * each moved to the start of a line. The constructor counts the lines of every range in
+ * parallel, so that the index of the first row of each range, and the number of rows, are
+ * known before any value is parsed: the rows can then be parsed in parallel straight into
+ * their place, in the order of the file. The ranges do not depend on the number of threads.
+ * Where mmap is not available the whole file is read into memory first.
+ */
+class ParallelPatternReader
+{
+public:
+    /**
+    * @brief Constructor mapping the file and counting its rows.
+    *
+    * @param fileName Name of the data file.
+    * @param nColumns Number of values on each line.
+    * @param pool Threads sharing the ranges, or NULL to read them on the calling thread.
+    */
+    ParallelPatternReader(const std::string& fileName, unsigned nColumns, ThreadPool* pool);
+    /**
+    * @brief Number of rows of data in the file.
+    */
+    unsigned nRows() const {return m_nRows;}
+    /**
+    * @brief Number of ranges, which can be used to keep partial results per range.
+    */
+    unsigned nRanges() const {return m_rangeStarts.size();}
+    /**
+    * @brief Index of the first row of a range.
+    */
+    unsigned firstRow(unsigned range) const {return m_firstRows[range];}
+    /**
+    * @brief Number of rows of a range.
+    */
+    unsigned rangeRows(unsigned range) const {return m_rangeRows[range];}
+    /**
+    * @brief Parses all the rows, and calls body(range, nRow, values) for each of them,
+    * with the index of its range, its index in the file and its values. Different ranges
+    * are parsed at the same time by different threads, the rows of a range in order.
+    * The first malformed line of the file is reported, as by @ref PatternReader, and the
+    * program stops.
+    *
+    * @param body Function called for each row.
+    */
+    void read(const std::function<void(unsigned, unsigned, const double*)>& body) const;
+    /**
+    * @brief Parses the rows of the ranges [\p firstRange, \p lastRange), as @ref read does
+    * for the whole file, so that a large file can be read in parts of bounded size.
+    *
+    * @param firstRange First range parsed.
+    * @param lastRange One past the last range parsed.
+    * @param body Function called for each row.
+    */
+    void read(unsigned firstRange, unsigned lastRange, const std::function<void(unsigned, unsigned, const double*)>& body) const;
+private:
+    /**
+    * @brief Name of the file, for the error messages.
+    */
+    std::string m_fileName;
+    /**
+    * @brief The mapped file.
+    */
+    MappedFile m_file;
+    /**
+    * @brief Number of values on each line.
+    */
+    unsigned m_nColumns;
+    /**
+    * @brief Threads sharing the ranges, NULL for none.
+    */
+    ThreadPool* m_pool;
+    /**
+    * @brief Number of lines before the data (comments and empty lines).
+    */
+    unsigned m_nHeaderLines;
+    /**
+    * @brief Offset in the file of the first character of each range.
+    */
+    std::vector<std::size_t> m_rangeStarts;
+    /**
+    * @brief Offset in the file one past the last character of each range.
+    */
+    std::vector<std::size_t> m_rangeEnds;
+    /**
+    * @brief Index of the first row of each range.
+    */
+    std::vector<unsigned> m_firstRows;
+    /**
+    * @brief Number of rows of each range (the data end at the first empty line).
+    */
+    std::vector<unsigned> m_rangeRows;
+    /**
+    * @brief Number of rows of data.
+    */
+    unsigned m_nRows;
+    /**
+    * @brief Calls \p body(range) for every range, sharing them among the threads.
+    */
+    void forRanges(const std::function<void(unsigned)>& body) const {forRanges(0, m_rangeStarts.size(), body);}
+    /**
+    * @brief Calls \p body(range) for the ranges [\p firstRange, \p lastRange), sharing them
+    * among the threads.
+    */
+    void forRanges(unsigned firstRange, unsigned lastRange, const std::function<void(unsigned)>& body) const;
+    ParallelPatternReader(const ParallelPatternReader&);
+    ParallelPatternReader& operator=(const ParallelPatternReader&);
+};
+#endif // PARALLEL_PATTERN_READER_H
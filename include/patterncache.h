@@ -0,0 +1,77 @@
+#ifndef PATTERN_CACHE_H
+#define PATTERN_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "mappedfile.h"
+/**
+ * @file patterncache.h
+ * @brief Contains struct @ref PatternCacheHeader and class @ref PatternCache.
+ */
+class PatternsManager;
+
+ /**
+ * @brief Header at the start of a binary pattern file (64 bytes).
+ *
+ * The header is followed, at the given offsets, by the statistics of the data (inMins,
+ * inMaxs, inMeans, inStdDevs, with @ref inColumns doubles each, then outMins, outMaxs,
+ * outMeans, outStdDevs, with @ref outColumns doubles each), the input block and the output
+ * block. The blocks are row-major matrices of doubles, one row per pattern, with rows of
+ * @ref inStride and @ref outStride entries, padded with zeros to a multiple of 64 bytes, and
+ * start at offsets multiple of 64 bytes. All values are stored in the byte order of the
+ * machine which wrote the file, checked through @ref byteOrder.
+ */
+struct PatternCacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t inColumns;
+    std::uint32_t outColumns;
+    std::uint64_t nRows;
+    std::uint32_t inStride;
+    std::uint32_t outStride;
+    std::uint64_t statisticsOffset;
+    std::uint64_t inputsOffset;
+    std::uint64_t outputsOffset;
+};
+
+ /**
+ * @brief Class containing static functions to write and check binary pattern files.
+ *
+ * A binary pattern file holds the data of a text data file already converted, together
+ * with the statistics used for scaling, so that @ref PatternsManager::readFile can map it
+ * instead of parsing it again. It is written with the command
+ * <code>NeuralNetwork convert textFile binaryFile inColumns outColumns</code>.
+ */
+class PatternCache
+{
+public:
+    /**
+    * @brief Checks whether a file is a binary pattern file, from its first bytes.
+    *
+    * @param fileName Name of the file.
+    * @return true if the file starts with the binary signature.
+    */
+    static bool isCache(const std::string& fileName);
+    /**
+    * @brief Checks the header of a mapped binary pattern file, and stops the program
+    * if it is not valid for the requested columns: the strides must be those of the padded
+    * rows, the blocks 64-byte aligned, in the file, and the statistics before the inputs.
+    *
+    * @param file The mapped file.
+    * @param fileName Name of the file, for the error messages.
+    * @param inColumns Expected number of input columns.
+    * @param outColumns Expected number of output columns.
+    * @return The header.
+    */
+    static const PatternCacheHeader& header(const MappedFile& file, const std::string& fileName, unsigned inColumns, unsigned outColumns);
+    /**
+    * @brief Writes data and statistics, as read (and before scaling), to a binary pattern file.
+    *
+    * @param fileName Name of the binary file.
+    * @param pm The data.
+    */
+    static void write(const std::string& fileName, const PatternsManager& pm);
+};
+#endif // PATTERN_CACHE_H
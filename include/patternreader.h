@@ -0,0 +1,113 @@
+#ifndef PATTERN_READER_H
+#define PATTERN_READER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+/**
+ * @file patternreader.h
+ * @brief Contains class @ref PatternReader.
+ */
+ /**
+ * @brief Reads the rows of a text data file, one pattern per line.
+ *
+ * The file is read in large blocks, and the numbers are converted with std::from_chars,
+ * which neither allocates nor depends on the locale. The values of a line can be separated
+ * by spaces, tabs or commas (optionally surrounded by spaces), so that both the format of
+ * <code>data/iris.data</code> and comma-separated files are accepted. Lines starting with
+ * '#' and empty lines before the data are skipped; the data end at the first empty line
+ * or at the end of the file. A line with a wrong number of values, or a value which is not
+ * a number, is reported with its line number, and the program stops.
+ */
+class PatternReader
+{
+public:
+    /**
+    * @brief Constructor opening the file.
+    *
+    * @param fileName Name of the data file.
+    * @param nColumns Number of values on each line.
+    */
+    PatternReader(const std::string& fileName, unsigned nColumns);
+    /**
+    * @brief Destructor closing the file.
+    */
+    ~PatternReader();
+    /**
+    * @brief Reads the next line of data.
+    *
+    * @param values Array of as many values as columns, overwritten.
+    * @return false if there are no more lines of data.
+    */
+    bool readRow(double* values);
+    /**
+    * @brief Number of the last line read, starting from 1.
+    */
+    unsigned lineNumber() const {return m_lineNumber;}
+    /**
+    * @brief Converts the values of a single line.
+    *
+    * @param begin First character of the line.
+    * @param end One past the last character of the line (without the end of line).
+    * @param values Array of \p nColumns values, overwritten.
+    * @param nColumns Number of values expected.
+    * @param error Description of the problem, if any.
+    * @return true if the line holds exactly \p nColumns numbers.
+    */
+    static bool parseLine(const char* begin, const char* end, double* values, unsigned nColumns, std::string& error);
+    /**
+    * @brief Checks whether a line is empty, or only holds spaces and tabs.
+    *
+    * @param begin First character of the line.
+    * @param end One past the last character of the line (without the end of line).
+    */
+    static bool isEmptyLine(const char* begin, const char* end);
+private:
+    /**
+    * @brief Name of the file, for the error messages.
+    */
+    std::string m_fileName;
+    /**
+    * @brief The file, opened in binary mode.
+    */
+    std::FILE* m_file;
+    /**
+    * @brief Number of values on each line.
+    */
+    unsigned m_nColumns;
+    /**
+    * @brief Block of the file being read.
+    */
+    std::vector<char> m_buffer;
+    /**
+    * @brief Position in @ref m_buffer of the first character not read yet.
+    */
+    std::size_t m_position;
+    /**
+    * @brief Number of valid characters in @ref m_buffer.
+    */
+    std::size_t m_size;
+    /**
+    * @brief Number of the last line read.
+    */
+    unsigned m_lineNumber;
+    /**
+    * @brief Whether the first line of data has been read.
+    */
+    bool m_inData;
+    /**
+    * @brief Whether the data have ended.
+    */
+    bool m_finished;
+    /**
+    * @brief Finds the next line, reading a new block of the file if needed.
+    *
+    * @param begin First character of the line.
+    * @param end One past the last character of the line, without '\\r' and '\\n'.
+    * @return false at the end of the file.
+    */
+    bool nextLine(const char*& begin, const char*& end);
+    PatternReader(const PatternReader&);
+    PatternReader& operator=(const PatternReader&);
+};
+#endif // PATTERN_READER_H
@@ -4,6 +4,12 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <cstdint>
+#include "inputreader.h"
+#include "mappedfile.h"
+#include "runningstatistics.h"
+#include "rowview.h"
+#include "alignedallocator.h"
 /**
  * @file patternsmanager.h
  * @brief Contains class @ref PatternsManager.
@@ -11,12 +17,24 @@
  * @author B. M. Manzi
  * @date 20/11/2017
  */
+class ThreadPool;
+
  /**
  * @brief Class managing input data for training and testing.
  *
  * This class defines useful methods for simply access data
  * acquired from a data file and minimal statistica about these
- * data.
+ * data. The input patterns and the outputs are stored as two row-major
+ * matrices, one row per pattern, with rows padded to a multiple of 64 bytes
+ * and 64-byte aligned, so that consecutive patterns can be used as a
+ * sub-matrix without copying them. The matrices of a binary pattern file
+ * are used in place, from its (copy-on-write) mapping.
+ *
+ * The input patterns can instead be quantised (see @ref Storage): each column is kept as
+ * 8 or 16 bit integers spanning its range, from the minimum to the maximum, so that each
+ * value is within half a step (1/510 or 1/131070 of the range) of the value read. Those
+ * inputs are only accessible through @ref dequantiseInputPattern, which already applies
+ * the scaling; the outputs stay in double precision.
  */
 class PatternsManager
 {
@@ -28,15 +46,34 @@ public:
     * to number of entries in a single pattern.
     * @param outputSize Number of columns in the data file relative to 
     * number of entries in the output.
+    * @param pool Threads sharing the statistics and the scaling of the data, if not NULL.
+    * @param storage Storage of the input patterns read by @ref readFile.
+    */
+    PatternsManager(unsigned inputPatternSize, unsigned outputSize, ThreadPool* pool = NULL, Storage storage = DOUBLE_STORAGE);
+    /**
+    * @brief Destructor releasing the mapping of a binary pattern file.
     */
-    PatternsManager(unsigned inputPatternSize, unsigned outputSize);
+    ~PatternsManager();
     /**
-    * @brief Reads the data file.
+    * @brief Reads the data file (see @ref PatternReader for the format) and computes
+    * the statistics of the data. A text file is parsed by the threads, in byte ranges (see
+    * @ref ParallelPatternReader). A binary pattern file (see @ref PatternCache) is
+    * recognised from its first bytes, and its statistics are used as stored. Quantised
+    * inputs need the range of each column before they are stored: a text file is then
+    * parsed twice, first for the statistics.
     * 
     * @param fileName Name of the file containing the data.
     */
     void readFile(const std::string& fileName);
     /**
+    * @brief Computes the statistics of a data file, reading it sequentially without
+    * keeping the patterns in memory, for the data streamed during training (see
+    * @ref PatternStream). The statistics are those of @ref readFile, up to rounding.
+    *
+    * @param fileName Name of the file containing the data.
+    */
+    void readStatistics(const std::string& fileName);
+    /**
     * @brief Getter for the total number of input patterns,
     *
     * @return Number of input patterns read.
@@ -52,16 +89,47 @@ public:
     * @brief Allows reading access to a single input pattern in the data.
     *
     * @param nIn Index of required pattern.
-    * @return Value of pattern \p nIn.
+    * @return View of pattern \p nIn (not valid for quantised inputs).
     */
-    const std::vector<double>& getInputPattern(unsigned nIn) const;
+    RowView getInputPattern(unsigned nIn) const {return RowView(m_inputMatrix + static_cast<std::size_t>(nIn) * m_inputStride, m_inputPatternSize);}
     /**
     * @brief Allows reading access to a single output in the data.
     *
     * @param nOut Index of required output.
-    * @return Value of output \p nOut.
+    * @return View of output \p nOut.
+    */
+    RowView getOutput(unsigned nOut) const {return RowView(m_outputMatrix + static_cast<std::size_t>(nOut) * m_outputStride, m_outputSize);}
+    /**
+    * @brief First input pattern of the data, followed by the others at intervals of
+    * @ref inputStride values, NULL for quantised inputs.
+    */
+    const double* inputMatrix() const {return m_inputMatrix;}
+    /**
+    * @brief Number of values between consecutive input patterns (a multiple of 64 bytes),
+    * also of the batches of dequantised patterns.
+    */
+    unsigned inputStride() const {return m_inputStride;}
+    /**
+    * @brief Whether the input patterns are quantised (see @ref Storage).
+    */
+    bool quantisedInputs() const {return m_storage != DOUBLE_STORAGE;}
+    /**
+    * @brief Writes the values of a quantised input pattern, already scaled as set by
+    * @ref setScaling or @ref scale.
+    *
+    * @param nIn Index of the pattern.
+    * @param inputPattern Array of as many values as entries in a pattern, overwritten.
     */
-    const std::vector<double>& getOutput(unsigned nOut) const;
+    void dequantiseInputPattern(unsigned nIn, double* inputPattern) const;
+    /**
+    * @brief First output of the data, followed by the others at intervals of
+    * @ref outputStride values.
+    */
+    const double* outputMatrix() const {return m_outputMatrix;}
+    /**
+    * @brief Number of values between consecutive outputs (a multiple of 64 bytes).
+    */
+    unsigned outputStride() const {return m_outputStride;}
     /**
     * @brief Returns minimum value for each of the entries in input patterns.
     *
@@ -111,11 +179,65 @@ public:
     */
     const std::vector<double>& outStdDevs() const {return m_outStdDevs;}
     /**
-    * @brief Scales the data according to requested scaling type.
+    * @brief Sets the scaling type, used by @ref scalePattern, without changing the data.
+    *
+    * @param scalingType Either of "none", "normal","mean".
+    */
+    void setScaling(const std::string& scalingType);
+    /**
+    * @brief Scales the data according to requested scaling type, sharing the patterns
+    * among the threads. The type is kept for @ref scalePattern.
     *
     * @param scalingType Either of "none", "normal","mean".
     */
     void scale(const std::string& scalingType);
+    /**
+    * @brief Whether the patterns in memory still have to be scaled with @ref scalePattern
+    * when they are used (a scaling was set with @ref setScaling, and the data were not scaled).
+    * Quantised inputs are always scaled when they are dequantised, and only their outputs
+    * have to be scaled, with @ref scaleOutput.
+    */
+    bool unscaledData() const {return !m_inOffsets.empty() && !m_dataScaled;}
+    /**
+    * @brief Value subtracted from each input by the scaling, empty for no scaling.
+    */
+    const std::vector<double>& inOffsets() const {return m_inOffsets;}
+    /**
+    * @brief Value dividing each input by the scaling, empty for no scaling.
+    */
+    const std::vector<double>& inDivisors() const {return m_inDivisors;}
+    /**
+    * @brief Value subtracted from each output by the scaling, empty for no scaling.
+    */
+    const std::vector<double>& outOffsets() const {return m_outOffsets;}
+    /**
+    * @brief Value dividing each output by the scaling, empty for no scaling.
+    */
+    const std::vector<double>& outDivisors() const {return m_outDivisors;}
+    /**
+    * @brief Scales a single pattern, e.g. read from a @ref PatternStream, as @ref scale
+    * scaled the data.
+    *
+    * @param inputPattern Inputs of the pattern, scaled in place.
+    * @param output Outputs of the pattern, scaled in place.
+    */
+    void scalePattern(double* inputPattern, double* output) const;
+    /**
+    * @brief Copies a pattern of the data into the rows of a batch, in a single pass which
+    * also dequantises the inputs, and scales the values if the data are not scaled (see
+    * @ref unscaledData). The padding of the rows is not written.
+    *
+    * @param nPattern Index of the pattern.
+    * @param inputPattern Inputs of the pattern, overwritten.
+    * @param output Outputs of the pattern, overwritten.
+    */
+    void copyPattern(unsigned nPattern, double* inputPattern, double* output) const;
+    /**
+    * @brief Scales a single output, as @ref scale scaled the data.
+    *
+    * @param output Outputs of the pattern, scaled in place.
+    */
+    void scaleOutput(double* output) const;
 private:
     /**
     * @brief Holder for number of entries in input pattern.
@@ -126,13 +248,91 @@ private:
     */
     unsigned m_outputSize;
     /**
-    * @brief Total number of input patterns read.
+    * @brief Number of patterns in the data, also when they are not kept in memory.
+    */
+    unsigned m_nPatterns;
+    /**
+    * @brief Threads sharing the statistics and the scaling, NULL for none.
+    */
+    ThreadPool* m_pool;
+    /**
+    * @brief Storage of the input patterns.
+    */
+    Storage m_storage;
+    /**
+    * @brief Scaling type set by @ref scale.
+    */
+    std::string m_scalingType;
+    /**
+    * @brief Whether the patterns in memory have been scaled by @ref scale.
     */
-    std::vector<std::vector<double> > m_inputPatterns;
+    bool m_dataScaled;
     /**
-    * @brief Total number of outputs read.
+    * @brief Value subtracted from each entry of the input patterns by the scaling
+    * (minimum or mean), empty for no scaling.
     */
-    std::vector<std::vector<double> > m_outputs;
+    std::vector<double> m_inOffsets;
+    /**
+    * @brief Value dividing each entry of the input patterns by the scaling (range or
+    * standard deviation).
+    */
+    std::vector<double> m_inDivisors;
+    /**
+    * @brief Value subtracted from each entry of the outputs by the scaling.
+    */
+    std::vector<double> m_outOffsets;
+    /**
+    * @brief Value dividing each entry of the outputs by the scaling.
+    */
+    std::vector<double> m_outDivisors;
+    /**
+    * @brief Step between consecutive quantised values of each input column.
+    */
+    std::vector<double> m_quantisationSteps;
+    /**
+    * @brief Scale of each quantised input column, including the scaling of the data.
+    */
+    std::vector<double> m_dequantisationScales;
+    /**
+    * @brief Offset of each quantised input column, including the scaling of the data.
+    */
+    std::vector<double> m_dequantisationShifts;
+    /**
+    * @brief Input patterns quantised to 8 bits, one row of @ref m_inputPatternSize values per pattern.
+    */
+    std::vector<std::uint8_t> m_inputs8;
+    /**
+    * @brief Input patterns quantised to 16 bits, one row of @ref m_inputPatternSize values per pattern.
+    */
+    std::vector<std::uint16_t> m_inputs16;
+    /**
+    * @brief Matrix of the input patterns, in @ref m_inputStorage or in @ref m_mapping.
+    */
+    double* m_inputMatrix;
+    /**
+    * @brief Number of values between consecutive input patterns.
+    */
+    unsigned m_inputStride;
+    /**
+    * @brief Matrix of the outputs, in @ref m_outputStorage or in @ref m_mapping.
+    */
+    double* m_outputMatrix;
+    /**
+    * @brief Number of values between consecutive outputs.
+    */
+    unsigned m_outputStride;
+    /**
+    * @brief Input patterns read from a text file.
+    */
+    AlignedVector m_inputStorage;
+    /**
+    * @brief Outputs read from a text file.
+    */
+    AlignedVector m_outputStorage;
+    /**
+    * @brief Copy-on-write mapping of a binary pattern file, NULL for a text file.
+    */
+    MappedFile* m_mapping;
     /**
     * @brief Vector of minima for each of the entries in input pattern.
     */
@@ -165,6 +365,54 @@ private:
     * @brief Vector of standard deviations for each of the entries in output.
     */
     std::vector<double> m_outStdDevs;
+    /**
+    * @brief Helper function reading patterns and statistics from a binary pattern file.
+    *
+    * @param fileName Name of the binary file.
+    */
+    void readCache(const std::string& fileName);
+    /**
+    * @brief Helper function copying the statistics stored in a binary pattern file.
+    *
+    * @param file The mapped binary file.
+    */
+    void readCacheStatistics(const MappedFile& file);
+    /**
+    * @brief Helper function reading the data with quantised inputs.
+    *
+    * @param fileName Name of the file containing the data.
+    */
+    void readQuantised(const std::string& fileName);
+    /**
+    * @brief Helper function storing the inputs of a pattern in the quantised rows.
+    *
+    * @param nPattern Index of the pattern.
+    * @param inputPattern Inputs of the pattern, as read.
+    */
+    void quantisePattern(unsigned nPattern, const double* inputPattern);
+    /**
+    * @brief Helper function computing the scales and offsets of the dequantisation, from
+    * the quantisation and the scaling.
+    */
+    void setDequantisation();
+    /**
+    * @brief Helper function computing the statistics of the patterns in memory, on
+    * blocks of patterns shared among the threads, and merged in order.
+    */
+    void computeStatistics();
+    /**
+    * @brief Helper function copying accumulated statistics.
+    *
+    * @param inStatistics Statistics of the inputs.
+    * @param outStatistics Statistics of the outputs.
+    */
+    void storeStatistics(const RunningStatistics& inStatistics, const RunningStatistics& outStatistics);
+    /**
+    * @brief Helper function releasing the patterns.
+    */
+    void clearPatterns();
+    PatternsManager(const PatternsManager&);
+    PatternsManager& operator=(const PatternsManager&);
 };
 
 /**
@@ -0,0 +1,69 @@
+#ifndef PATTERN_STREAM_H
+#define PATTERN_STREAM_H
+
+#include <string>
+#include "patternreader.h"
+#include "patterncache.h"
+/**
+ * @file patternstream.h
+ * @brief Contains class @ref PatternStream.
+ */
+ /**
+ * @brief Sequential reader of the patterns of a data file, text or binary (see
+ * @ref PatternCache), which only keeps a bounded part of the file in memory.
+ *
+ * Text files are read in blocks by a @ref PatternReader; binary files are mapped, and
+ * their rows are read in order, so that the pages already read can be dropped by the
+ * system. Each row holds the inputs followed by the outputs of a pattern, as in the file.
+ */
+class PatternStream
+{
+public:
+    /**
+    * @brief Constructor opening the file at its first pattern.
+    *
+    * @param fileName Name of the data file.
+    * @param inColumns Number of input columns.
+    * @param outColumns Number of output columns.
+    */
+    PatternStream(const std::string& fileName, unsigned inColumns, unsigned outColumns);
+    /**
+    * @brief Destructor closing the file.
+    */
+    ~PatternStream();
+    /**
+    * @brief Reads the next pattern.
+    *
+    * @param row Array of \p inColumns + \p outColumns values, overwritten.
+    * @return false if there are no more patterns.
+    */
+    bool readRow(double* row);
+private:
+    /**
+    * @brief Number of input columns.
+    */
+    unsigned m_inColumns;
+    /**
+    * @brief Number of output columns.
+    */
+    unsigned m_outColumns;
+    /**
+    * @brief Reader of a text file, NULL for a binary file.
+    */
+    PatternReader* m_reader;
+    /**
+    * @brief Mapping of a binary file, NULL for a text file.
+    */
+    MappedFile* m_mapping;
+    /**
+    * @brief Header of the binary file.
+    */
+    const PatternCacheHeader* m_header;
+    /**
+    * @brief Index of the next row of the binary file.
+    */
+    unsigned long long m_nextRow;
+    PatternStream(const PatternStream&);
+    PatternStream& operator=(const PatternStream&);
+};
+#endif // PATTERN_STREAM_H
@@ -0,0 +1,108 @@
+#ifndef QUANTISED_ENGINE_H
+#define QUANTISED_ENGINE_H
+
+#include <vector>
+#include <cstdint>
+#include "inferenceengine.h"
+/**
+ * @file quantisedengine.h
+ * @brief Contains struct @ref QuantisedLayer and class @ref QuantisedEngine.
+ */
+
+ /**
+ * @brief A layer of a net quantised to 8 bits.
+ *
+ * Each input @f$ x_c @f$ of the layer is stored as @f$ q_c \in [0, 255] @f$, with
+ * @f$ x_c \approx l_c + a_c q_c @f$, over the range @f$ [l_c, l_c + 255 a_c] @f$ found by
+ * the calibration (see @ref Kernels::quantise, with offsets @f$ -l_c / a_c @f$). The weights, multiplied by the step @f$ a_c @f$ of their input, are
+ * stored as signed bytes with a scale @f$ s_n @f$ per node, so that the weighted sum of
+ * node n is @f$ s_n \sum_c w_{nc} q_c + b_n @f$, where the bias @f$ b_n @f$ holds the
+ * threshold and the weighted sum of the lower ends @f$ l_c @f$.
+ */
+struct QuantisedLayer
+{
+    /**
+    * @brief Number of entries between the weights of consecutive nodes (a multiple of 64).
+    */
+    unsigned stride;
+    /**
+    * @brief Quantised weights, one padded row per node.
+    */
+    AlignedArray<std::int8_t> weights;
+    /**
+    * @brief Scale of the weights of each node, @f$ s_n @f$.
+    */
+    std::vector<double> scales;
+    /**
+    * @brief Bias of each node, @f$ b_n @f$.
+    */
+    std::vector<double> biases;
+    /**
+    * @brief Inverse of the step of each input, @f$ 1 / a_c @f$, 0 for a constant input.
+    */
+    std::vector<double> inverseSteps;
+    /**
+    * @brief Offset of each input, @f$ -l_c / a_c @f$, 0 for a constant input.
+    */
+    std::vector<double> shifts;
+};
+
+ /**
+ * @brief Net of an @ref InferenceEngine, quantised after training to 8 bit weights and
+ * activations.
+ *
+ * The range of the inputs of every layer (each input, or neuron of the previous layer,
+ * with its own range) is calibrated by propagating a sample of patterns through the net
+ * in double precision. The weighted sums are then computed with integer dot products of
+ * bytes (see @ref Kernels::multiply), exact in 32 bits, and converted to double precision for
+ * the thresholds and activation functions, which are those of the original engine. The
+ * weights take an eighth of the memory of the double precision ones.
+ * As for any @ref InferenceEngine, @ref predict is const and can be called by any number
+ * of threads at once, each with its own workspace.
+ */
+class QuantisedEngine final : public InferenceEngine
+{
+public:
+    /**
+    * @brief Constructor quantising the net of an engine, which must outlive this one.
+    *
+    * @param source The double precision engine.
+    * @param sample Unscaled inputs of the calibration patterns, one row per pattern.
+    * @param sampleStride Number of entries between the inputs of consecutive patterns.
+    * @param nSample Number of calibration patterns.
+    */
+    QuantisedEngine(const InferenceEngine& source, const double* sample, unsigned sampleStride, unsigned nSample);
+    /**
+    * @brief See @ref InferenceEngine::workspace.
+    */
+    InferenceWorkspace workspace(unsigned batchCapacity) const;
+    /**
+    * @brief See @ref InferenceEngine::activate.
+    */
+    void activate(unsigned layer, double* values, unsigned n) const {m_source.activate(layer, values, n);}
+protected:
+    /**
+    * @brief See @ref InferenceEngine::propagate.
+    */
+    const double* propagate(InferenceWorkspace& work, const double* inputs, unsigned inputStride, unsigned nPatterns) const;
+private:
+    /**
+    * @brief The double precision engine, for its activation functions.
+    */
+    const InferenceEngine& m_source;
+    /**
+    * @brief The quantised layers, hidden then output.
+    */
+    std::vector<QuantisedLayer> m_quantised;
+    /**
+    * @brief Finds the range of the inputs of every layer over the sample.
+    *
+    * @param sample See the constructor.
+    * @param sampleStride See the constructor.
+    * @param nSample See the constructor.
+    * @param mins Minimum of each input of each layer, overwritten.
+    * @param maxs Maximum of each input of each layer, overwritten.
+    */
+    void calibrate(const double* sample, unsigned sampleStride, unsigned nSample, std::vector<std::vector<double> >& mins, std::vector<std::vector<double> >& maxs) const;
+};
+#endif // QUANTISED_ENGINE_H
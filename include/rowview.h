@@ -0,0 +1,56 @@
+#ifndef ROW_VIEW_H
+#define ROW_VIEW_H
+
+#include <cstddef>
+/**
+ * @file rowview.h
+ * @brief Contains class @ref RowView.
+ */
+ /**
+ * @brief Read only view of a row of a matrix, which does not own its values.
+ *
+ * It can be used as a const std::vector (indexing, iterators and size) but only holds a
+ * pointer and a size, so that returning it by value costs nothing. The view is valid as
+ * long as the matrix it comes from.
+ */
+class RowView
+{
+public:
+    /**
+    * @brief Constructor.
+    *
+    * @param data First value of the row.
+    * @param size Number of values of the row.
+    */
+    RowView(const double* data, unsigned size) : m_data(data), m_size(size) {}
+    /**
+    * @brief Access to a value of the row.
+    */
+    const double& operator[](unsigned index) const {return m_data[index];}
+    /**
+    * @brief First value of the row.
+    */
+    const double* data() const {return m_data;}
+    /**
+    * @brief Number of values of the row.
+    */
+    std::size_t size() const {return m_size;}
+    /**
+    * @brief Iterator to the first value.
+    */
+    const double* begin() const {return m_data;}
+    /**
+    * @brief Iterator past the last value.
+    */
+    const double* end() const {return m_data + m_size;}
+private:
+    /**
+    * @brief First value of the row.
+    */
+    const double* m_data;
+    /**
+    * @brief Number of values of the row.
+    */
+    unsigned m_size;
+};
+#endif // ROW_VIEW_H
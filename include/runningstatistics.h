@@ -0,0 +1,84 @@
+#ifndef RUNNING_STATISTICS_H
+#define RUNNING_STATISTICS_H
+
+#include <vector>
+/**
+ * @file runningstatistics.h
+ * @brief Contains class @ref RunningStatistics.
+ */
+ /**
+ * @brief Minima, maxima, means and standard deviations of the columns of a set of rows,
+ * accumulated in a single pass.
+ *
+ * The means and the sums of squared deviations are updated row by row with Welford's
+ * method, which does not lose precision when the mean is large compared to the spread,
+ * unlike sums of squares. Statistics accumulated separately on parts of the rows (e.g. by
+ * different threads) are combined with @ref merge (Chan et al.), giving the statistics of
+ * all the rows.
+ */
+class RunningStatistics
+{
+public:
+    /**
+    * @brief Constructor for empty statistics.
+    *
+    * @param nColumns Number of columns of the rows.
+    */
+    explicit RunningStatistics(unsigned nColumns = 0);
+    /**
+    * @brief Adds a row.
+    *
+    * @param row Array of as many values as columns.
+    */
+    void add(const double* row);
+    /**
+    * @brief Adds the rows of other statistics, as if they had been added to these.
+    *
+    * @param other Statistics of other rows, with the same number of columns.
+    */
+    void merge(const RunningStatistics& other);
+    /**
+    * @brief Number of rows added.
+    */
+    unsigned long long count() const {return m_count;}
+    /**
+    * @brief Minimum of each column.
+    */
+    const std::vector<double>& mins() const {return m_mins;}
+    /**
+    * @brief Maximum of each column.
+    */
+    const std::vector<double>& maxs() const {return m_maxs;}
+    /**
+    * @brief Mean of each column.
+    */
+    const std::vector<double>& means() const {return m_means;}
+    /**
+    * @brief Computes the (population) standard deviation of each column.
+    *
+    * @return std::vector of standard deviations.
+    */
+    std::vector<double> stdDevs() const;
+private:
+    /**
+    * @brief Number of rows added.
+    */
+    unsigned long long m_count;
+    /**
+    * @brief Minimum of each column.
+    */
+    std::vector<double> m_mins;
+    /**
+    * @brief Maximum of each column.
+    */
+    std::vector<double> m_maxs;
+    /**
+    * @brief Mean of each column.
+    */
+    std::vector<double> m_means;
+    /**
+    * @brief Sum of the squared deviations from the mean of each column.
+    */
+    std::vector<double> m_squaredDeviations;
+};
+#endif // RUNNING_STATISTICS_H
@@ -3,6 +3,7 @@
 
 #include <cmath>
 #include "activationfunction.h"
+#include "kernels.h"
 /**
  * @file tanhfunction.h
  * @brief Contains class @ref TanhFunction.
@@ -16,9 +17,13 @@
  * This class defines an activation function of the type: 
  * @f[ f(x) = \tanh(\beta x) @f]
  */
-class TanhFunction : public ActivationFunction
+class TanhFunction final : public ActivationFunction
 {
 public:
+    /**
+    * @brief The derivative is not constant, and has to be computed.
+    */
+    static const bool unitDerivative = false;
     /**
     * @brief Constructor of the tanh activation function.
     *
@@ -40,7 +45,30 @@ public:
     * @param x Point where to compute the derivative of the activation function.
     * @return Value of the derivative of the tanh function at \p x.
     */
-    double firstDerivative(double x) const {return m_beta * (1.0 - equation(x) * equation(x));}
+    double firstDerivative(double x) const {double f = equation(x); return m_beta * (1.0 - f * f);}
+    /**
+    * @brief Computes the tanh function for a whole layer, in place.
+    * 
+    * @param values Points where to compute the function, overwritten with its values.
+    * @param n Number of entries.
+    */
+    void equation(double* values, unsigned n) const {Kernels::tanh(values, n, m_beta);}
+    /**
+    * @brief Computes the derivative @f[ f'(x) = \beta (1-(f(x))^2) @f] for a whole layer.
+    * 
+    * @param outputs Values of the tanh function.
+    * @param derivatives Values of the derivative.
+    * @param n Number of entries.
+    */
+    void firstDerivativeFromOutput(const double* outputs, double* derivatives, unsigned n) const {Kernels::tanhDerivative(outputs, derivatives, n, m_beta);}
+    /**
+    * @brief Single precision version of the tanh function for a whole layer.
+    */
+    void equation(float* values, unsigned n) const {Kernels::tanh(values, n, m_beta);}
+    /**
+    * @brief Single precision version of the derivative for a whole layer.
+    */
+    void firstDerivativeFromOutput(const float* outputs, float* derivatives, unsigned n) const {Kernels::tanhDerivative(outputs, derivatives, n, m_beta);}
 private:
     /**
     * @brief Parameter of tanh function.
@@ -0,0 +1,101 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+/**
+ * @file threadpool.h
+ * @brief Contains class @ref ThreadPool.
+ */
+ /**
+ * @brief Fixed set of worker threads executing the iterations of parallel loops.
+ *
+ * The only operation is @ref parallelFor: the iterations are handed out one at a time
+ * to the workers and to the calling thread, which takes part in its own loop. Since a
+ * caller can always complete its loop alone, @ref parallelFor can be called from inside
+ * the body of another parallel loop without risk of deadlock: idle workers help with
+ * the inner loop, otherwise the thread that started it runs it serially.
+ */
+class ThreadPool
+{
+public:
+    /**
+    * @brief Constructor starting the workers.
+    *
+    * @param nThreads Number of threads taking part in the loops, including the calling
+    * one. 0 means one per hardware thread.
+    */
+    explicit ThreadPool(unsigned nThreads);
+    /**
+    * @brief Destructor stopping and joining the workers.
+    */
+    ~ThreadPool();
+    /**
+    * @brief Number of threads taking part in the loops, including the calling one.
+    */
+    unsigned nThreads() const {return m_workers.size() + 1;}
+    /**
+    * @brief Calls \p body for every index in [\p begin, \p end), in parallel, and returns
+    * when all the calls have completed. The order of the calls is unspecified.
+    *
+    * @param begin First index.
+    * @param end One past the last index.
+    * @param body Function called with each index.
+    */
+    void parallelFor(unsigned begin, unsigned end, const std::function<void(unsigned)>& body);
+private:
+    /**
+    * @brief A parallel loop in progress. Lives on the stack of @ref parallelFor.
+    */
+    struct Job
+    {
+        const std::function<void(unsigned)>* body;
+        std::atomic<unsigned> next;
+        unsigned end;
+        unsigned nWorkers;
+    };
+    /**
+    * @brief The worker threads.
+    */
+    std::vector<std::thread> m_workers;
+    /**
+    * @brief Loops with iterations possibly left, oldest first.
+    */
+    std::deque<Job*> m_jobs;
+    /**
+    * @brief Protects @ref m_jobs, @ref Job::nWorkers and @ref m_stop.
+    */
+    std::mutex m_mutex;
+    /**
+    * @brief Signalled when a job is queued, or the pool is stopped.
+    */
+    std::condition_variable m_jobAvailable;
+    /**
+    * @brief Signalled when a worker leaves a job.
+    */
+    std::condition_variable m_workerDone;
+    /**
+    * @brief Set by the destructor to stop the workers.
+    */
+    bool m_stop;
+    /**
+    * @brief Main loop of the workers.
+    */
+    void workerLoop();
+    /**
+    * @brief Runs iterations of \p job until none is left.
+    */
+    static void runIterations(Job& job);
+    /**
+    * @brief Removes an exhausted job from the queue, if still there. Requires the lock.
+    */
+    void removeJob(Job* job);
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+};
+#endif // THREAD_POOL_H
@@ -1,6 +1,7 @@
 #ifndef TRANFERACTIVATION_H
 #define TRANFERACTIVATION_H
 
+#include <algorithm>
 #include "activationfunction.h"
 /**
  * @file transferactivation.h
@@ -15,9 +16,13 @@
  * This class defines an activation function of the trivial form: 
  * @f[ f(x) = x @f]
  */
-class TransferActivation : public ActivationFunction
+class TransferActivation final : public ActivationFunction
 {
 public:
+    /**
+    * @brief The derivative is always 1, so it does not need to be computed or applied.
+    */
+    static const bool unitDerivative = true;
     /**
     * @brief Constructor of the transfer activation function.
     */  
@@ -36,7 +41,30 @@ public:
     * @param x Point where to compute the derivative of the activation function.
     * @return Value of the derivative of the transfer function at \p x.
     */
-    double firstDerivative(double x) const {return 1;}
+    double firstDerivative(double /*x*/) const {return 1;}
+    /**
+    * @brief Computes the transfer function for a whole layer: the values are left untouched.
+    * 
+    * @param values Points where to compute the function, which are also its values.
+    * @param n Number of entries.
+    */
+    void equation(double* /*values*/, unsigned /*n*/) const {}
+    /**
+    * @brief Computes the derivative @f[ f'(x) = 1 @f] for a whole layer.
+    * 
+    * @param outputs Values of the transfer function (not needed).
+    * @param derivatives Values of the derivative.
+    * @param n Number of entries.
+    */
+    void firstDerivativeFromOutput(const double* /*outputs*/, double* derivatives, unsigned n) const {std::fill(derivatives, derivatives + n, 1.0);}
+    /**
+    * @brief Single precision version of the transfer function for a whole layer (no-op).
+    */
+    void equation(float* /*values*/, unsigned /*n*/) const {}
+    /**
+    * @brief Single precision version of the derivative for a whole layer.
+    */
+    void firstDerivativeFromOutput(const float* /*outputs*/, float* derivatives, unsigned n) const {std::fill(derivatives, derivatives + n, 1.0f);}
 };
 
 #endif // TRANFERACTIVATION_H
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "../include/batchloader.h"
+#include <algorithm>
+
+BatchLoader::BatchLoader(const PatternsManager& pm, unsigned batchCapacity)
+: m_pm(pm)
+, m_patterns(NULL)
+, m_batchSize(0)
+, m_nBatches(0)
+, m_nGathered(0)
+, m_nTaken(0)
+, m_stop(false)
+{
+    for(unsigned slot = 0; slot < 2; ++slot)
+    {
+        m_slots[slot].inputs.assign(batchCapacity * pm.inputStride(), 0.0);
+        m_slots[slot].targets.assign(batchCapacity * pm.outputStride(), 0.0);
+        m_slots[slot].full = false;
+    }
+    //The thread is started once all members are initialised.
+    m_thread = std::thread(&BatchLoader::loaderLoop, this);
+}
+
+BatchLoader::~BatchLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_slotFree.notify_all();
+    m_thread.join();
+}
+
+void BatchLoader::start(const std::vector<unsigned>& patterns, unsigned batchSize)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_patterns = &patterns;
+        m_batchSize = batchSize;
+        m_nBatches = (patterns.size() + batchSize - 1) / batchSize;
+        m_nGathered = 0;
+        m_nTaken = 0;
+    }
+    m_slotFree.notify_all();
+}
+
+bool BatchLoader::next(PatternBatch& batch)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_nTaken > 0)
+    {
+        m_slots[(m_nTaken - 1) % 2].full = false;
+        m_slotFree.notify_all();
+    }
+    if(m_nTaken == m_nBatches)
+    {
+        m_patterns = NULL;
+        return false;
+    }
+    Slot& slot = m_slots[m_nTaken % 2];
+    m_batchReady.wait(lock, [&slot]{return slot.full;});
+    batch = slot.batch;
+    ++m_nTaken;
+    return true;
+}
+
+void BatchLoader::gather(const PatternsManager& pm, const unsigned* patterns, unsigned nPatterns,
+                         AlignedVector& inputs, AlignedVector& targets, PatternBatch& batch)
+{
+    batch.nPatterns = nPatterns;
+    batch.inputStride = pm.inputStride();
+    batch.targetStride = pm.outputStride();
+    //Consecutive patterns (in increasing order) are already a matrix, in the data, unless
+    //they have to be scaled or dequantised.
+    bool consecutive = !pm.unscaledData() && !pm.quantisedInputs();
+    for(unsigned nRow = 1; nRow < nPatterns && consecutive; ++nRow)
+    {
+        consecutive = (patterns[nRow] == patterns[0] + nRow);
+    }
+    if(consecutive)
+    {
+        batch.inputs = pm.inputMatrix() + static_cast<std::size_t>(patterns[0]) * pm.inputStride();
+        batch.targets = pm.outputMatrix() + static_cast<std::size_t>(patterns[0]) * pm.outputStride();
+        return;
+    }
+    //The rows are copied, scaled or dequantised on the way; their padding stays zero.
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        pm.copyPattern(patterns[nRow], &inputs[nRow * pm.inputStride()], &targets[nRow * pm.outputStride()]);
+    }
+    batch.inputs = &inputs[0];
+    batch.targets = &targets[0];
+}
+
+void BatchLoader::loaderLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        //The next batch is gathered as soon as its slot is free.
+        m_slotFree.wait(lock, [this]
+        {
+            return m_stop || (m_patterns != NULL && m_nGathered < m_nBatches && !m_slots[m_nGathered % 2].full);
+        });
+        if(m_stop)
+        {
+            return;
+        }
+        Slot& slot = m_slots[m_nGathered % 2];
+        unsigned first = m_nGathered * m_batchSize;
+        unsigned nPatterns = std::min<unsigned>(m_batchSize, m_patterns->size() - first);
+        const unsigned* patterns = &(*m_patterns)[first];
+        lock.unlock();
+        gather(m_pm, patterns, nPatterns, slot.inputs, slot.targets, slot.batch);
+        lock.lock();
+        slot.full = true;
+        ++m_nGathered;
+        m_batchReady.notify_one();
+    }
+}
@@ -0,0 +1,102 @@
+#include "../include/batchscorer.h"
+#include "../include/parallelpatternreader.h"
+#include "../include/threadpool.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+namespace
+{
+//Ranges of the file read at once for each thread: each range holds about 4 MB of text.
+const unsigned rangesPerThread = 2;
+//Significant digits of the outputs written.
+const int outputDigits = 15;
+}
+
+BatchScorer::BatchScorer(const InferenceEngine& engine, ThreadPool& pool, unsigned batchSize)
+: m_engine(engine)
+, m_pool(pool)
+{
+    for(unsigned slice = 0; slice < pool.nThreads(); ++slice)
+    {
+        m_workspaces.push_back(engine.workspace(batchSize));
+    }
+    m_text.resize(pool.nThreads());
+}
+
+unsigned long long BatchScorer::score(const std::string& inputFileName, const std::string& outputFileName)
+{
+    unsigned nIn = m_engine.inColumns();
+    unsigned nOut = m_engine.outColumns();
+    unsigned inStride = paddedStride<double>(nIn);
+    unsigned nSlices = m_workspaces.size();
+    ParallelPatternReader reader(inputFileName, nIn, &m_pool);
+    std::ofstream file(outputFileName.c_str());
+    if(!file.is_open())
+    {
+        std::cerr << "Unable to open " << outputFileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    unsigned long long nScored = 0;
+    unsigned chunkRanges = rangesPerThread * nSlices;
+    for(unsigned firstRange = 0; firstRange < reader.nRanges(); firstRange += chunkRanges)
+    {
+        unsigned lastRange = std::min(firstRange + chunkRanges, reader.nRanges());
+        unsigned nRows = 0;
+        for(unsigned range = firstRange; range < lastRange; ++range)
+        {
+            nRows += reader.rangeRows(range);
+        }
+        //The ranges after the end of the data have no rows.
+        if(nRows == 0)
+        {
+            continue;
+        }
+        unsigned firstRow = reader.firstRow(firstRange);
+        if(m_inputs.size() < static_cast<std::size_t>(nRows) * inStride)
+        {
+            m_inputs.resize(static_cast<std::size_t>(nRows) * inStride, 0.0);
+            m_outputs.resize(static_cast<std::size_t>(nRows) * nOut);
+        }
+        reader.read(firstRange, lastRange, [&](unsigned, unsigned nRow, const double* values)
+        {
+            std::copy(values, values + nIn, &m_inputs[static_cast<std::size_t>(nRow - firstRow) * inStride]);
+        });
+        //Each slice of rows is scored and formatted by a single thread, with its own workspace.
+        m_pool.parallelFor(0, nSlices, [&](unsigned slice)
+        {
+            unsigned first = static_cast<unsigned>(static_cast<unsigned long long>(nRows) * slice / nSlices);
+            unsigned last = static_cast<unsigned>(static_cast<unsigned long long>(nRows) * (slice + 1) / nSlices);
+            std::ostringstream text;
+            text.precision(outputDigits);
+            if(last > first)
+            {
+                const double* outputs = &m_outputs[static_cast<std::size_t>(first) * nOut];
+                m_engine.predict(&m_inputs[static_cast<std::size_t>(first) * inStride], inStride, last - first, &m_outputs[static_cast<std::size_t>(first) * nOut], nOut, m_workspaces[slice]);
+                for(unsigned nRow = 0; nRow < last - first; ++nRow)
+                {
+                    for(unsigned outIndex = 0; outIndex < nOut; ++outIndex)
+                    {
+                        text << (outIndex == 0 ? "" : " ") << outputs[nRow * nOut + outIndex];
+                    }
+                    text << '\n';
+                }
+            }
+            m_text[slice] = text.str();
+        });
+        for(unsigned slice = 0; slice < nSlices; ++slice)
+        {
+            file << m_text[slice];
+        }
+        nScored += nRows;
+    }
+    file.close();
+    if(!file)
+    {
+        std::cerr << "Error writing " << outputFileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return nScored;
+}
@@ -1,455 +1,646 @@
 #include "../include/bpneuralnetwork.h"
-#include "../include/transferactivation.h"
-#include "../include/logistic.h"
-#include "../include/tanhfunction.h"
 #include "../include/utility.h"
+#include "../include/kernels.h"
+#include "../include/patternstream.h"
+#include "../include/modelfile.h"
+#include "../include/quantisedengine.h"
 #include <iostream>
 #include <cstdlib>
-#include <ctime>
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 
-BPNeuralNetwork::BPNeuralNetwork()
-: m_ir()                                                 
-, m_pm(m_ir.inColumns(),m_ir.outColumns())
-, m_net(m_ir.nHiddenLayers())
-, m_outputs(m_ir.outColumns())
+namespace
 {
-    //Note that at this stage m_ir is fully initialised.
-    //m_pm needs an assigned file, included in the parameter file
-    //at entry #1
-    m_pm.readFile(m_ir.fileName());
-    //Defining how to scale the data
-    m_pm.scale(m_ir.scalingType());
-    std::srand(std::time(0));
-    //After intialising rand() and m_pm, I start initialising the net
-    //the activation functions and then I write all information to the
-    //header of the output file.
-    initialiseNet();
-    initialiseHiddenFunction();
-    initialiseOutFunction();
-    printHeaderToFile();
+//In BATCH mode the weights are updated once per epoch, so the number of patterns
+//propagated together only affects performance, not results.
+const unsigned batchModeBlockSize = 64;
+//Shuffled mini-batches are gathered in the background only when they are large enough
+//(in values) for the copy to cost more than handing the batch over to another thread.
+const unsigned backgroundGatherSize = 16384;
+//Largest number of training patterns propagated to calibrate the quantised nets.
+const unsigned calibrationPatterns = 1024;
+
+//The folds already run in parallel on the pool, so the patterns of each net are only
+//sharded over the threads the other folds leave free, e.g. 2 shards for 4 folds on 8 threads.
+unsigned shardCount(const InputReader& ir, const ThreadPool& pool)
+{
+    if(ir.mode() != BATCH && ir.mode() != ASYNCHRONOUS)
+    {
+        return 1;
+    }
+    unsigned nThreads = pool.nThreads();
+    return std::max(1u, nThreads / std::min(ir.k(), nThreads));
 }
 
-BPNeuralNetwork::~BPNeuralNetwork()
+//Brings scaled values back to the units of the data, for the inference engines.
+void unscaleValues(const double* values, const std::vector<double>& offsets, const std::vector<double>& divisors, unsigned n, double* unscaled)
 {
-    delete m_oFunction;
-    m_oFunction = NULL;
-    delete m_hFunction;
-    m_hFunction = NULL;    
+    for(unsigned i = 0; i < n; ++i)
+    {
+        unscaled[i] = offsets.empty() ? values[i] : values[i] * divisors[i] + offsets[i];
+    }
 }
 
-void BPNeuralNetwork::train(unsigned excluded)
+//Percentage of wrong classifications of each output, as in the test results: scaled
+//outputs above 0.5 are taken as 1, the others as 0.
+std::vector<int> classificationErrors(const std::vector<double>& outputs, const std::vector<std::vector<double> >& expectedResults, const std::vector<double>& offsets, const std::vector<double>& divisors)
 {
-    //The propagate-backPropagate functions are called once for every epoch and
-    //for each pattern. The update function is called once per epoch and per pattern, if online
-    //or just once per epoch if batch.
-    for(unsigned t = 0; t < m_ir.nEpochs(); ++t)
-    {   
-        for(unsigned nPattern = 0; nPattern < m_pm.numberOfInputPatterns() - m_ir.nTestPatterns(); ++nPattern)
+    unsigned nOut = expectedResults.empty() ? 0 : expectedResults[0].size();
+    std::vector<int> nWrongClass(nOut, 0);
+    for(unsigned value = 0; value < expectedResults.size(); ++value)
+    {
+        for(unsigned nEntry = 0; nEntry < nOut; ++nEntry)
         {
-            //Loop jumps over patterns which are excluded, for crossvalidation.
-            if(nPattern % m_ir.k() == excluded)
-            {
-                continue;
-            }
-            propagate(nPattern);
-            backPropagate(nPattern);
-    
-            if(m_ir.mode() == ONLINE)
+            double output = outputs[value * nOut + nEntry];
+            double scaled = offsets.empty() ? output : (output - offsets[nEntry]) / divisors[nEntry];
+            double binaryOutput = (scaled > 0.5) ? 1 : 0;
+            if(binaryOutput != expectedResults[value][nEntry])
             {
-                update();    
-                
+                nWrongClass[nEntry] += 1;
             }
         }
-        if(m_ir.mode() == BATCH)
-        {
-            update();
-        }
     }
-    //After training, printing weights to file.
-    printWeightsToFile(excluded);
+    for(unsigned nEntry = 0; nEntry < nOut; ++nEntry)
+    {
+        nWrongClass[nEntry] = 100 * nWrongClass[nEntry] / static_cast<int>(expectedResults.size());
+    }
+    return nWrongClass;
+}
 }
 
-void BPNeuralNetwork::test()
+BPNeuralNetwork::BPNeuralNetwork(const InputReader& ir, const PatternsManager& pm, const FoldPartition& folds, ThreadPool& pool, unsigned seed)
+: m_ir(ir)
+, m_pm(pm)
+, m_folds(folds)
+, m_pool(pool)
+, m_generator(seed)
+, m_seed(seed)
+, m_engine(NULL)
+, m_batchCapacity((m_ir.mode() == BATCH) ? batchModeBlockSize : m_ir.batchSize())
+, m_nShards(shardCount(ir, pool))
+, m_inputStride(pm.inputStride())
+, m_targetStride(pm.outputStride())
+, m_inputs(m_nShards, AlignedVector(m_batchCapacity * m_inputStride, 0.0))
+, m_targets(m_nShards, AlignedVector(m_batchCapacity * m_targetStride, 0.0))
+, m_batches(m_nShards)
+, m_loader(NULL)
+, m_shuffleBuffer(m_ir.streamBuffer() * (m_ir.inColumns() + m_ir.outColumns()), 0.0)
 {
-    std::vector<std::vector<double> > results;
-    std::vector<std::vector<double> > expectedResults;
-    //For testing, I just propagate all test patterns and collect the outputs. Then I write to file.
-    for(unsigned nPattern = m_pm.numberOfInputPatterns() - m_ir.nTestPatterns(); nPattern < m_pm.numberOfInputPatterns(); ++nPattern)
+    //The parameters and the data are ready, so the net can be initialised,
+    //specialised for the activation functions, with the generator of this net.
+    //Each shard of the training patterns has its own workspace in the engine.
+    m_engine = NetworkEngine::create(m_ir, m_batchCapacity, m_nShards, &m_pool, m_generator);
+    if(m_ir.shuffle() && !streaming() && m_ir.mode() == MINIBATCH && m_batchCapacity * m_inputStride >= backgroundGatherSize)
     {
-        propagate(nPattern);
-        std::vector<double> result(m_outputs.size());
-        std::vector<double> expectedResult(m_pm.getOutput(nPattern).size());
-        for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
-        {
-            result[outIndex] = m_outputs[outIndex].output;
-            expectedResult[outIndex] = m_pm.getOutput(nPattern)[outIndex];
-            results.push_back(result);
-            expectedResults.push_back(expectedResult);
-        }
+        m_loader = new BatchLoader(m_pm, m_batchCapacity);
     }
-    printTestResults(results, expectedResults);
 }
 
-void BPNeuralNetwork::crossvalidate(unsigned included)
+BPNeuralNetwork::~BPNeuralNetwork()
 {
-    std::vector<std::vector<double> > results;
-    std::vector<std::vector<double> > expectedResults;
-    //Cross-validation is very similar to test, but acts on the included patterns, most likely the same as
-    //the excluded during training. The results are the printed to output.
-    for(unsigned nPattern = 0; nPattern < m_pm.numberOfInputPatterns() - m_ir.nTestPatterns(); ++nPattern)
+    delete m_loader;
+    m_loader = NULL;
+    delete m_engine;
+    m_engine = NULL;
+}
+
+void BPNeuralNetwork::train(unsigned excluded)
+{
+    //Patterns which are excluded, for crossvalidation, are not used.
+    std::vector<unsigned> patterns;
+    if(!streaming())
     {
-        if(nPattern % m_ir.k() == included)
+        patterns = m_folds.trainingPatterns(excluded);
+    }
+    //The energy on the training patterns is reported ten times during the training,
+    //so that the convergence of the different modes can be compared.
+    unsigned checkpoint = std::max(m_ir.nEpochs() / 10, 1u);
+    std::vector<unsigned> order(patterns);
+    for(unsigned t = 0; t < m_ir.nEpochs(); ++t)
+    {
+        //The order of each epoch only depends on the seed of the net and on the epoch.
+        //In BATCH mode the order does not matter, and the shards stay contiguous.
+        if(m_ir.shuffle() && m_ir.mode() != BATCH)
+        {
+            std::seed_seq sequence{m_seed, t};
+            std::mt19937 epochGenerator(sequence);
+            order = patterns;
+            std::shuffle(order.begin(), order.end(), epochGenerator);
+        }
+        if(streaming())
+        {
+            trainEpochStreamed(excluded);
+        }
+        else if(m_ir.mode() == BATCH)
+        {
+            trainEpochSharded(order);
+        }
+        else if(m_ir.mode() == ASYNCHRONOUS)
+        {
+            trainEpochAsynchronous(order);
+        }
+        else
+        {
+            trainEpoch(order);
+        }
+        if((t + 1) % checkpoint == 0 || t + 1 == m_ir.nEpochs())
         {
-            propagate(nPattern);
-            std::vector<double> result(m_outputs.size());
-            std::vector<double> expectedResult(m_pm.getOutput(nPattern).size());
-            for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
+            unsigned nTraining = 0;
+            double energy = trainingEnergy(patterns, excluded, nTraining);
+            m_report << "Energy on the training patterns after epoch " << t + 1 << ": " << energy;
+            if(nTraining == 0)
             {
-                result[outIndex] = m_outputs[outIndex].output;
-                expectedResult[outIndex] = m_pm.getOutput(nPattern)[outIndex];
-                results.push_back(result);
-                expectedResults.push_back(expectedResult);
+                m_report << " (no training patterns)";
             }
+            m_report << std::endl;
         }
     }
-    printCrossValidationResults(included, results, expectedResults);
+    //After training, printing weights to file.
+    printWeights(excluded);
 }
 
-void BPNeuralNetwork::initialiseNet()
+void BPNeuralNetwork::trainEpoch(const std::vector<unsigned>& patterns)
 {
-    //Initialisation of the network. This scheme of for cycles is repeated in other functions.
-    //Basically I cycle through the layers, for each layer I cycle through the nodes, and,
-    //for each node, I cycle through weights,deltaWeights and oldDeltaWeights,whenever necessary.
-    for(unsigned layer = 0; layer < m_ir.nHiddenLayers(); ++layer)
-    {
-        //The number of node per layer is  defined in the parameter file.
-        m_net[layer].resize(m_ir.nNodesPerLayer()[layer]);
-        for(unsigned neuroIndex = 0; neuroIndex < m_ir.nNodesPerLayer()[layer]; ++neuroIndex)
-        {
-            //For the first layer, the number of weights corresponds to the number of input entries
-            // for each pattern.
-            if(layer == 0)
-            {
-                m_net[layer][neuroIndex].output = 0.0;
-                m_net[layer][neuroIndex].derOutput = 0.0;
-                m_net[layer][neuroIndex].weights.resize(m_ir.inColumns());
-                m_net[layer][neuroIndex].deltaWeights.resize(m_ir.inColumns(),0.0);
-                m_net[layer][neuroIndex].oldDeltaWeights.resize(m_ir.inColumns(),0.0);
-                m_net[layer][neuroIndex].threshold = 0.0;
-                m_net[layer][neuroIndex].deltaThreshold = 0.0;
-                m_net[layer][neuroIndex].oldDeltaThreshold = 0.0;
-                m_net[layer][neuroIndex].delta = 0.0;
-            }
-            //For other layers, the number of weights is just the number of nodes in the previous layer.
-            else
-            {
-                m_net[layer][neuroIndex].output = 0.0;
-                m_net[layer][neuroIndex].derOutput = 0.0;
-                m_net[layer][neuroIndex].weights.resize(m_ir.nNodesPerLayer()[layer-1]);
-                m_net[layer][neuroIndex].deltaWeights.resize(m_ir.nNodesPerLayer()[layer-1],0.0);
-                m_net[layer][neuroIndex].oldDeltaWeights.resize(m_ir.nNodesPerLayer()[layer-1],0.0);
-                m_net[layer][neuroIndex].threshold = 0.0;
-                m_net[layer][neuroIndex].deltaThreshold = 0.0;
-                m_net[layer][neuroIndex].oldDeltaThreshold = 0.0;
-                m_net[layer][neuroIndex].delta = 0.0;
-            }
-            //Weights are initialised randomly to the range defined in the parameter file.
-            for(unsigned wIndex = 0; wIndex < m_net[layer][neuroIndex].weights.size(); ++wIndex)
-            {
-                m_net[layer][neuroIndex].weights[wIndex] = static_cast<double>(std::rand()) / RAND_MAX * (m_ir.weightRange().second - m_ir.weightRange().first) + m_ir.weightRange().first;
-	    }
-            //Thresholds are initialised as weight if an interval is defined, or all set to the same value if [min max] with min = max.
-            m_net[layer][neuroIndex].threshold = (m_ir.thresholdsRange().second == m_ir.thresholdsRange().first) ? m_ir.thresholdsRange().first 
-                                                                                                                 : static_cast<double>(std::rand()) / RAND_MAX * (m_ir.thresholdsRange().second - m_ir.thresholdsRange().first) + m_ir.thresholdsRange().first;
-	}
-    }
-    //The output layer is treated separately. There is only one layer, the cycle is for every output node,
-    //and the number of weights  corresponds to the number of nodes in the last hidden layer.
-    for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
-    {
-        m_outputs[outIndex].output = 0.0;
-        m_outputs[outIndex].derOutput = 0.0;
-        m_outputs[outIndex].weights.resize(m_ir.nNodesPerLayer()[m_ir.nNodesPerLayer().size() - 1]);
-        m_outputs[outIndex].deltaWeights.resize(m_ir.nNodesPerLayer()[m_ir.nNodesPerLayer().size() - 1],0.0);
-        m_outputs[outIndex].oldDeltaWeights.resize(m_ir.nNodesPerLayer()[m_ir.nNodesPerLayer().size() - 1],0.0);
-        m_outputs[outIndex].delta = 0.0;
-        for(unsigned wIndex = 0; wIndex < m_outputs[outIndex].weights.size(); ++wIndex)
+    //The propagate-backPropagate functions are called for each batch of patterns,
+    //followed by update: online is the same as batches of one pattern.
+    if(m_loader != NULL)
+    {
+        //The next batch is gathered while the net trains on the current one.
+        m_loader->start(patterns, m_batchCapacity);
+        while(m_loader->next(m_batches[0]))
         {
-            m_outputs[outIndex].weights[wIndex] = static_cast<double>(std::rand()) / RAND_MAX * (m_ir.weightRange().second - m_ir.weightRange().first) + m_ir.weightRange().first;
-	}
-        m_outputs[outIndex].threshold  = (m_ir.thresholdsRange().second == m_ir.thresholdsRange().first) ? m_ir.thresholdsRange().first 
-                                                                          : static_cast<double>(std::rand()) / RAND_MAX * (m_ir.thresholdsRange().second - m_ir.thresholdsRange().first) + m_ir.thresholdsRange().first;
-	m_outputs[outIndex].deltaThreshold = 0;
-	m_outputs[outIndex].oldDeltaThreshold = 0;
+            propagate(0, m_batches[0].nPatterns);
+            backPropagate(0, m_batches[0].nPatterns);
+            update(0);
+        }
+        return;
+    }
+    for(unsigned first = 0; first < patterns.size(); first += m_batchCapacity)
+    {
+        unsigned nPatterns = std::min(m_batchCapacity, static_cast<unsigned>(patterns.size()) - first);
+        stage(0, &patterns[first], nPatterns);
+        propagate(0, nPatterns);
+        backPropagate(0, nPatterns);
+        update(0);
     }
 }
 
-void BPNeuralNetwork::initialiseHiddenFunction()
+void BPNeuralNetwork::trainEpochSharded(const std::vector<unsigned>& patterns)
 {
-    if(m_ir.hiddenFunction() == "transfer")
+    //In BATCH mode the weights only change at the end of the epoch, so the training
+    //patterns are split in contiguous shards, one per thread, each accumulating the
+    //deltaWeights in its own workspace of the engine.
+    m_pool.parallelFor(0, m_nShards, [this, &patterns](unsigned shard)
     {
-        m_hFunction = new TransferActivation();
-    }
-    else if(m_ir.hiddenFunction() == "logistic")
+        unsigned begin = patterns.size() * shard / m_nShards;
+        unsigned end = patterns.size() * (shard + 1) / m_nShards;
+        for(unsigned first = begin; first < end; first += m_batchCapacity)
+        {
+            unsigned nPatterns = std::min(m_batchCapacity, end - first);
+            stage(shard, &patterns[first], nPatterns);
+            propagate(shard, nPatterns);
+            backPropagate(shard, nPatterns);
+        }
+    });
+    //Tree reduction into the first workspace: at each level the shards are merged in
+    //pairs, always in the same order, so that the result does not depend on timing.
+    for(unsigned width = 1; width < m_nShards; width *= 2)
     {
-        m_hFunction = new Logistic(m_ir.betaHidden());
+        m_pool.parallelFor(0, (m_nShards + 2 * width - 1) / (2 * width), [this, width](unsigned pair)
+        {
+            unsigned target = pair * 2 * width;
+            if(target + width < m_nShards)
+            {
+                m_engine->mergeGradients(target, target + width);
+            }
+        });
     }
-    else if(m_ir.hiddenFunction() == "tanh")
+    update(0);
+}
+
+void BPNeuralNetwork::trainEpochAsynchronous(const std::vector<unsigned>& patterns)
+{
+    //Every thread trains online on its share of the patterns (one every m_nShards, so
+    //that all threads see all the classes in turn) and updates the shared weights
+    //after each pattern, without waiting for the others. The weights can change while
+    //a pattern is being propagated, which is accepted in exchange for the parallelism.
+    m_pool.parallelFor(0, m_nShards, [this, &patterns](unsigned shard)
     {
-        m_hFunction = new TanhFunction(m_ir.betaHidden());
-    }
+        for(unsigned index = shard; index < patterns.size(); index += m_nShards)
+        {
+            stage(shard, &patterns[index], 1);
+            propagate(shard, 1);
+            backPropagate(shard, 1);
+            update(shard);
+        }
+    });
 }
 
-void BPNeuralNetwork::initialiseOutFunction()
+void BPNeuralNetwork::trainEpochStreamed(unsigned excluded)
 {
-    if(m_ir.outFunction() == "transfer")
+    //The patterns come from the shuffle buffer one at a time, and are trained in batches
+    //as they arrive. The weights are updated after each batch, or at the end in BATCH mode.
+    unsigned nPatterns = 0;
+    streamPatterns(TRAINING_PATTERNS, excluded, [this, &nPatterns](const double* inputPattern, const double* output)
     {
-        m_oFunction = new TransferActivation();
-    }
-    else if(m_ir.outFunction() == "logistic")
+        stagePattern(0, nPatterns, inputPattern, output);
+        if(++nPatterns == m_batchCapacity)
+        {
+            propagate(0, nPatterns);
+            backPropagate(0, nPatterns);
+            if(m_ir.mode() != BATCH)
+            {
+                update(0);
+            }
+            nPatterns = 0;
+        }
+    });
+    if(nPatterns > 0)
     {
-        m_oFunction = new Logistic(m_ir.betaOut());
+        propagate(0, nPatterns);
+        backPropagate(0, nPatterns);
+        if(m_ir.mode() != BATCH)
+        {
+            update(0);
+        }
     }
-    else if(m_ir.outFunction() == "tanh")
+    if(m_ir.mode() == BATCH)
     {
-        m_oFunction = new TanhFunction(m_ir.betaOut());
+        update(0);
     }
 }
 
-void BPNeuralNetwork::propagate(unsigned nPattern)
+double BPNeuralNetwork::trainingEnergy(const std::vector<unsigned>& patterns, unsigned excluded, unsigned& nTraining)
 {
-    //Propagation computes for every node the sum of the weights multiplied by
-    //the relative input, and uses the activation function on the result.
-    //For hidden layers, the helper function computeOutput() is used for 
-    //keeping the code cleaner.
-    for(unsigned layer = 0; layer < m_net.size(); ++layer)
+    //Energy (half the squared error) averaged over the patterns.
+    double energy = 0.0;
+    nTraining = 0;
+    if(streaming())
     {
-        for(unsigned neuroIndex = 0; neuroIndex < m_net[layer].size(); ++neuroIndex)
+        unsigned nPatterns = 0;
+        streamPatterns(TRAINING_PATTERNS, excluded, [this, &nPatterns, &nTraining, &energy](const double* inputPattern, const double* output)
         {
-            computeOutput(layer, neuroIndex, nPattern);
+            stagePattern(0, nPatterns, inputPattern, output);
+            ++nTraining;
+            if(++nPatterns == m_batchCapacity)
+            {
+                propagate(0, nPatterns);
+                energy += stagedEnergy(nPatterns);
+                nPatterns = 0;
+            }
+        }, false);
+        if(nPatterns > 0)
+        {
+            propagate(0, nPatterns);
+            energy += stagedEnergy(nPatterns);
         }
     }
-    for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
+    else
     {
-        double sum = 0;
-        for(unsigned wIndex = 0; wIndex < m_outputs[outIndex].weights.size(); ++wIndex)
+        for(unsigned first = 0; first < patterns.size(); first += m_batchCapacity)
         {
-            sum += m_net[m_net.size() - 1][wIndex].output * m_outputs[outIndex].weights[wIndex];
+            unsigned nPatterns = std::min(m_batchCapacity, static_cast<unsigned>(patterns.size()) - first);
+            stage(0, &patterns[first], nPatterns);
+            propagate(0, nPatterns);
+            energy += stagedEnergy(nPatterns);
         }
-        sum += m_outputs[outIndex].threshold;
-        m_outputs[outIndex].output = m_oFunction->equation(sum);
-        m_outputs[outIndex].derOutput = m_oFunction->firstDerivative(sum);
+        nTraining = patterns.size();
     }
+    return (nTraining > 0) ? energy / nTraining : 0.0;
 }
 
-void BPNeuralNetwork::backPropagate(unsigned nPattern)
+double BPNeuralNetwork::stagedEnergy(unsigned nPatterns) const
 {
-    //Backpropagate computes the deltas according to the standard multi layer perceptron model,
-    //and the deltaWeights, which will be used during the update phase to compute the new weights.
-    //This is done to be able to use this function in both batch and online mode.
-    for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
+    double energy = 0.0;
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
     {
-        m_outputs[outIndex].delta = m_outputs[outIndex].derOutput * (m_pm.getOutput(nPattern)[outIndex] - m_outputs[outIndex].output);
-        for(unsigned wIndex = 0; wIndex < m_outputs[outIndex].deltaWeights.size(); ++wIndex)
+        const double* expected = m_batches[0].targets + nRow * m_batches[0].targetStride;
+        for(unsigned outIndex = 0; outIndex < m_ir.outColumns(); ++outIndex)
         {
-            m_outputs[outIndex].deltaWeights[wIndex] += m_ir.learningRate() * m_outputs[outIndex].delta * m_net[m_net.size() - 1][wIndex].output; 
+            double error = expected[outIndex] - m_engine->output(nRow, outIndex);
+            energy += 0.5 * error * error;
         }
-        m_outputs[outIndex].deltaThreshold += m_ir.learningRate() * m_outputs[outIndex].delta;
-    }   
-    for(int layer = m_net.size() - 1; layer >= 0; --layer)
-    {
-        for(unsigned neuroIndex = 0; neuroIndex < m_net[layer].size(); ++neuroIndex)
-        {
-            if(layer == m_net.size() - 1)
-            {
-                m_net[layer][neuroIndex].delta = 0.0;
-                for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
-                {
-                    m_net[layer][neuroIndex].delta += m_outputs[outIndex].weights[neuroIndex] * m_outputs[outIndex].delta;
-                }
-            }
-            else
-            {
-                m_net[layer][neuroIndex].delta = 0.0;
-                for(unsigned nextIndex = 0; nextIndex < m_net[layer + 1].size(); ++nextIndex)
-                {
-                    m_net[layer][neuroIndex].delta += m_net[layer+1][nextIndex].weights[neuroIndex] * m_net[layer + 1][nextIndex].delta;
-                }
-            }
-            m_net[layer][neuroIndex].delta *= m_net[layer][neuroIndex].derOutput;
-            for(unsigned wIndex = 0; wIndex < m_net[layer][neuroIndex].deltaWeights.size(); ++wIndex)
-            {
-                if(layer != 0)
-                {
-                    m_net[layer][neuroIndex].deltaWeights[wIndex] += m_ir.learningRate() * m_net[layer][neuroIndex].delta * m_net[layer-1][wIndex].output;
-                }
-                else
-                {
-                    m_net[layer][neuroIndex].deltaWeights[wIndex] += m_ir.learningRate() * m_net[layer][neuroIndex].delta * m_pm.getInputPattern(nPattern)[wIndex];
-                }
-            }
-            m_net[layer][neuroIndex].deltaThreshold += m_ir.learningRate() * m_net[layer][neuroIndex].delta;
-        }
-    }   
+    }
+    return energy;
 }
 
-void BPNeuralNetwork::update()
+void BPNeuralNetwork::test()
 {
-    //Update simply sums the deltaweights to the weights, adding a momentum term.
-    for(unsigned layer = 0; layer < m_net.size(); ++layer)
+    std::vector<std::vector<double> > results;
+    std::vector<std::vector<double> > expectedResults;
+    //For testing, I just propagate all test patterns and collect the outputs. Then I write to file.
+    std::vector<double> result(m_ir.outColumns());
+    std::vector<double> expectedResult(m_ir.outColumns());
+    //The inputs are kept, in the units of the data, to test the quantised net.
+    std::vector<double> testInputs;
+    auto evaluate = [&](const double* inputPattern, const double* output)
     {
-        for(unsigned neuroIndex = 0; neuroIndex < m_net[layer].size(); ++neuroIndex)
+        if(m_ir.quantise())
         {
-            for(unsigned wIndex = 0; wIndex < m_net[layer][neuroIndex].weights.size(); ++wIndex)
-            {
-                m_net[layer][neuroIndex].weights[wIndex] = m_net[layer][neuroIndex].weights[wIndex] + m_net[layer][neuroIndex].deltaWeights[wIndex] + m_ir.momentum() * m_net[layer][neuroIndex].oldDeltaWeights[wIndex];
-                m_net[layer][neuroIndex].oldDeltaWeights[wIndex] = m_net[layer][neuroIndex].deltaWeights[wIndex];
-                m_net[layer][neuroIndex].deltaWeights[wIndex] = 0.0;
-            }
-            m_net[layer][neuroIndex].threshold = m_net[layer][neuroIndex].threshold + m_net[layer][neuroIndex].deltaThreshold + m_ir.momentum()* m_net[layer][neuroIndex].oldDeltaThreshold;
-            m_net[layer][neuroIndex].oldDeltaThreshold = m_net[layer][neuroIndex].deltaThreshold;
-            m_net[layer][neuroIndex].deltaThreshold = 0.0;
+            testInputs.resize(testInputs.size() + m_ir.inColumns());
+            unscaleValues(inputPattern, m_pm.inOffsets(), m_pm.inDivisors(), m_ir.inColumns(), &testInputs[testInputs.size() - m_ir.inColumns()]);
         }
+        usePattern(0, inputPattern, output);
+        propagate(0, 1);
+        for(unsigned outIndex = 0; outIndex < m_ir.outColumns(); ++outIndex)
+        {
+            result[outIndex] = m_engine->output(0, outIndex);
+            expectedResult[outIndex] = output[outIndex];
+        }
+        results.push_back(result);
+        expectedResults.push_back(expectedResult);
+    };
+    if(streaming())
+    {
+        streamPatterns(TEST_PATTERNS, 0, evaluate, false);
     }
-    for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
+    else
     {
-        for(unsigned wIndex = 0; wIndex < m_outputs[outIndex].weights.size(); ++wIndex)
+        for(unsigned nPattern = m_pm.numberOfInputPatterns() - m_ir.nTestPatterns(); nPattern < m_pm.numberOfInputPatterns(); ++nPattern)
         {
-            m_outputs[outIndex].weights[wIndex] = m_outputs[outIndex].weights[wIndex] + m_outputs[outIndex].deltaWeights[wIndex] + m_ir.momentum() * m_outputs[outIndex].oldDeltaWeights[wIndex];
-            m_outputs[outIndex].oldDeltaWeights[wIndex] = m_outputs[outIndex].deltaWeights[wIndex];
-            m_outputs[outIndex].deltaWeights[wIndex] = 0.0;
+            //The pattern is scaled, if the data are not.
+            stage(0, &nPattern, 1);
+            evaluate(m_batches[0].inputs, m_batches[0].targets);
         }
-	m_outputs[outIndex].threshold = m_outputs[outIndex].threshold + m_outputs[outIndex].deltaThreshold + m_ir.momentum() * m_outputs[outIndex].oldDeltaThreshold;
-	m_outputs[outIndex].oldDeltaThreshold = m_outputs[outIndex].deltaThreshold;
-	m_outputs[outIndex].deltaThreshold = 0.0;
+    }
+    printTestResults(results, expectedResults);
+    if(m_ir.quantise())
+    {
+        printQuantisationResults(testInputs, expectedResults);
     }
 }
 
-void BPNeuralNetwork::computeOutput(unsigned layer, unsigned neuroIndex, unsigned nPattern)
+void BPNeuralNetwork::crossvalidate(unsigned included)
 {
-    double sum = 0;
-    if(layer == 0)
+    //Cross-validation is very similar to test, but acts on the included patterns, most likely the same as
+    //the excluded during training. Only the number of wrong classifications is kept, and printed to output.
+    std::vector<int> nWrongClass(m_ir.outColumns(), 0);
+    unsigned nValidation = 0;
+    auto evaluate = [&](const double* inputPattern, const double* output)
     {
-        for(unsigned wIndex = 0; wIndex < m_net[layer][neuroIndex].weights.size(); ++wIndex)
+        usePattern(0, inputPattern, output);
+        propagate(0, 1);
+        for(unsigned outIndex = 0; outIndex < m_ir.outColumns(); ++outIndex)
         {
-            sum  += m_pm.getInputPattern(nPattern)[wIndex] * m_net[layer][neuroIndex].weights[wIndex];
+            if(round(m_engine->output(0, outIndex)) != output[outIndex])
+            {
+                nWrongClass[outIndex] += 1;
+            }
         }
-     
-        sum += m_net[layer][neuroIndex].threshold;
-        m_net[layer][neuroIndex].output = m_hFunction->equation(sum);
-        m_net[layer][neuroIndex].derOutput = m_hFunction->firstDerivative(sum);
+        ++nValidation;
+    };
+    if(streaming())
+    {
+        streamPatterns(VALIDATION_PATTERNS, included, evaluate, false);
     }
     else
     {
-        for(unsigned wIndex = 0; wIndex < m_net[layer][neuroIndex].weights.size(); ++wIndex)
+        const std::vector<unsigned>& patterns = m_folds.validationPatterns(included);
+        for(unsigned index = 0; index < patterns.size(); ++index)
         {
-            sum  += m_net[layer-1][wIndex].output * m_net[layer][neuroIndex].weights[wIndex];
+            stage(0, &patterns[index], 1);
+            evaluate(m_batches[0].inputs, m_batches[0].targets);
         }
-        sum += m_net[layer][neuroIndex].threshold;
-        m_net[layer][neuroIndex].output = m_hFunction->equation(sum);
-        m_net[layer][neuroIndex].derOutput = m_hFunction->firstDerivative(sum);
     }
+    printCrossValidationResults(included, nWrongClass, nValidation);
 }
 
-void BPNeuralNetwork::printHeaderToFile()
+template<class Body>
+void BPNeuralNetwork::streamPatterns(PatternSelection selection, unsigned fold, const Body& body, bool shuffle)
 {
-    std::ofstream file(m_ir.outFileName().c_str());
-    if(!file.is_open())
+    //The file is read sequentially; the selected patterns are scaled and, when training,
+    //go through the shuffle buffer: once it is full, each new pattern takes the place of
+    //one chosen at random, which is passed to body. The buffer is emptied at the end.
+    unsigned nIn = m_ir.inColumns();
+    unsigned rowSize = nIn + m_ir.outColumns();
+    unsigned nTraining = m_pm.numberOfInputPatterns() - m_ir.nTestPatterns();
+    unsigned capacity = shuffle ? m_ir.streamBuffer() : 0;
+    unsigned nBuffered = 0;
+    std::vector<double> row(rowSize);
+    PatternStream stream(m_ir.fileName(), nIn, m_ir.outColumns());
+    for(unsigned nPattern = 0; stream.readRow(&row[0]); ++nPattern)
     {
-        std::cerr << "Unable to open " << m_ir.outFileName() << std::endl;
-        exit(EXIT_FAILURE);
+        bool selected = (selection == TEST_PATTERNS) ? nPattern >= nTraining
+                      : nPattern < nTraining && ((m_folds.fold(nPattern) == fold) == (selection == VALIDATION_PATTERNS));
+        if(!selected)
+        {
+            continue;
+        }
+        m_pm.scalePattern(&row[0], &row[nIn]);
+        if(capacity <= 1)
+        {
+            body(&row[0], &row[nIn]);
+        }
+        else if(nBuffered < capacity)
+        {
+            std::copy(row.begin(), row.end(), m_shuffleBuffer.begin() + nBuffered * rowSize);
+            ++nBuffered;
+        }
+        else
+        {
+            double* slot = &m_shuffleBuffer[std::uniform_int_distribution<unsigned>(0, capacity - 1)(m_generator) * rowSize];
+            body(slot, slot + nIn);
+            std::copy(row.begin(), row.end(), slot);
+        }
     }
-    file << m_ir;
-    file << "Data Statistics: Min Max Mean StdDev" << std::endl;
-    for(unsigned nData = 0; nData < m_pm.inMins().size(); ++nData)
+    while(nBuffered > 0)
     {
-        file << "Input: " << m_pm.inMins()[nData] << "    " << m_pm.inMaxs()[nData] << "    " << m_pm.inMeans()[nData] << "    " << m_pm.inStdDevs()[nData] << std::endl;
+        double* slot = &m_shuffleBuffer[std::uniform_int_distribution<unsigned>(0, nBuffered - 1)(m_generator) * rowSize];
+        body(slot, slot + nIn);
+        --nBuffered;
+        std::copy(m_shuffleBuffer.begin() + nBuffered * rowSize, m_shuffleBuffer.begin() + (nBuffered + 1) * rowSize, slot);
     }
-    for(unsigned nData = 0; nData < m_pm.outMins().size(); ++nData)
+}
+
+void BPNeuralNetwork::stage(unsigned shard, const unsigned* patterns, unsigned nPatterns)
+{
+    BatchLoader::gather(m_pm, patterns, nPatterns, m_inputs[shard], m_targets[shard], m_batches[shard]);
+}
+
+void BPNeuralNetwork::stagePattern(unsigned shard, unsigned nRow, const double* inputPattern, const double* output)
+{
+    //The patterns are copied in a matrix, one per row, so that each layer
+    //can be computed for all of them with a single matrix product.
+    std::copy(inputPattern, inputPattern + m_ir.inColumns(), m_inputs[shard].begin() + nRow * m_inputStride);
+    std::copy(output, output + m_ir.outColumns(), m_targets[shard].begin() + nRow * m_targetStride);
+    PatternBatch& batch = m_batches[shard];
+    batch.inputs = &m_inputs[shard][0];
+    batch.inputStride = m_inputStride;
+    batch.targets = &m_targets[shard][0];
+    batch.targetStride = m_targetStride;
+    batch.nPatterns = nRow + 1;
+}
+
+void BPNeuralNetwork::usePattern(unsigned shard, const double* inputPattern, const double* output)
+{
+    PatternBatch& batch = m_batches[shard];
+    batch.inputs = inputPattern;
+    batch.inputStride = m_inputStride;
+    batch.targets = output;
+    batch.targetStride = m_targetStride;
+    batch.nPatterns = 1;
+}
+
+void BPNeuralNetwork::propagate(unsigned shard, unsigned nPatterns)
+{
+    //Propagation computes for every node the sum of the weights multiplied by
+    //the relative input, and uses the activation function on the result.
+    m_engine->propagate(shard, m_batches[shard].inputs, m_batches[shard].inputStride, nPatterns);
+}
+
+void BPNeuralNetwork::backPropagate(unsigned shard, unsigned nPatterns)
+{
+    //Backpropagate computes the deltas according to the standard multi layer perceptron model,
+    //and the deltaWeights, which will be used during the update phase to compute the new weights.
+    //This is done to be able to use this function in batch, mini-batch and online mode.
+    m_engine->backPropagate(shard, m_batches[shard].targets, m_batches[shard].targetStride, nPatterns);
+}
+
+void BPNeuralNetwork::update(unsigned shard)
+{
+    //Update simply sums the deltaweights to the weights, adding a momentum term.
+    m_engine->update(shard);
+}
+
+void BPNeuralNetwork::printHeader(std::ostream& os, const InputReader& ir, const PatternsManager& pm)
+{
+    os << ir;
+    os << "Vector instruction set: " << Kernels::instructionSet() << std::endl;
+    os << "Data Statistics: Min Max Mean StdDev" << std::endl;
+    for(unsigned nData = 0; nData < pm.inMins().size(); ++nData)
     {
-        file << "Output: " << m_pm.outMins()[nData] << "    " << m_pm.outMaxs()[nData] << "    " << m_pm.outMeans()[nData] << "    " << m_pm.outStdDevs()[nData] << std::endl;
+        os << "Input: " << pm.inMins()[nData] << "    " << pm.inMaxs()[nData] << "    " << pm.inMeans()[nData] << "    " << pm.inStdDevs()[nData] << std::endl;
     }
-    file.close();
+    for(unsigned nData = 0; nData < pm.outMins().size(); ++nData)
+    {
+        os << "Output: " << pm.outMins()[nData] << "    " << pm.outMaxs()[nData] << "    " << pm.outMeans()[nData] << "    " << pm.outStdDevs()[nData] << std::endl;
+    }
+}
+
+void BPNeuralNetwork::foldScaling()
+{
+    //From now on the net takes and gives unscaled data.
+    m_engine->foldScaling(m_pm.inOffsets(), m_pm.inDivisors(), m_pm.outOffsets(), m_pm.outDivisors());
+    m_report << "The following are the weights with the scaling of the data folded in, for unscaled inputs" << std::endl;
+    printLayers();
 }
 
-void BPNeuralNetwork::printWeightsToFile(unsigned excluded)
+void BPNeuralNetwork::saveModel(const std::string& fileName) const
 {
-    std::ofstream file(m_ir.outFileName().c_str(),std::ofstream::app);
-    if(!file.is_open())
+    ModelFile::write(fileName, m_ir, *m_engine, m_pm);
+}
+
+InferenceEngine* BPNeuralNetwork::inferenceEngine() const
+{
+    return InferenceEngine::create(m_ir, *m_engine, m_pm);
+}
+
+void BPNeuralNetwork::printWeights(unsigned excluded)
+{
+    if(m_folds.stratified())
     {
-        std::cerr << "Unable to open " << m_ir.outFileName() << std::endl;
-        exit(EXIT_FAILURE);
+        m_report << "The following are the weights obtained excluding the stratified fold " << excluded << " of " << m_ir.k() << std::endl;
     }
-    file << "The following are the weights obtained excluding every " << excluded << " +n" << m_ir.k() << std::endl; 
-    for(unsigned layer = 0; layer < m_net.size(); ++layer)
+    else
     {
-        file << "Layer " << layer << std::endl;
-        for(unsigned neuroIndex = 0; neuroIndex < m_net[layer].size(); ++neuroIndex)
+        m_report << "The following are the weights obtained excluding every " << excluded << " +n" << m_ir.k() << std::endl; 
+    }
+    printLayers();
+}
+
+void BPNeuralNetwork::printLayers()
+{
+    for(unsigned layer = 0; layer < m_engine->nLayers() - 1; ++layer)
+    {
+        m_report << "Layer " << layer << std::endl;
+        for(unsigned neuroIndex = 0; neuroIndex < m_engine->nNodes(layer); ++neuroIndex)
         {
-            file << "Node " << neuroIndex << ": ";
-            for(unsigned wIndex = 0; wIndex  < m_net[layer][neuroIndex].weights.size(); ++wIndex)
+            m_report << "Node " << neuroIndex << ": ";
+            for(unsigned wIndex = 0; wIndex  < m_engine->nInputs(layer); ++wIndex)
             {
-                file << m_net[layer][neuroIndex].weights[wIndex]  << " ";
+                m_report << m_engine->weight(layer, neuroIndex, wIndex)  << " ";
             }
-            file << std::endl;
+            m_report << "Threshold: " << m_engine->threshold(layer, neuroIndex) << std::endl;
         }
     }
-    file << "Output layer weights ";
-    for(unsigned outIndex = 0; outIndex < m_outputs.size(); ++outIndex)
+    unsigned outLayer = m_engine->nLayers() - 1;
+    m_report << "Output layer weights ";
+    for(unsigned outIndex = 0; outIndex < m_engine->nNodes(outLayer); ++outIndex)
     {
-        file << "Node " << outIndex << ": ";
-        for(unsigned wIndex = 0; wIndex < m_outputs[outIndex].weights.size(); ++wIndex)
+        m_report << "Node " << outIndex << ": ";
+        for(unsigned wIndex = 0; wIndex < m_engine->nInputs(outLayer); ++wIndex)
         {
-            file << m_outputs[outIndex].weights[outIndex] << " ";
+            m_report << m_engine->weight(outLayer, outIndex, wIndex) << " ";
         }
-        file << std::endl;
+        m_report << "Threshold: " << m_engine->threshold(outLayer, outIndex) << std::endl;
     }        
-    file.close();
 }
 
-void BPNeuralNetwork::printCrossValidationResults(unsigned included, const std::vector<std::vector<double> >& results, const std::vector<std::vector<double> >& expectedResults)
+void BPNeuralNetwork::printCrossValidationResults(unsigned included, const std::vector<int>& nWrongClass, unsigned nPatterns)
 {
-    std::ofstream file(m_ir.outFileName().c_str(),std::ofstream::app);
-    if(!file.is_open())
+    if(m_folds.stratified())
     {
-        std::cerr << "Unable to open " << m_ir.outFileName() << std::endl;
-        exit(EXIT_FAILURE);
+        m_report << "Results of cross validation using the stratified fold " << included << " of " << m_ir.k() << std::endl;
     }
-    file << "Results of cross validation using every " << included << " +n" << m_ir.k() << " pattern" << std::endl;
-    std::vector<int> nWrongClass(results[0].size(),0);
-    for(unsigned value = 0; value < results.size(); ++value)
+    else
     {
-        for(unsigned nEntry = 0; nEntry < results[value].size(); ++nEntry)
-        {
-	  if(round(results[value][nEntry]) != expectedResults[value][nEntry])
-	    {
-	      nWrongClass[nEntry] += 1;
-	    }
-        }
+        m_report << "Results of cross validation using every " << included << " +n" << m_ir.k() << " pattern" << std::endl;
     }
-    file << "The error on these data is: ";
+    m_report << "The error on these data is: ";
     for(unsigned nEntry = 0; nEntry < nWrongClass.size(); ++nEntry)
     {
-      file << 100 * nWrongClass[nEntry]/results.size() << " ";
+      m_report << 100 * nWrongClass[nEntry]/nPatterns << " ";
     }
-    file << std::endl;
-    file.close();
+    m_report << std::endl;
 }
 
-void BPNeuralNetwork::printTestResults(const std::vector<std::vector<double> >& results, const std::vector<std::vector<double> >& expectedResults)
+void BPNeuralNetwork::printQuantisationResults(const std::vector<double>& testInputs, const std::vector<std::vector<double> >& expectedResults)
 {
-  std::string resultsFileName = "Results.txt";
-  std::ofstream resultsFile(resultsFileName.c_str());
-    //This function prints the results to the output file.
-    std::ofstream file(m_ir.outFileName().c_str(),std::ofstream::app);
-    if(!file.is_open())
+    //The quantised net is calibrated on training patterns spread evenly over the data.
+    unsigned nIn = m_ir.inColumns();
+    unsigned nOut = m_ir.outColumns();
+    unsigned nTraining = m_pm.numberOfInputPatterns() - m_ir.nTestPatterns();
+    unsigned nSample = std::min(nTraining, calibrationPatterns);
+    std::vector<double> sample(nSample * nIn);
+    for(unsigned i = 0; i < nSample; ++i)
     {
-        std::cerr << "Unable to open " << m_ir.outFileName() << std::endl;
-        exit(EXIT_FAILURE);
+        unsigned nPattern = static_cast<unsigned>(static_cast<unsigned long long>(i) * nTraining / nSample);
+        stage(0, &nPattern, 1);
+        unscaleValues(m_batches[0].inputs, m_pm.inOffsets(), m_pm.inDivisors(), nIn, &sample[i * nIn]);
     }
-    std::string fileName = m_ir.outFileName().substr(0,m_ir.outFileName().length()-4);
-    file << "Results of tests:" << std::endl;
+    InferenceEngine* original = inferenceEngine();
+    QuantisedEngine quantised(*original, sample.data(), nIn, nSample);
+    unsigned nTest = expectedResults.size();
+    std::vector<double> originalOutputs(nTest * nOut);
+    std::vector<double> quantisedOutputs(nTest * nOut);
+    InferenceWorkspace originalWork = original->workspace(m_batchCapacity);
+    InferenceWorkspace quantisedWork = quantised.workspace(m_batchCapacity);
+    original->predict(testInputs.data(), nIn, nTest, originalOutputs.data(), nOut, originalWork);
+    quantised.predict(testInputs.data(), nIn, nTest, quantisedOutputs.data(), nOut, quantisedWork);
+    double largestChange = 0.0;
+    for(unsigned i = 0; i < nTest * nOut; ++i)
+    {
+        largestChange = std::max(largestChange, std::fabs(quantisedOutputs[i] - originalOutputs[i]));
+    }
+    std::vector<int> originalErrors = classificationErrors(originalOutputs, expectedResults, m_pm.outOffsets(), m_pm.outDivisors());
+    std::vector<int> quantisedErrors = classificationErrors(quantisedOutputs, expectedResults, m_pm.outOffsets(), m_pm.outDivisors());
+    m_report << "Results of tests with the net quantised to 8 bits, calibrated on " << nSample << " training patterns:" << std::endl;
+    m_report << "The error on these data is: ";
+    for(unsigned nEntry = 0; nEntry < nOut; ++nEntry)
+    {
+        m_report << quantisedErrors[nEntry] << " (" << originalErrors[nEntry] << " before quantisation) ";
+    }
+    m_report << std::endl;
+    m_report << "Largest change of the test outputs: " << largestChange << std::endl;
+    delete original;
+}
+
+void BPNeuralNetwork::printTestResults(const std::vector<std::vector<double> >& results, const std::vector<std::vector<double> >& expectedResults)
+{
+    //This function prints the results to the output file. The scatter plot data
+    //only refer to the last test.
+    m_testResults.str("");
+    m_report << "Results of tests:" << std::endl;
     std::vector<int> nWrongClass(results[0].size(),0);
     for(unsigned value = 0; value < results.size(); ++value)
     {
@@ -460,15 +651,13 @@ void BPNeuralNetwork::printTestResults(const std::vector<std::vector<double> >&
 	    {
     	      nWrongClass[nEntry] += 1;
 	    }
-	  resultsFile << results[value][nEntry] << "  " << expectedResults[value][nEntry] << std::endl;
+	  m_testResults << results[value][nEntry] << "  " << expectedResults[value][nEntry] << std::endl;
         }
     }
-    file << "The error on these data is: ";
+    m_report << "The error on these data is: ";
     for(unsigned nEntry = 0; nEntry < nWrongClass.size(); ++nEntry)
     {
-      file << 100 * nWrongClass[nEntry]/results.size() << " ";
+      m_report << 100 * nWrongClass[nEntry]/results.size() << " ";
     }
-    file << std::endl;
-    file.close();
-    resultsFile.close();
+    m_report << std::endl;
 }
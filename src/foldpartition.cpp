@@ -0,0 +1,62 @@
+#include "../include/foldpartition.h"
+#include <iostream>
+#include <cstdlib>
+#include <map>
+
+FoldPartition::FoldPartition(const InputReader& ir, const PatternsManager& pm)
+: m_k(ir.k())
+, m_nTraining(pm.numberOfInputPatterns() - ir.nTestPatterns())
+, m_stratified(ir.stratify())
+{
+    bool streamed = ir.streamBuffer() > 0;
+    if(m_stratified && streamed)
+    {
+        std::cerr << "Stratified cross-validation folds need the data in memory" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(m_stratified)
+    {
+        //The patterns of each output value are dealt among the folds in the order of the
+        //data; each value starts from the fold after the last one used by the previous
+        //value, so that the folds also have the same size (within one pattern).
+        std::map<std::vector<double>, std::vector<unsigned> > groups;
+        for(unsigned nPattern = 0; nPattern < m_nTraining; ++nPattern)
+        {
+            RowView output = pm.getOutput(nPattern);
+            groups[std::vector<double>(output.begin(), output.end())].push_back(nPattern);
+        }
+        m_foldOf.resize(m_nTraining);
+        unsigned next = 0;
+        for(std::map<std::vector<double>, std::vector<unsigned> >::const_iterator group = groups.begin(); group != groups.end(); ++group)
+        {
+            for(unsigned member = 0; member < group->second.size(); ++member)
+            {
+                m_foldOf[group->second[member]] = next;
+                next = (next + 1) % m_k;
+            }
+        }
+    }
+    if(streamed)
+    {
+        return;
+    }
+    m_folds.resize(m_k);
+    for(unsigned nPattern = 0; nPattern < m_nTraining; ++nPattern)
+    {
+        m_folds[fold(nPattern)].push_back(nPattern);
+    }
+}
+
+std::vector<unsigned> FoldPartition::trainingPatterns(unsigned excluded) const
+{
+    std::vector<unsigned> patterns;
+    patterns.reserve(m_nTraining);
+    for(unsigned nPattern = 0; nPattern < m_nTraining; ++nPattern)
+    {
+        if(fold(nPattern) != excluded)
+        {
+            patterns.push_back(nPattern);
+        }
+    }
+    return patterns;
+}
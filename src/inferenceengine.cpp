@@ -0,0 +1,196 @@
+#include "../include/inferenceengine.h"
+#include "../include/modelfile.h"
+#include "../include/networkengine.h"
+#include "../include/patternsmanager.h"
+#include "../include/inputreader.h"
+#include "../include/transferactivation.h"
+#include "../include/logistic.h"
+#include "../include/tanhfunction.h"
+#include "../include/linearalgebra.h"
+#include "../include/kernels.h"
+#include <algorithm>
+
+namespace
+{
+//Last part of the factory: the activation functions are already fixed.
+template<class Hidden, class Out>
+InferenceEngine* createEngine(const Hidden& hidden, const Out& out)
+{
+    return new InferenceEngineImpl<Hidden, Out>(hidden, out);
+}
+
+//Second part of the factory: the hidden activation function is already fixed.
+template<class Hidden>
+InferenceEngine* createEngine(const Hidden& hidden, Activation outFunction, double betaOut)
+{
+    if(outFunction == TRANSFER_ACTIVATION)
+    {
+        return createEngine(hidden, TransferActivation());
+    }
+    else if(outFunction == LOGISTIC_ACTIVATION)
+    {
+        return createEngine(hidden, Logistic(betaOut));
+    }
+    return createEngine(hidden, TanhFunction(betaOut));
+}
+
+InferenceEngine* createEngine(Activation hiddenFunction, double betaHidden, Activation outFunction, double betaOut)
+{
+    if(hiddenFunction == TRANSFER_ACTIVATION)
+    {
+        return createEngine(TransferActivation(), outFunction, betaOut);
+    }
+    else if(hiddenFunction == LOGISTIC_ACTIVATION)
+    {
+        return createEngine(Logistic(betaHidden), outFunction, betaOut);
+    }
+    return createEngine(TanhFunction(betaHidden), outFunction, betaOut);
+}
+
+//Outputs of a layer for a batch: weighted sums, threshold and activation function, as in
+//NetworkEngine, without the derivatives.
+template<class Function>
+void computeOutput(const InferenceLayer& layer, const Function& function, const double* inputs, unsigned inputStride, double* outputs, unsigned nPatterns)
+{
+    LinearAlgebra::multiplyTransposed(inputs, inputStride, layer.weights, layer.stride, outputs, layer.outputStride, nPatterns, layer.nNodes, layer.nInputs);
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        double* row = &outputs[nRow * layer.outputStride];
+        Kernels::axpy(1.0, layer.thresholds, row, layer.nNodes);
+        function.equation(row, layer.nNodes);
+    }
+}
+}
+
+InferenceEngine* InferenceEngine::create(const ModelFile& model)
+{
+    InferenceEngine* engine = createEngine(model.hiddenFunction(), model.betaHidden(), model.outFunction(), model.betaOut());
+    for(unsigned layer = 0; layer < model.nLayers(); ++layer)
+    {
+        InferenceLayer description = {model.nNodes(layer), model.nInputs(layer), model.stride(layer), paddedStride<double>(model.nNodes(layer)),
+                                      model.weights(layer), model.thresholds(layer)};
+        engine->m_layers.push_back(description);
+    }
+    if(model.scaled())
+    {
+        engine->m_inOffsets.assign(model.inOffsets(), model.inOffsets() + model.inColumns());
+        engine->m_inDivisors.assign(model.inDivisors(), model.inDivisors() + model.inColumns());
+        engine->m_outOffsets.assign(model.outOffsets(), model.outOffsets() + model.outColumns());
+        engine->m_outDivisors.assign(model.outDivisors(), model.outDivisors() + model.outColumns());
+    }
+    return engine;
+}
+
+InferenceEngine* InferenceEngine::create(const InputReader& ir, const NetworkEngine& trained, const PatternsManager& pm)
+{
+    InferenceEngine* engine = createEngine(ModelFile::activation(ir.hiddenFunction()), ir.betaHidden(), ModelFile::activation(ir.outFunction()), ir.betaOut());
+    //Each layer is stored as the weights, in padded rows, followed by the thresholds.
+    engine->m_storage.resize(trained.nLayers());
+    for(unsigned layer = 0; layer < trained.nLayers(); ++layer)
+    {
+        unsigned nNodes = trained.nNodes(layer);
+        unsigned nInputs = trained.nInputs(layer);
+        unsigned stride = paddedStride<double>(nInputs);
+        AlignedVector& storage = engine->m_storage[layer];
+        storage.assign(nNodes * stride + nNodes, 0.0);
+        for(unsigned neuroIndex = 0; neuroIndex < nNodes; ++neuroIndex)
+        {
+            for(unsigned wIndex = 0; wIndex < nInputs; ++wIndex)
+            {
+                storage[neuroIndex * stride + wIndex] = trained.weight(layer, neuroIndex, wIndex);
+            }
+            storage[nNodes * stride + neuroIndex] = trained.threshold(layer, neuroIndex);
+        }
+        InferenceLayer description = {nNodes, nInputs, stride, paddedStride<double>(nNodes), &storage[0], &storage[nNodes * stride]};
+        engine->m_layers.push_back(description);
+    }
+    engine->m_inOffsets = pm.inOffsets();
+    engine->m_inDivisors = pm.inDivisors();
+    engine->m_outOffsets = pm.outOffsets();
+    engine->m_outDivisors = pm.outDivisors();
+    return engine;
+}
+
+void InferenceEngine::copyNet(const InferenceEngine& source)
+{
+    m_layers = source.m_layers;
+    m_inOffsets = source.m_inOffsets;
+    m_inDivisors = source.m_inDivisors;
+    m_outOffsets = source.m_outOffsets;
+    m_outDivisors = source.m_outDivisors;
+}
+
+InferenceWorkspace InferenceEngine::workspace(unsigned batchCapacity) const
+{
+    unsigned widest = 0;
+    for(unsigned layer = 0; layer < m_layers.size(); ++layer)
+    {
+        widest = std::max(widest, m_layers[layer].outputStride);
+    }
+    InferenceWorkspace work;
+    work.batchCapacity = batchCapacity;
+    work.inputs.assign(m_inOffsets.empty() ? 0 : batchCapacity * paddedStride<double>(inColumns()), 0.0);
+    work.outputs[0].assign(batchCapacity * widest, 0.0);
+    work.outputs[1].assign(m_layers.size() > 1 ? batchCapacity * widest : 0, 0.0);
+    return work;
+}
+
+void InferenceEngine::predict(const double* inputs, unsigned inputStride, unsigned nPatterns, double* outputs, unsigned outputStride, InferenceWorkspace& work) const
+{
+    unsigned nOut = outColumns();
+    for(unsigned first = 0; first < nPatterns; first += work.batchCapacity)
+    {
+        unsigned nBatch = std::min(work.batchCapacity, nPatterns - first);
+        unsigned batchStride = inputStride;
+        const double* batchInputs = scaleInputs(inputs + static_cast<std::size_t>(first) * inputStride, batchStride, nBatch, work);
+        const double* results = propagate(work, batchInputs, batchStride, nBatch);
+        for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+        {
+            const double* result = &results[nRow * m_layers.back().outputStride];
+            double* output = outputs + static_cast<std::size_t>(first + nRow) * outputStride;
+            for(unsigned outIndex = 0; outIndex < nOut; ++outIndex)
+            {
+                output[outIndex] = m_outOffsets.empty() ? result[outIndex] : result[outIndex] * m_outDivisors[outIndex] + m_outOffsets[outIndex];
+            }
+        }
+    }
+}
+
+const double* InferenceEngine::scaleInputs(const double* inputs, unsigned& inputStride, unsigned nPatterns, InferenceWorkspace& work) const
+{
+    //Unscaled nets take the inputs where they are, otherwise they are scaled as the
+    //data the net was trained on.
+    if(m_inOffsets.empty())
+    {
+        return inputs;
+    }
+    unsigned nIn = inColumns();
+    unsigned stride = paddedStride<double>(nIn);
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        for(unsigned column = 0; column < nIn; ++column)
+        {
+            work.inputs[nRow * stride + column] = (inputs[nRow * inputStride + column] - m_inOffsets[column]) / m_inDivisors[column];
+        }
+    }
+    inputStride = stride;
+    return &work.inputs[0];
+}
+
+template<class Hidden, class Out>
+const double* InferenceEngineImpl<Hidden, Out>::propagate(InferenceWorkspace& work, const double* inputs, unsigned inputStride, unsigned nPatterns) const
+{
+    //Each layer takes as input the outputs of the previous one, which are kept in the
+    //other array of the workspace.
+    unsigned lastLayer = m_layers.size() - 1;
+    for(unsigned layer = 0; layer < lastLayer; ++layer)
+    {
+        double* outputs = &work.outputs[layer % 2][0];
+        computeOutput(m_layers[layer], m_hFunction, inputs, inputStride, outputs, nPatterns);
+        inputs = outputs;
+        inputStride = m_layers[layer].outputStride;
+    }
+    double* outputs = &work.outputs[lastLayer % 2][0];
+    computeOutput(m_layers[lastLayer], m_oFunction, inputs, inputStride, outputs, nPatterns);
+    return outputs;
+}
@@ -0,0 +1,415 @@
+#include "../include/inferenceserver.h"
+#include "../include/patternreader.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#define NN_HAVE_SOCKETS
+#endif
+
+namespace
+{
+//Milliseconds between the checks for a stop while waiting for connections or data.
+const int pollInterval = 100;
+//Number of the last requests whose latencies are kept for the percentiles.
+const unsigned latencyWindow = 65536;
+//Bytes read from a connection at once.
+const unsigned readSize = 65536;
+//Longest line accepted, in bytes: a client sending more without a newline is answered with
+//an error and disconnected, rather than buffered without limit.
+const std::size_t maxLineLength = 1 << 20;
+//Most connections served at once, each by its own thread: the others are refused.
+const unsigned maxConnections = 256;
+//Significant digits of the outputs sent, as for the batch scoring.
+const int outputDigits = 15;
+
+//Set by SIGINT and SIGTERM.
+volatile std::sig_atomic_t stopRequested = 0;
+
+extern "C" void requestStop(int)
+{
+    stopRequested = 1;
+}
+
+//Value of the percentile p of a set of values, reordered in the process.
+double percentile(std::vector<double>& values, double p)
+{
+    if(values.empty())
+    {
+        return 0.0;
+    }
+    std::size_t rank = static_cast<std::size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+#ifdef NN_HAVE_SOCKETS
+//Sends the whole text, unless the client has gone.
+void sendAll(int connection, const std::string& text)
+{
+    std::size_t sent = 0;
+    while(sent < text.size())
+    {
+        ssize_t n = write(connection, text.data() + sent, text.size() - sent);
+        if(n <= 0)
+        {
+            return;
+        }
+        sent += n;
+    }
+}
+#endif
+}
+
+InferenceServer::InferenceServer(const InferenceEngine& engine, unsigned maxBatch, unsigned maxWait)
+: m_engine(engine)
+, m_maxBatch(maxBatch)
+, m_maxWait(maxWait)
+, m_listener(-1)
+, m_nConnections(0)
+, m_stopBatching(false)
+{
+    m_statistics.nRequests = 0;
+    m_statistics.nBatches = 0;
+    m_statistics.p50 = 0.0;
+    m_statistics.p99 = 0.0;
+}
+
+InferenceServer::~InferenceServer()
+{
+#ifdef NN_HAVE_SOCKETS
+    if(m_listener >= 0)
+    {
+        close(m_listener);
+    }
+#endif
+}
+
+void InferenceServer::listen(const std::string& address)
+{
+#ifdef NN_HAVE_SOCKETS
+    bool local = address.compare(0, 5, "unix:") == 0;
+    if(local)
+    {
+        m_socketPath = address.substr(5);
+        sockaddr_un socketAddress;
+        std::memset(&socketAddress, 0, sizeof(socketAddress));
+        if(m_socketPath.empty() || m_socketPath.size() >= sizeof(socketAddress.sun_path))
+        {
+            std::cerr << "Invalid socket path " << m_socketPath << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        socketAddress.sun_family = AF_UNIX;
+        std::strcpy(socketAddress.sun_path, m_socketPath.c_str());
+        //The socket left by a previous server is replaced.
+        unlink(m_socketPath.c_str());
+        m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(m_listener < 0 || bind(m_listener, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0)
+        {
+            std::cerr << "Unable to listen on " << address << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    else
+    {
+        int port = std::atoi(address.c_str());
+        if(address.find_first_not_of("0123456789") != std::string::npos || port <= 0 || port > 65535)
+        {
+            std::cerr << "Invalid address " << address << ", expected unix:path or a port number" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        //Only local clients can connect.
+        sockaddr_in socketAddress;
+        std::memset(&socketAddress, 0, sizeof(socketAddress));
+        socketAddress.sin_family = AF_INET;
+        socketAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socketAddress.sin_port = htons(static_cast<unsigned short>(port));
+        m_listener = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if(m_listener < 0 || setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+           bind(m_listener, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0)
+        {
+            std::cerr << "Unable to listen on " << address << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(::listen(m_listener, SOMAXCONN) != 0)
+    {
+        std::cerr << "Unable to listen on " << address << std::endl;
+        exit(EXIT_FAILURE);
+    }
+#else
+    (void)address;
+    std::cerr << "The inference server needs POSIX sockets" << std::endl;
+    exit(EXIT_FAILURE);
+#endif
+}
+
+void InferenceServer::run()
+{
+#ifdef NN_HAVE_SOCKETS
+    //A client closing its connection early must not stop the server.
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::thread batcher(&InferenceServer::batchRequests, this);
+    while(!stopRequested)
+    {
+        pollfd event = {m_listener, POLLIN, 0};
+        if(poll(&event, 1, pollInterval) <= 0)
+        {
+            continue;
+        }
+        int connection = accept(m_listener, NULL, NULL);
+        if(connection < 0)
+        {
+            continue;
+        }
+        //Single rows are sent as soon as they are written.
+        if(m_socketPath.empty())
+        {
+            int noDelay = 1;
+            setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_nConnections >= maxConnections)
+            {
+                sendAll(connection, "error: too many connections\n");
+                close(connection);
+                continue;
+            }
+            ++m_nConnections;
+        }
+        std::thread(&InferenceServer::serveConnection, this, connection).detach();
+    }
+    close(m_listener);
+    m_listener = -1;
+    if(!m_socketPath.empty())
+    {
+        unlink(m_socketPath.c_str());
+    }
+    //The connections end their requests before the batching stops.
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_connectionClosed.wait(lock, [&]{return m_nConnections == 0;});
+        m_stopBatching = true;
+    }
+    m_requestQueued.notify_all();
+    batcher.join();
+#endif
+}
+
+ServerStatistics InferenceServer::statistics()
+{
+    std::vector<double> latencies;
+    ServerStatistics statistics;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        statistics = m_statistics;
+        latencies = m_latencies;
+    }
+    statistics.p50 = percentile(latencies, 0.5);
+    statistics.p99 = percentile(latencies, 0.99);
+    return statistics;
+}
+
+void InferenceServer::batchRequests()
+{
+    unsigned nIn = m_engine.inColumns();
+    unsigned nOut = m_engine.outColumns();
+    unsigned inStride = paddedStride<double>(nIn);
+    AlignedVector inputs(m_maxBatch * inStride, 0.0);
+    std::vector<double> outputs(m_maxBatch * nOut);
+    InferenceWorkspace work = m_engine.workspace(m_maxBatch);
+    std::vector<Request*> batch;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_requestQueued.wait(lock, [&]{return m_stopBatching || !m_pending.empty();});
+        if(m_pending.empty())
+        {
+            return;
+        }
+        //The batch is computed when full, or when its oldest request has waited long enough.
+        std::chrono::steady_clock::time_point deadline = m_pending.front()->arrival + m_maxWait;
+        m_requestQueued.wait_until(lock, deadline, [&]{return m_stopBatching || m_pending.size() >= m_maxBatch;});
+        unsigned nBatch = std::min<std::size_t>(m_pending.size(), m_maxBatch);
+        batch.assign(m_pending.begin(), m_pending.begin() + nBatch);
+        m_pending.erase(m_pending.begin(), m_pending.begin() + nBatch);
+        //The requests taken are only used by this thread until they are done.
+        lock.unlock();
+        for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+        {
+            std::copy(batch[nRow]->inputs, batch[nRow]->inputs + nIn, &inputs[nRow * inStride]);
+        }
+        m_engine.predict(&inputs[0], inStride, nBatch, &outputs[0], nOut, work);
+        for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+        {
+            std::copy(&outputs[nRow * nOut], &outputs[nRow * nOut] + nOut, batch[nRow]->outputs);
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        lock.lock();
+        for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+        {
+            double latency = std::chrono::duration<double, std::micro>(end - batch[nRow]->arrival).count();
+            if(m_latencies.size() < latencyWindow)
+            {
+                m_latencies.push_back(latency);
+            }
+            else
+            {
+                m_latencies[(m_statistics.nRequests + nRow) % latencyWindow] = latency;
+            }
+            batch[nRow]->done = true;
+        }
+        m_statistics.nRequests += nBatch;
+        m_statistics.nBatches += 1;
+        m_batchDone.notify_all();
+    }
+}
+
+void InferenceServer::compute(std::vector<Request>& requests)
+{
+    if(requests.empty())
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now();
+    for(unsigned nRequest = 0; nRequest < requests.size(); ++nRequest)
+    {
+        requests[nRequest].arrival = arrival;
+        requests[nRequest].done = false;
+        m_pending.push_back(&requests[nRequest]);
+    }
+    m_requestQueued.notify_all();
+    //The requests are computed in the order they are queued, so the last one is done last.
+    m_batchDone.wait(lock, [&]{return requests.back().done;});
+}
+
+void InferenceServer::serveConnection(int connection)
+{
+#ifdef NN_HAVE_SOCKETS
+    unsigned nIn = m_engine.inColumns();
+    unsigned nOut = m_engine.outColumns();
+    std::string received;
+    std::vector<char> chunk(readSize);
+    std::vector<std::string> replies;
+    std::vector<unsigned> requestReplies;
+    std::vector<double> inputs;
+    std::vector<double> outputs;
+    std::vector<Request> requests;
+    bool open = true;
+    while(open && !stopRequested)
+    {
+        pollfd event = {connection, POLLIN, 0};
+        if(poll(&event, 1, pollInterval) <= 0)
+        {
+            continue;
+        }
+        ssize_t nRead = read(connection, &chunk[0], chunk.size());
+        if(nRead > 0)
+        {
+            received.append(&chunk[0], nRead);
+        }
+        else
+        {
+            //A last line without a newline is answered before closing.
+            open = false;
+            if(!received.empty() && received[received.size() - 1] != '\n')
+            {
+                received += '\n';
+            }
+        }
+        //All the complete lines received are answered together, so that the rows sent
+        //at once by a client can share a batch.
+        std::size_t lineStart = 0;
+        std::size_t lineEnd;
+        replies.clear();
+        requestReplies.clear();
+        inputs.clear();
+        while((lineEnd = received.find('\n', lineStart)) != std::string::npos)
+        {
+            std::size_t contentEnd = (lineEnd > lineStart && received[lineEnd - 1] == '\r') ? lineEnd - 1 : lineEnd;
+            const char* begin = received.data() + lineStart;
+            const char* end = received.data() + contentEnd;
+            lineStart = lineEnd + 1;
+            if(PatternReader::isEmptyLine(begin, end))
+            {
+                continue;
+            }
+            if(std::string(begin, end) == "stats")
+            {
+                ServerStatistics statistics = this->statistics();
+                std::ostringstream text;
+                text << "requests " << statistics.nRequests << " batches " << statistics.nBatches
+                     << " p50 " << statistics.p50 << " p99 " << statistics.p99 << '\n';
+                replies.push_back(text.str());
+                continue;
+            }
+            std::string error;
+            inputs.resize(inputs.size() + nIn);
+            if(!PatternReader::parseLine(begin, end, &inputs[inputs.size() - nIn], nIn, error))
+            {
+                inputs.resize(inputs.size() - nIn);
+                replies.push_back("error: " + error + '\n');
+                continue;
+            }
+            requestReplies.push_back(replies.size());
+            replies.push_back(std::string());
+        }
+        received.erase(0, lineStart);
+        bool tooLong = received.size() > maxLineLength;
+        unsigned nRequests = requestReplies.size();
+        requests.resize(nRequests);
+        outputs.resize(nRequests * nOut);
+        for(unsigned nRequest = 0; nRequest < nRequests; ++nRequest)
+        {
+            requests[nRequest].inputs = &inputs[nRequest * nIn];
+            requests[nRequest].outputs = &outputs[nRequest * nOut];
+        }
+        compute(requests);
+        for(unsigned nRequest = 0; nRequest < nRequests; ++nRequest)
+        {
+            std::ostringstream text;
+            text.precision(outputDigits);
+            for(unsigned outIndex = 0; outIndex < nOut; ++outIndex)
+            {
+                text << (outIndex == 0 ? "" : " ") << outputs[nRequest * nOut + outIndex];
+            }
+            text << '\n';
+            replies[requestReplies[nRequest]] = text.str();
+        }
+        std::string reply;
+        for(unsigned nReply = 0; nReply < replies.size(); ++nReply)
+        {
+            reply += replies[nReply];
+        }
+        if(tooLong)
+        {
+            reply += "error: line longer than " + std::to_string(maxLineLength) + " bytes\n";
+            open = false;
+        }
+        sendAll(connection, reply);
+    }
+    close(connection);
+#else
+    (void)connection;
+#endif
+    //The server may be destroyed as soon as the last connection is counted out, so the
+    //condition is only signalled once this thread has finished.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    --m_nConnections;
+    std::notify_all_at_thread_exit(m_connectionClosed, std::move(lock));
+}
@@ -121,6 +121,7 @@ void InputReader::readFile()
     {
         line = line.substr(0,line.length()-1);
     }
+    m_batchSize = 1;
     if(line == "batch")
     {
         m_mode = BATCH;
@@ -129,6 +130,23 @@ void InputReader::readFile()
     {
         m_mode = ONLINE;
     }
+    else if(line == "asynchronous")
+    {
+        m_mode = ASYNCHRONOUS;
+    }
+    else if(line.substr(0,9) == "minibatch")
+    {
+        //Mini-batch mode requires the number of patterns per batch on the same line.
+        m_mode = MINIBATCH;
+        std::stringstream modeStream(line.substr(9));
+        modeStream >> m_batchSize;
+        errorcheck(modeStream, commentLine);
+        if(m_batchSize == 0)
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
     else
     {
         std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
@@ -181,9 +199,186 @@ void InputReader::readFile()
         line = line.substr(0,line.length()-1);
     }
     m_outFileName = line;
+
+    //The following pairs of lines are optional: if the file ends, the defaults are used.
+    //Pair of lines relative to the floating point precision.
+    m_precision = DOUBLE_PRECISION;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "double")
+        {
+            m_precision = DOUBLE_PRECISION;
+        }
+        else if(line == "float")
+        {
+            m_precision = SINGLE_PRECISION;
+        }
+        else if(line == "mixed")
+        {
+            m_precision = MIXED_PRECISION;
+        }
+        else
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the number of threads.
+    m_nThreads = 0;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        std::stringstream threadStream(line);
+        threadStream >> m_nThreads;
+        errorcheck(threadStream, commentLine);
+    }
+
+    //Pair of lines relative to the minimum number of neurons of a layer split across the threads.
+    m_splitThreshold = 1024;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        std::stringstream splitStream(line);
+        splitStream >> m_splitThreshold;
+        errorcheck(splitStream, commentLine);
+    }
+
+    //Pair of lines relative to streaming of the data, with the size of the shuffle buffer.
+    m_streamBuffer = 0;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        std::stringstream streamStream(line);
+        streamStream >> m_streamBuffer;
+        errorcheck(streamStream, commentLine);
+    }
+
+    //Pair of lines relative to the shuffling of the training patterns at every epoch.
+    m_shuffle = false;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "yes")
+        {
+            m_shuffle = true;
+        }
+        else if(line != "no")
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the stratification of the cross-validation folds.
+    m_stratify = false;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "yes")
+        {
+            m_stratify = true;
+        }
+        else if(line != "no")
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the folding of the data scaling into the nets.
+    m_foldScaling = false;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "yes")
+        {
+            m_foldScaling = true;
+        }
+        else if(line != "no")
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the storage of the input patterns in memory.
+    m_storage = DOUBLE_STORAGE;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "double")
+        {
+            m_storage = DOUBLE_STORAGE;
+        }
+        else if(line == "uint8")
+        {
+            m_storage = UINT8_STORAGE;
+        }
+        else if(line == "uint16")
+        {
+            m_storage = UINT16_STORAGE;
+        }
+        else
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        //Streamed data are not kept in memory.
+        if(m_storage != DOUBLE_STORAGE && m_streamBuffer > 0)
+        {
+            std::cerr << "Quantised storage of the inputs needs the data in memory" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the model file written after training.
+    m_modelFileName = "none";
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        m_modelFileName = line;
+        if(m_modelFileName.empty())
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //Pair of lines relative to the tests of the nets quantised to 8 bits.
+    m_quantise = false;
+    if(readOptionalEntry(file, commentLine, line))
+    {
+        Utility::tolower(line);
+        if(line == "yes")
+        {
+            m_quantise = true;
+        }
+        else if(line != "no")
+        {
+            std::cerr << "Problem in line " << commentLine.substr(1) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        //The calibration patterns are drawn from the training data.
+        if(m_quantise && m_streamBuffer > 0)
+        {
+            std::cerr << "Tests of the quantised nets need the data in memory" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
     file.close();
 }
 
+bool InputReader::readOptionalEntry(std::istream& file, std::string& commentLine, std::string& line)
+{
+    if(!getline(file,commentLine) || !getline(file,line))
+    {
+        return false;
+    }
+    if(!line.empty() && line[line.length()-1] == '\r')
+    {
+        line = line.substr(0,line.length()-1);
+    }
+    return true;
+}
+
 //Consistency check for input streams.
 void InputReader::errorcheck(std::iostream& inStream, const std::string& comment)
 {
@@ -209,11 +404,25 @@ std::ostream& operator<<(std::ostream& os, const InputReader& ir)
     os << "Number of Epochs used: " << ir.nEpochs() << std::endl;
     os << "Learning Rate: " << ir.learningRate() << std::endl;
     os << "Momentum " << ir.momentum() << std::endl;
-    os << "Training mode (BATCH = 0, ONLINE = 1): " << ir.mode() << std::endl;
+    os << "Training mode (BATCH = 0, ONLINE = 1, MINIBATCH = 2, ASYNCHRONOUS = 3): " << ir.mode() << std::endl;
+    if(ir.mode() == MINIBATCH)
+    {
+        os << "Patterns per mini-batch: " << ir.batchSize() << std::endl;
+    }
     os << "Using " << ir.nTestPatterns() << " for tests" << std::endl;
     os << "Using k-fold cross-validation with k = " << ir.k() << std::endl;
     os << "Using " << ir.hiddenFunction() << " activation function for the hidden layers with b = " << ir.betaHidden();
     os << " and " << ir.outFunction() << " for the output layer with b = " << ir.betaOut() << std::endl;
     os << "Using " << ir.costFunction() << " as cost function" << std::endl;
+    os << "Floating point precision (DOUBLE = 0, FLOAT = 1, MIXED = 2): " << ir.precision() << std::endl;
+    os << "Number of threads (0 = one per hardware thread): " << ir.nThreads() << std::endl;
+    os << "Minimum number of neurons of a layer split across the threads (0 = never): " << ir.splitThreshold() << std::endl;
+    os << "Patterns in the shuffle buffer when streaming the data (0 = data in memory): " << ir.streamBuffer() << std::endl;
+    os << "Training patterns shuffled at every epoch (0 = no, 1 = yes): " << ir.shuffle() << std::endl;
+    os << "Cross-validation folds stratified by output (0 = no, 1 = yes): " << ir.stratify() << std::endl;
+    os << "Data scaling folded into the nets, data kept unscaled (0 = no, 1 = yes): " << ir.foldScaling() << std::endl;
+    os << "Storage of the inputs in memory (DOUBLE = 0, UINT8 = 1, UINT16 = 2): " << ir.storage() << std::endl;
+    os << "Model file written with the net of the last fold: " << ir.modelFileName() << std::endl;
+    os << "Nets also tested after quantisation to 8 bits (0 = no, 1 = yes): " << ir.quantise() << std::endl;
     return os;
 }
@@ -0,0 +1,262 @@
+#include "../include/kernels.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#if defined(NN_X86_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+//The portable kernels are templates on the floating point types, so that the single and
+//mixed precision versions perform exactly the same operations as the double precision ones.
+template<typename Real>
+Real portableDot(const Real* x, const Real* y, unsigned n)
+{
+    Real sum = 0.0;
+    for(unsigned i = 0; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+template<typename Real, typename Accumulator>
+void portableAxpy(double alpha, const Real* x, Accumulator* y, unsigned n)
+{
+    const Accumulator a = static_cast<Accumulator>(alpha);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+template<typename Real, typename Accumulator>
+void portableMomentumUpdate(Real* weights, Accumulator* deltaWeights, Accumulator* oldDeltaWeights, double momentum, unsigned n)
+{
+    const Accumulator m = static_cast<Accumulator>(momentum);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        weights[i] = static_cast<Real>(weights[i] + deltaWeights[i] + m * oldDeltaWeights[i]);
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0;
+    }
+}
+
+template<typename Real>
+void portableLogistic(Real* values, unsigned n, double beta)
+{
+    const Real scale = static_cast<Real>(-2.0 * beta);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        values[i] = Real(1.0) / (Real(1.0) + std::exp(scale * values[i]));
+    }
+}
+
+template<typename Real>
+void portableLogisticDerivative(const Real* outputs, Real* derivatives, unsigned n, double beta)
+{
+    const Real scale = static_cast<Real>(2.0 * beta);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        derivatives[i] = scale * outputs[i] * (Real(1.0) - outputs[i]);
+    }
+}
+
+template<typename Real>
+void portableTanh(Real* values, unsigned n, double beta)
+{
+    const Real b = static_cast<Real>(beta);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        values[i] = std::tanh(b * values[i]);
+    }
+}
+
+template<typename Real>
+void portableTanhDerivative(const Real* outputs, Real* derivatives, unsigned n, double beta)
+{
+    const Real b = static_cast<Real>(beta);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        derivatives[i] = b * (Real(1.0) - outputs[i] * outputs[i]);
+    }
+}
+
+template<typename Compact>
+void portableDequantise(const Compact* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    for(unsigned i = 0; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+std::int32_t portableDotInt8(const std::uint8_t* x, const std::int8_t* y, unsigned n)
+{
+    std::int32_t sum = 0;
+    for(unsigned i = 0; i < n; ++i)
+    {
+        sum += static_cast<std::int32_t>(x[i]) * y[i];
+    }
+    return sum;
+}
+
+void portableMultiplyInt8(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y)
+{
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        y[row] = scales[row] * portableDotInt8(x, weights + row * stride, n) + biases[row];
+    }
+}
+
+//Rounded to the nearest level, ties to even as by the vector conversions. A NaN gives 0.
+void portableQuantise8(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n)
+{
+    for(unsigned i = 0; i < n; ++i)
+    {
+        double level = std::min(255.0, std::max(0.0, x[i] * inverseSteps[i] + shifts[i]));
+        values[i] = static_cast<std::uint8_t>(std::nearbyint(level));
+    }
+}
+
+//The tiles of the portable kernels have 4 columns in double precision and 8 in single precision.
+template<typename Real, unsigned nColumns>
+void portableMultiplyTile(const Real* a, unsigned aRowStride, unsigned aColumnStride, const Real* b, unsigned ldb, Real* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    Real sums[Kernels::tileRows][nColumns] = {};
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const Real* bRow = b + p * ldb;
+        for(unsigned i = 0; i < Kernels::tileRows; ++i)
+        {
+            const Real ai = a[i * aRowStride + p * aColumnStride];
+            for(unsigned j = 0; j < nColumns; ++j)
+            {
+                sums[i][j] += ai * bRow[j];
+            }
+        }
+    }
+    const Real scale = static_cast<Real>(alpha);
+    for(unsigned i = 0; i < Kernels::tileRows; ++i)
+    {
+        for(unsigned j = 0; j < nColumns; ++j)
+        {
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + scale * sums[i][j] : scale * sums[i][j];
+        }
+    }
+}
+
+const KernelTable portableTable = {"portable", portableDot<double>, portableAxpy<double, double>, portableMomentumUpdate<double, double>,
+                                   portableLogistic<double>, portableLogisticDerivative<double>, portableTanh<double>, portableTanhDerivative<double>,
+                                   portableDot<float>, portableAxpy<float, float>, portableMomentumUpdate<float, float>,
+                                   portableLogistic<float>, portableLogisticDerivative<float>, portableTanh<float>, portableTanhDerivative<float>,
+                                   portableAxpy<float, double>, portableMomentumUpdate<float, double>,
+                                   portableDequantise<std::uint8_t>, portableDequantise<std::uint16_t>, portableMultiplyInt8, portableQuantise8,
+                                   4, 8, portableMultiplyTile<double, 4>, portableMultiplyTile<float, 8>};
+
+//Queries the CPU for the instruction sets. Besides the CPUID flags, AVX and AVX-512 also
+//require the operating system to save the wider registers, which is checked through XGETBV.
+bool cpuSupports(const char* instructionSet)
+{
+#if defined(NN_X86_KERNELS) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if(std::strcmp(instructionSet, "sse2") == 0)
+    {
+        return __builtin_cpu_supports("sse2");
+    }
+    if(std::strcmp(instructionSet, "avx2") == 0)
+    {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    }
+    if(std::strcmp(instructionSet, "avx512") == 0)
+    {
+        return __builtin_cpu_supports("avx512f");
+    }
+    if(std::strcmp(instructionSet, "avx512vnni") == 0)
+    {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vnni");
+    }
+    return false;
+#elif defined(NN_X86_KERNELS) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int nIds = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false;
+    bool avx512 = false;
+    bool vnni = false;
+    if(nIds >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = fma && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+        avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+        vnni = avx512 && (info[2] & (1 << 11)) != 0;
+    }
+    if(std::strcmp(instructionSet, "sse2") == 0)
+    {
+        return sse2;
+    }
+    if(std::strcmp(instructionSet, "avx2") == 0)
+    {
+        return avx2;
+    }
+    if(std::strcmp(instructionSet, "avx512") == 0)
+    {
+        return avx512;
+    }
+    if(std::strcmp(instructionSet, "avx512vnni") == 0)
+    {
+        return vnni;
+    }
+    return false;
+#else
+    (void)instructionSet;
+    return false;
+#endif
+}
+
+//The widest instruction set supported by the CPU (and allowed by NN_KERNELS) is chosen.
+const KernelTable* selectTable()
+{
+    const char* requested = std::getenv("NN_KERNELS");
+    std::string limit = (requested != NULL) ? requested : "avx512vnni";
+    const KernelTable* candidates[] = {avx512VnniKernels(), avx512Kernels(), avx2Kernels(), sse2Kernels()};
+    bool allowed = false;
+    for(unsigned i = 0; i < 4; ++i)
+    {
+        if(candidates[i] == NULL)
+        {
+            continue;
+        }
+        allowed = allowed || limit == candidates[i]->name;
+        if(allowed && cpuSupports(candidates[i]->name))
+        {
+            return candidates[i];
+        }
+    }
+    if(requested != NULL && limit != "portable" && !allowed)
+    {
+        std::cerr << "Unknown NN_KERNELS value " << limit << ", using portable kernels" << std::endl;
+    }
+    return &portableTable;
+}
+}
+
+const KernelTable* portableKernels()
+{
+    return &portableTable;
+}
+
+const KernelTable& Kernels::table()
+{
+    static const KernelTable* selected = selectTable();
+    return *selected;
+}
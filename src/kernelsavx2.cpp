@@ -0,0 +1,564 @@
+#include "../include/kernels.h"
+#include "../include/kernelconstants.h"
+//This file is compiled with AVX2 and FMA enabled (see CMakeLists.txt) and only used if the CPU supports them.
+#ifdef NN_X86_KERNELS
+#include <immintrin.h>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+double avx2Dot(const double* x, const double* y, unsigned n)
+{
+    //Four independent accumulators hide the latency of the fused multiply-add.
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    __m256d sum2 = _mm256_setzero_pd();
+    __m256d sum3 = _mm256_setzero_pd();
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+        sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), sum1);
+        sum2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), sum2);
+        sum3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), sum3);
+    }
+    for(; i + 4 <= n; i += 4)
+    {
+        sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), sum0);
+    }
+    sum0 = _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3));
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+    double sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for(; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void avx2Axpy(double alpha, const double* x, double* y, unsigned n)
+{
+    __m256d a = _mm256_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    for(; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+void avx2MomentumUpdate(double* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m256d m = _mm256_set1_pd(momentum);
+    __m256d zero = _mm256_setzero_pd();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d delta = _mm256_loadu_pd(deltaWeights + i);
+        __m256d w = _mm256_add_pd(_mm256_loadu_pd(weights + i), delta);
+        _mm256_storeu_pd(weights + i, _mm256_fmadd_pd(m, _mm256_loadu_pd(oldDeltaWeights + i), w));
+        _mm256_storeu_pd(oldDeltaWeights + i, delta);
+        _mm256_storeu_pd(deltaWeights + i, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = weights[i] + deltaWeights[i] + momentum * oldDeltaWeights[i];
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0;
+    }
+}
+
+//Vector exponential, see the constants above. 2^n is built directly in the exponent bits.
+inline __m256d avx2Exp(__m256d x)
+{
+    const __m256d magic = _mm256_set1_pd(roundingMagic);
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-expLimit)), _mm256_set1_pd(expLimit));
+    __m256d n = _mm256_sub_pd(_mm256_fmadd_pd(x, _mm256_set1_pd(log2e), magic), magic);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2High), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2Low), r);
+    __m256d rr = _mm256_mul_pd(r, r);
+    __m256d p = _mm256_fmadd_pd(_mm256_set1_pd(expP0), rr, _mm256_set1_pd(expP1));
+    p = _mm256_mul_pd(r, _mm256_fmadd_pd(p, rr, _mm256_set1_pd(expP2)));
+    __m256d q = _mm256_fmadd_pd(_mm256_set1_pd(expQ0), rr, _mm256_set1_pd(expQ1));
+    q = _mm256_fmadd_pd(q, rr, _mm256_set1_pd(expQ2));
+    q = _mm256_fmadd_pd(q, rr, _mm256_set1_pd(expQ3));
+    __m256d e = _mm256_div_pd(p, _mm256_sub_pd(q, p));
+    e = _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_add_pd(e, e));
+    __m256i bits = _mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(roundingMagic + 1023.0))), 52);
+    return _mm256_mul_pd(e, _mm256_castsi256_pd(bits));
+}
+
+void avx2Logistic(double* values, unsigned n, double beta)
+{
+    const __m256d scale = _mm256_set1_pd(-2.0 * beta);
+    const __m256d one = _mm256_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d e = avx2Exp(_mm256_mul_pd(scale, _mm256_loadu_pd(values + i)));
+        _mm256_storeu_pd(values + i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = 1.0 / (1.0 + std::exp(-2.0 * beta * values[i]));
+    }
+}
+
+void avx2LogisticDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m256d scale = _mm256_set1_pd(2.0 * beta);
+    const __m256d one = _mm256_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d f = _mm256_loadu_pd(outputs + i);
+        _mm256_storeu_pd(derivatives + i, _mm256_mul_pd(_mm256_mul_pd(scale, f), _mm256_sub_pd(one, f)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = 2.0 * beta * outputs[i] * (1.0 - outputs[i]);
+    }
+}
+
+void avx2Tanh(double* values, unsigned n, double beta)
+{
+    const __m256d scale = _mm256_set1_pd(2.0 * beta);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d e = avx2Exp(_mm256_mul_pd(scale, _mm256_loadu_pd(values + i)));
+        _mm256_storeu_pd(values + i, _mm256_sub_pd(one, _mm256_div_pd(two, _mm256_add_pd(e, one))));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = std::tanh(beta * values[i]);
+    }
+}
+
+void avx2TanhDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m256d scale = _mm256_set1_pd(beta);
+    const __m256d one = _mm256_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d f = _mm256_loadu_pd(outputs + i);
+        _mm256_storeu_pd(derivatives + i, _mm256_mul_pd(scale, _mm256_fnmadd_pd(f, f, one)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = beta * (1.0 - outputs[i] * outputs[i]);
+    }
+}
+
+float avx2DotFloat(const float* x, const float* y, unsigned n)
+{
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    __m256 sum2 = _mm256_setzero_ps();
+    __m256 sum3 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), sum1);
+        sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), sum2);
+        sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), sum3);
+    }
+    for(; i + 8 <= n; i += 8)
+    {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), sum0);
+    }
+    sum0 = _mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3));
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    float sum = _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+    for(; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void avx2AxpyFloat(double alpha, const float* x, float* y, unsigned n)
+{
+    const float af = static_cast<float>(alpha);
+    __m256 a = _mm256_set1_ps(af);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += af * x[i];
+    }
+}
+
+void avx2MomentumUpdateFloat(float* weights, float* deltaWeights, float* oldDeltaWeights, double momentum, unsigned n)
+{
+    const float mf = static_cast<float>(momentum);
+    __m256 m = _mm256_set1_ps(mf);
+    __m256 zero = _mm256_setzero_ps();
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 delta = _mm256_loadu_ps(deltaWeights + i);
+        __m256 w = _mm256_add_ps(_mm256_loadu_ps(weights + i), delta);
+        _mm256_storeu_ps(weights + i, _mm256_fmadd_ps(m, _mm256_loadu_ps(oldDeltaWeights + i), w));
+        _mm256_storeu_ps(oldDeltaWeights + i, delta);
+        _mm256_storeu_ps(deltaWeights + i, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = weights[i] + deltaWeights[i] + mf * oldDeltaWeights[i];
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0f;
+    }
+}
+
+//Single precision vector exponential, see the constants above.
+inline __m256 avx2ExpFloat(__m256 x)
+{
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-expLimitFloat)), _mm256_set1_ps(expLimitFloat));
+    __m256i ni = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(log2eFloat)));
+    __m256 n = _mm256_cvtepi32_ps(ni);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2HighFloat), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2LowFloat), r);
+    __m256 p = _mm256_fmadd_ps(_mm256_set1_ps(expPFloat0), r, _mm256_set1_ps(expPFloat1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expPFloat2));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expPFloat3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expPFloat4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(expPFloat5));
+    __m256 e = _mm256_add_ps(_mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r), _mm256_set1_ps(1.0f));
+    __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(ni, _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(e, _mm256_castsi256_ps(bits));
+}
+
+void avx2LogisticFloat(float* values, unsigned n, double beta)
+{
+    const float sf = static_cast<float>(-2.0 * beta);
+    const __m256 scale = _mm256_set1_ps(sf);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 e = avx2ExpFloat(_mm256_mul_ps(scale, _mm256_loadu_ps(values + i)));
+        _mm256_storeu_ps(values + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = 1.0f / (1.0f + std::exp(sf * values[i]));
+    }
+}
+
+void avx2LogisticDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const float sf = static_cast<float>(2.0 * beta);
+    const __m256 scale = _mm256_set1_ps(sf);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 f = _mm256_loadu_ps(outputs + i);
+        _mm256_storeu_ps(derivatives + i, _mm256_mul_ps(_mm256_mul_ps(scale, f), _mm256_sub_ps(one, f)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = sf * outputs[i] * (1.0f - outputs[i]);
+    }
+}
+
+void avx2TanhFloat(float* values, unsigned n, double beta)
+{
+    const float bf = static_cast<float>(beta);
+    const __m256 scale = _mm256_set1_ps(2.0f * bf);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 e = avx2ExpFloat(_mm256_mul_ps(scale, _mm256_loadu_ps(values + i)));
+        _mm256_storeu_ps(values + i, _mm256_sub_ps(one, _mm256_div_ps(two, _mm256_add_ps(e, one))));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = std::tanh(bf * values[i]);
+    }
+}
+
+void avx2TanhDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const float bf = static_cast<float>(beta);
+    const __m256 scale = _mm256_set1_ps(bf);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256 f = _mm256_loadu_ps(outputs + i);
+        _mm256_storeu_ps(derivatives + i, _mm256_mul_ps(scale, _mm256_fnmadd_ps(f, f, one)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = bf * (1.0f - outputs[i] * outputs[i]);
+    }
+}
+
+//The mixed precision kernels widen 4 single precision values into a double precision vector.
+void avx2AxpyMixed(double alpha, const float* x, double* y, unsigned n)
+{
+    __m256d a = _mm256_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d xd = _mm256_cvtps_pd(_mm_loadu_ps(x + i));
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, xd, _mm256_loadu_pd(y + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+void avx2MomentumUpdateMixed(float* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m256d m = _mm256_set1_pd(momentum);
+    __m256d zero = _mm256_setzero_pd();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256d delta = _mm256_loadu_pd(deltaWeights + i);
+        __m256d w = _mm256_add_pd(_mm256_cvtps_pd(_mm_loadu_ps(weights + i)), delta);
+        w = _mm256_fmadd_pd(m, _mm256_loadu_pd(oldDeltaWeights + i), w);
+        _mm_storeu_ps(weights + i, _mm256_cvtpd_ps(w));
+        _mm256_storeu_pd(oldDeltaWeights + i, delta);
+        _mm256_storeu_pd(deltaWeights + i, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = static_cast<float>(weights[i] + deltaWeights[i] + momentum * oldDeltaWeights[i]);
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0;
+    }
+}
+
+void avx2Dequantise8(const std::uint8_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        std::int32_t packed;
+        std::memcpy(&packed, values + i, sizeof(packed));
+        __m256d converted = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(converted, _mm256_loadu_pd(scales + i), _mm256_loadu_pd(shifts + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+void avx2Dequantise16(const std::uint16_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i));
+        __m256d converted = _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(words));
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(converted, _mm256_loadu_pd(scales + i), _mm256_loadu_pd(shifts + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+std::int32_t avx2DotInt8(const std::uint8_t* x, const std::int8_t* y, unsigned n)
+{
+    //The bytes are widened to 16 bits, and the products summed in pairs into 32 bits,
+    //without the saturation of a direct 8 bit multiply-add.
+    __m256i sum0 = _mm256_setzero_si256();
+    __m256i sum1 = _mm256_setzero_si256();
+    unsigned i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        __m256i x0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        __m256i x1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i + 16)));
+        __m256i y0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+        __m256i y1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i + 16)));
+        sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(x0, y0));
+        sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(x1, y1));
+    }
+    for(; i + 16 <= n; i += 16)
+    {
+        __m256i x0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)));
+        __m256i y0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i)));
+        sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(x0, y0));
+    }
+    sum0 = _mm256_add_epi32(sum0, sum1);
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum0), _mm256_extracti128_si256(sum0, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    std::int32_t total = _mm_cvtsi128_si32(half);
+    for(; i < n; ++i)
+    {
+        total += static_cast<std::int32_t>(x[i]) * y[i];
+    }
+    return total;
+}
+
+void avx2MultiplyInt8(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y)
+{
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        y[row] = scales[row] * avx2DotInt8(x, weights + row * stride, n) + biases[row];
+    }
+}
+
+inline __m128i avx2Levels(const double* x, const double* inverseSteps, const double* shifts)
+{
+    __m256d level = _mm256_fmadd_pd(_mm256_loadu_pd(x), _mm256_loadu_pd(inverseSteps), _mm256_loadu_pd(shifts));
+    level = _mm256_min_pd(_mm256_max_pd(level, _mm256_setzero_pd()), _mm256_set1_pd(255.0));
+    return _mm256_cvtpd_epi32(level);
+}
+
+void avx2Quantise8(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n)
+{
+    //Four levels are converted at a time, and 16 packed to bytes with unsigned saturation.
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i low = _mm_packs_epi32(avx2Levels(x + i, inverseSteps + i, shifts + i), avx2Levels(x + i + 4, inverseSteps + i + 4, shifts + i + 4));
+        __m128i high = _mm_packs_epi32(avx2Levels(x + i + 8, inverseSteps + i + 8, shifts + i + 8), avx2Levels(x + i + 12, inverseSteps + i + 12, shifts + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_packus_epi16(low, high));
+    }
+    for(; i < n; ++i)
+    {
+        double level = std::min(255.0, std::max(0.0, x[i] * inverseSteps[i] + shifts[i]));
+        values[i] = static_cast<std::uint8_t>(std::nearbyint(level));
+    }
+}
+
+//Tiles of 4 rows of 2 vectors of C, accumulated in 8 registers with fused multiply-adds:
+//each row of B is loaded once for the 4 rows, and each entry of A once for the 2 vectors.
+inline void avx2StoreTile(double* entries, __m256d scale, __m256d sum, bool accumulate)
+{
+    _mm256_storeu_pd(entries, accumulate ? _mm256_fmadd_pd(scale, sum, _mm256_loadu_pd(entries)) : _mm256_mul_pd(scale, sum));
+}
+
+inline void avx2StoreTileFloat(float* entries, __m256 scale, __m256 sum, bool accumulate)
+{
+    _mm256_storeu_ps(entries, accumulate ? _mm256_fmadd_ps(scale, sum, _mm256_loadu_ps(entries)) : _mm256_mul_ps(scale, sum));
+}
+
+void avx2MultiplyTile(const double* a, unsigned aRowStride, unsigned aColumnStride, const double* b, unsigned ldb, double* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m256d c00 = _mm256_setzero_pd();
+    __m256d c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd();
+    __m256d c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd();
+    __m256d c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd();
+    __m256d c31 = _mm256_setzero_pd();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const double* bRow = b + p * ldb;
+        const double* column = a + p * aColumnStride;
+        __m256d b0 = _mm256_loadu_pd(bRow);
+        __m256d b1 = _mm256_loadu_pd(bRow + 4);
+        __m256d ai = _mm256_set1_pd(column[0]);
+        c00 = _mm256_fmadd_pd(ai, b0, c00);
+        c01 = _mm256_fmadd_pd(ai, b1, c01);
+        ai = _mm256_set1_pd(column[aRowStride]);
+        c10 = _mm256_fmadd_pd(ai, b0, c10);
+        c11 = _mm256_fmadd_pd(ai, b1, c11);
+        ai = _mm256_set1_pd(column[2 * aRowStride]);
+        c20 = _mm256_fmadd_pd(ai, b0, c20);
+        c21 = _mm256_fmadd_pd(ai, b1, c21);
+        ai = _mm256_set1_pd(column[3 * aRowStride]);
+        c30 = _mm256_fmadd_pd(ai, b0, c30);
+        c31 = _mm256_fmadd_pd(ai, b1, c31);
+    }
+    __m256d scale = _mm256_set1_pd(alpha);
+    avx2StoreTile(c, scale, c00, accumulate);
+    avx2StoreTile(c + 4, scale, c01, accumulate);
+    avx2StoreTile(c + ldc, scale, c10, accumulate);
+    avx2StoreTile(c + ldc + 4, scale, c11, accumulate);
+    avx2StoreTile(c + 2 * ldc, scale, c20, accumulate);
+    avx2StoreTile(c + 2 * ldc + 4, scale, c21, accumulate);
+    avx2StoreTile(c + 3 * ldc, scale, c30, accumulate);
+    avx2StoreTile(c + 3 * ldc + 4, scale, c31, accumulate);
+}
+
+void avx2MultiplyTileFloat(const float* a, unsigned aRowStride, unsigned aColumnStride, const float* b, unsigned ldb, float* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m256 c00 = _mm256_setzero_ps();
+    __m256 c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps();
+    __m256 c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps();
+    __m256 c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps();
+    __m256 c31 = _mm256_setzero_ps();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const float* bRow = b + p * ldb;
+        const float* column = a + p * aColumnStride;
+        __m256 b0 = _mm256_loadu_ps(bRow);
+        __m256 b1 = _mm256_loadu_ps(bRow + 8);
+        __m256 ai = _mm256_set1_ps(column[0]);
+        c00 = _mm256_fmadd_ps(ai, b0, c00);
+        c01 = _mm256_fmadd_ps(ai, b1, c01);
+        ai = _mm256_set1_ps(column[aRowStride]);
+        c10 = _mm256_fmadd_ps(ai, b0, c10);
+        c11 = _mm256_fmadd_ps(ai, b1, c11);
+        ai = _mm256_set1_ps(column[2 * aRowStride]);
+        c20 = _mm256_fmadd_ps(ai, b0, c20);
+        c21 = _mm256_fmadd_ps(ai, b1, c21);
+        ai = _mm256_set1_ps(column[3 * aRowStride]);
+        c30 = _mm256_fmadd_ps(ai, b0, c30);
+        c31 = _mm256_fmadd_ps(ai, b1, c31);
+    }
+    __m256 scale = _mm256_set1_ps(static_cast<float>(alpha));
+    avx2StoreTileFloat(c, scale, c00, accumulate);
+    avx2StoreTileFloat(c + 8, scale, c01, accumulate);
+    avx2StoreTileFloat(c + ldc, scale, c10, accumulate);
+    avx2StoreTileFloat(c + ldc + 8, scale, c11, accumulate);
+    avx2StoreTileFloat(c + 2 * ldc, scale, c20, accumulate);
+    avx2StoreTileFloat(c + 2 * ldc + 8, scale, c21, accumulate);
+    avx2StoreTileFloat(c + 3 * ldc, scale, c30, accumulate);
+    avx2StoreTileFloat(c + 3 * ldc + 8, scale, c31, accumulate);
+}
+
+const KernelTable avx2Table = {"avx2", avx2Dot, avx2Axpy, avx2MomentumUpdate,
+                               avx2Logistic, avx2LogisticDerivative, avx2Tanh, avx2TanhDerivative,
+                               avx2DotFloat, avx2AxpyFloat, avx2MomentumUpdateFloat,
+                               avx2LogisticFloat, avx2LogisticDerivativeFloat, avx2TanhFloat, avx2TanhDerivativeFloat,
+                               avx2AxpyMixed, avx2MomentumUpdateMixed,
+                               avx2Dequantise8, avx2Dequantise16, avx2MultiplyInt8, avx2Quantise8,
+                               8, 16, avx2MultiplyTile, avx2MultiplyTileFloat};
+}
+
+const KernelTable* avx2Kernels()
+{
+    return &avx2Table;
+}
+#else
+const KernelTable* avx2Kernels()
+{
+    return NULL;
+}
+#endif
@@ -0,0 +1,614 @@
+#include "../include/kernels.h"
+#include "../include/kernelconstants.h"
+//This file is compiled with AVX-512F enabled (see CMakeLists.txt) and only used if the CPU supports it.
+#ifdef NN_X86_KERNELS
+#include <immintrin.h>
+#include <cmath>
+#include <algorithm>
+#if defined(__GNUC__)
+#define NN_TARGET_VNNI __attribute__((target("avx512vnni")))
+#else
+#define NN_TARGET_VNNI
+#endif
+
+namespace
+{
+//Mask selecting the first n (< 8) lanes, used for the remainders of the loops.
+inline __mmask8 tailMask(unsigned n)
+{
+    return static_cast<__mmask8>((1u << n) - 1);
+}
+
+//Mask selecting the first n (< 16) single precision lanes.
+inline __mmask16 tailMaskFloat(unsigned n)
+{
+    return static_cast<__mmask16>((1u << n) - 1);
+}
+
+double avx512Dot(const double* x, const double* y, unsigned n)
+{
+    __m512d sum0 = _mm512_setzero_pd();
+    __m512d sum1 = _mm512_setzero_pd();
+    __m512d sum2 = _mm512_setzero_pd();
+    __m512d sum3 = _mm512_setzero_pd();
+    unsigned i = 0;
+    for(; i + 32 <= n; i += 32)
+    {
+        sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sum0);
+        sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), sum1);
+        sum2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), sum2);
+        sum3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), sum3);
+    }
+    for(; i + 8 <= n; i += 8)
+    {
+        sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), sum0);
+    }
+    if(i < n)
+    {
+        __mmask8 mask = tailMask(n - i);
+        sum1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i), sum1);
+    }
+    sum0 = _mm512_add_pd(_mm512_add_pd(sum0, sum1), _mm512_add_pd(sum2, sum3));
+    return _mm512_reduce_add_pd(sum0);
+}
+
+void avx512Axpy(double alpha, const double* x, double* y, unsigned n)
+{
+    __m512d a = _mm512_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    if(i < n)
+    {
+        __mmask8 mask = tailMask(n - i);
+        __m512d result = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+        _mm512_mask_storeu_pd(y + i, mask, result);
+    }
+}
+
+void avx512MomentumUpdate(double* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m512d m = _mm512_set1_pd(momentum);
+    __m512d zero = _mm512_setzero_pd();
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m512d delta = _mm512_loadu_pd(deltaWeights + i);
+        __m512d w = _mm512_add_pd(_mm512_loadu_pd(weights + i), delta);
+        _mm512_storeu_pd(weights + i, _mm512_fmadd_pd(m, _mm512_loadu_pd(oldDeltaWeights + i), w));
+        _mm512_storeu_pd(oldDeltaWeights + i, delta);
+        _mm512_storeu_pd(deltaWeights + i, zero);
+    }
+    if(i < n)
+    {
+        __mmask8 mask = tailMask(n - i);
+        __m512d delta = _mm512_maskz_loadu_pd(mask, deltaWeights + i);
+        __m512d w = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, weights + i), delta);
+        _mm512_mask_storeu_pd(weights + i, mask, _mm512_fmadd_pd(m, _mm512_maskz_loadu_pd(mask, oldDeltaWeights + i), w));
+        _mm512_mask_storeu_pd(oldDeltaWeights + i, mask, delta);
+        _mm512_mask_storeu_pd(deltaWeights + i, mask, zero);
+    }
+}
+
+//Vector exponential, see the constants above. 2^n is built directly in the exponent bits.
+inline __m512d avx512Exp(__m512d x)
+{
+    const __m512d magic = _mm512_set1_pd(roundingMagic);
+    x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(-expLimit)), _mm512_set1_pd(expLimit));
+    __m512d n = _mm512_sub_pd(_mm512_fmadd_pd(x, _mm512_set1_pd(log2e), magic), magic);
+    __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2High), x);
+    r = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2Low), r);
+    __m512d rr = _mm512_mul_pd(r, r);
+    __m512d p = _mm512_fmadd_pd(_mm512_set1_pd(expP0), rr, _mm512_set1_pd(expP1));
+    p = _mm512_mul_pd(r, _mm512_fmadd_pd(p, rr, _mm512_set1_pd(expP2)));
+    __m512d q = _mm512_fmadd_pd(_mm512_set1_pd(expQ0), rr, _mm512_set1_pd(expQ1));
+    q = _mm512_fmadd_pd(q, rr, _mm512_set1_pd(expQ2));
+    q = _mm512_fmadd_pd(q, rr, _mm512_set1_pd(expQ3));
+    __m512d e = _mm512_div_pd(p, _mm512_sub_pd(q, p));
+    e = _mm512_add_pd(_mm512_set1_pd(1.0), _mm512_add_pd(e, e));
+    __m512i bits = _mm512_slli_epi64(_mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(roundingMagic + 1023.0))), 52);
+    return _mm512_mul_pd(e, _mm512_castsi512_pd(bits));
+}
+
+void avx512Logistic(double* values, unsigned n, double beta)
+{
+    const __m512d scale = _mm512_set1_pd(-2.0 * beta);
+    const __m512d one = _mm512_set1_pd(1.0);
+    for(unsigned i = 0; i < n; i += 8)
+    {
+        __mmask8 mask = (n - i < 8) ? tailMask(n - i) : static_cast<__mmask8>(0xff);
+        __m512d e = avx512Exp(_mm512_mul_pd(scale, _mm512_maskz_loadu_pd(mask, values + i)));
+        _mm512_mask_storeu_pd(values + i, mask, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+    }
+}
+
+void avx512LogisticDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m512d scale = _mm512_set1_pd(2.0 * beta);
+    const __m512d one = _mm512_set1_pd(1.0);
+    for(unsigned i = 0; i < n; i += 8)
+    {
+        __mmask8 mask = (n - i < 8) ? tailMask(n - i) : static_cast<__mmask8>(0xff);
+        __m512d f = _mm512_maskz_loadu_pd(mask, outputs + i);
+        _mm512_mask_storeu_pd(derivatives + i, mask, _mm512_mul_pd(_mm512_mul_pd(scale, f), _mm512_sub_pd(one, f)));
+    }
+}
+
+void avx512Tanh(double* values, unsigned n, double beta)
+{
+    const __m512d scale = _mm512_set1_pd(2.0 * beta);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d two = _mm512_set1_pd(2.0);
+    for(unsigned i = 0; i < n; i += 8)
+    {
+        __mmask8 mask = (n - i < 8) ? tailMask(n - i) : static_cast<__mmask8>(0xff);
+        __m512d e = avx512Exp(_mm512_mul_pd(scale, _mm512_maskz_loadu_pd(mask, values + i)));
+        _mm512_mask_storeu_pd(values + i, mask, _mm512_sub_pd(one, _mm512_div_pd(two, _mm512_add_pd(e, one))));
+    }
+}
+
+void avx512TanhDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m512d scale = _mm512_set1_pd(beta);
+    const __m512d one = _mm512_set1_pd(1.0);
+    for(unsigned i = 0; i < n; i += 8)
+    {
+        __mmask8 mask = (n - i < 8) ? tailMask(n - i) : static_cast<__mmask8>(0xff);
+        __m512d f = _mm512_maskz_loadu_pd(mask, outputs + i);
+        _mm512_mask_storeu_pd(derivatives + i, mask, _mm512_mul_pd(scale, _mm512_fnmadd_pd(f, f, one)));
+    }
+}
+
+float avx512DotFloat(const float* x, const float* y, unsigned n)
+{
+    __m512 sum0 = _mm512_setzero_ps();
+    __m512 sum1 = _mm512_setzero_ps();
+    __m512 sum2 = _mm512_setzero_ps();
+    __m512 sum3 = _mm512_setzero_ps();
+    unsigned i = 0;
+    for(; i + 64 <= n; i += 64)
+    {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), sum0);
+        sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), sum1);
+        sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), sum2);
+        sum3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), sum3);
+    }
+    for(; i + 16 <= n; i += 16)
+    {
+        sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), sum0);
+    }
+    if(i < n)
+    {
+        __mmask16 mask = tailMaskFloat(n - i);
+        sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i), sum1);
+    }
+    sum0 = _mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3));
+    return _mm512_reduce_add_ps(sum0);
+}
+
+void avx512AxpyFloat(double alpha, const float* x, float* y, unsigned n)
+{
+    __m512 a = _mm512_set1_ps(static_cast<float>(alpha));
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 result = _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i));
+        _mm512_mask_storeu_ps(y + i, mask, result);
+    }
+}
+
+void avx512MomentumUpdateFloat(float* weights, float* deltaWeights, float* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m512 m = _mm512_set1_ps(static_cast<float>(momentum));
+    __m512 zero = _mm512_setzero_ps();
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 delta = _mm512_maskz_loadu_ps(mask, deltaWeights + i);
+        __m512 w = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, weights + i), delta);
+        _mm512_mask_storeu_ps(weights + i, mask, _mm512_fmadd_ps(m, _mm512_maskz_loadu_ps(mask, oldDeltaWeights + i), w));
+        _mm512_mask_storeu_ps(oldDeltaWeights + i, mask, delta);
+        _mm512_mask_storeu_ps(deltaWeights + i, mask, zero);
+    }
+}
+
+//Single precision vector exponential, see the constants above.
+inline __m512 avx512ExpFloat(__m512 x)
+{
+    x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(-expLimitFloat)), _mm512_set1_ps(expLimitFloat));
+    __m512i ni = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(log2eFloat)));
+    __m512 n = _mm512_cvtepi32_ps(ni);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2HighFloat), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2LowFloat), r);
+    __m512 p = _mm512_fmadd_ps(_mm512_set1_ps(expPFloat0), r, _mm512_set1_ps(expPFloat1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expPFloat2));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expPFloat3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expPFloat4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(expPFloat5));
+    __m512 e = _mm512_add_ps(_mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r), _mm512_set1_ps(1.0f));
+    __m512i bits = _mm512_slli_epi32(_mm512_add_epi32(ni, _mm512_set1_epi32(127)), 23);
+    return _mm512_mul_ps(e, _mm512_castsi512_ps(bits));
+}
+
+void avx512LogisticFloat(float* values, unsigned n, double beta)
+{
+    const __m512 scale = _mm512_set1_ps(static_cast<float>(-2.0 * beta));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 e = avx512ExpFloat(_mm512_mul_ps(scale, _mm512_maskz_loadu_ps(mask, values + i)));
+        _mm512_mask_storeu_ps(values + i, mask, _mm512_div_ps(one, _mm512_add_ps(one, e)));
+    }
+}
+
+void avx512LogisticDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const __m512 scale = _mm512_set1_ps(static_cast<float>(2.0 * beta));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 f = _mm512_maskz_loadu_ps(mask, outputs + i);
+        _mm512_mask_storeu_ps(derivatives + i, mask, _mm512_mul_ps(_mm512_mul_ps(scale, f), _mm512_sub_ps(one, f)));
+    }
+}
+
+void avx512TanhFloat(float* values, unsigned n, double beta)
+{
+    const __m512 scale = _mm512_set1_ps(2.0f * static_cast<float>(beta));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 e = avx512ExpFloat(_mm512_mul_ps(scale, _mm512_maskz_loadu_ps(mask, values + i)));
+        _mm512_mask_storeu_ps(values + i, mask, _mm512_sub_ps(one, _mm512_div_ps(two, _mm512_add_ps(e, one))));
+    }
+}
+
+void avx512TanhDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const __m512 scale = _mm512_set1_ps(static_cast<float>(beta));
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for(unsigned i = 0; i < n; i += 16)
+    {
+        __mmask16 mask = (n - i < 16) ? tailMaskFloat(n - i) : static_cast<__mmask16>(0xffff);
+        __m512 f = _mm512_maskz_loadu_ps(mask, outputs + i);
+        _mm512_mask_storeu_ps(derivatives + i, mask, _mm512_mul_ps(scale, _mm512_fnmadd_ps(f, f, one)));
+    }
+}
+
+//The mixed precision kernels widen 8 single precision values into a double precision vector.
+//The single precision remainders are loaded and stored through 16 lane masks, which
+//AVX-512F provides only on full registers.
+inline __m512d avx512LoadWidened(__mmask8 mask, const float* x)
+{
+    return _mm512_cvtps_pd(_mm512_castps512_ps256(_mm512_maskz_loadu_ps(static_cast<__mmask16>(mask), x)));
+}
+
+void avx512AxpyMixed(double alpha, const float* x, double* y, unsigned n)
+{
+    __m512d a = _mm512_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_cvtps_pd(_mm256_loadu_ps(x + i)), _mm512_loadu_pd(y + i)));
+    }
+    if(i < n)
+    {
+        __mmask8 mask = tailMask(n - i);
+        __m512d result = _mm512_fmadd_pd(a, avx512LoadWidened(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+        _mm512_mask_storeu_pd(y + i, mask, result);
+    }
+}
+
+void avx512MomentumUpdateMixed(float* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m512d m = _mm512_set1_pd(momentum);
+    __m512d zero = _mm512_setzero_pd();
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m512d delta = _mm512_loadu_pd(deltaWeights + i);
+        __m512d w = _mm512_add_pd(_mm512_cvtps_pd(_mm256_loadu_ps(weights + i)), delta);
+        w = _mm512_fmadd_pd(m, _mm512_loadu_pd(oldDeltaWeights + i), w);
+        _mm256_storeu_ps(weights + i, _mm512_cvtpd_ps(w));
+        _mm512_storeu_pd(oldDeltaWeights + i, delta);
+        _mm512_storeu_pd(deltaWeights + i, zero);
+    }
+    if(i < n)
+    {
+        __mmask8 mask = tailMask(n - i);
+        __m512d delta = _mm512_maskz_loadu_pd(mask, deltaWeights + i);
+        __m512d w = _mm512_add_pd(avx512LoadWidened(mask, weights + i), delta);
+        w = _mm512_fmadd_pd(m, _mm512_maskz_loadu_pd(mask, oldDeltaWeights + i), w);
+        _mm512_mask_storeu_ps(weights + i, static_cast<__mmask16>(mask), _mm512_castps256_ps512(_mm512_cvtpd_ps(w)));
+        _mm512_mask_storeu_pd(oldDeltaWeights + i, mask, delta);
+        _mm512_mask_storeu_pd(deltaWeights + i, mask, zero);
+    }
+}
+
+void avx512Dequantise8(const std::uint8_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i));
+        __m512d converted = _mm512_cvtepi32_pd(_mm256_cvtepu8_epi32(bytes));
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(converted, _mm512_loadu_pd(scales + i), _mm512_loadu_pd(shifts + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+void avx512Dequantise16(const std::uint16_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        __m512d converted = _mm512_cvtepi32_pd(_mm256_cvtepu16_epi32(words));
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(converted, _mm512_loadu_pd(scales + i), _mm512_loadu_pd(shifts + i)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+//Sums the products of 16 bytes, widened to 32 bits with AVX-512F only.
+inline __m512i avx512MultiplyBytes(const std::uint8_t* x, const std::int8_t* y)
+{
+    __m512i xWide = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+    __m512i yWide = _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y)));
+    return _mm512_mullo_epi32(xWide, yWide);
+}
+
+std::int32_t avx512DotInt8(const std::uint8_t* x, const std::int8_t* y, unsigned n)
+{
+    __m512i sum = _mm512_setzero_si512();
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        sum = _mm512_add_epi32(sum, avx512MultiplyBytes(x + i, y + i));
+    }
+    std::int32_t total = _mm512_reduce_add_epi32(sum);
+    for(; i < n; ++i)
+    {
+        total += static_cast<std::int32_t>(x[i]) * y[i];
+    }
+    return total;
+}
+
+void avx512MultiplyInt8(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y)
+{
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        y[row] = scales[row] * avx512DotInt8(x, weights + row * stride, n) + biases[row];
+    }
+}
+
+//The VNNI instruction multiplies 64 pairs of bytes, and adds each group of four products
+//to a 32 bit sum, exactly. Only this function is compiled for VNNI, and only called if the
+//CPU supports it.
+NN_TARGET_VNNI std::int32_t avx512VnniDotInt8(const std::uint8_t* x, const std::int8_t* y, unsigned n)
+{
+    __m512i sum = _mm512_setzero_si512();
+    unsigned i = 0;
+    for(; i + 64 <= n; i += 64)
+    {
+        sum = _mm512_dpbusd_epi32(sum, _mm512_loadu_si512(x + i), _mm512_loadu_si512(y + i));
+    }
+    for(; i + 16 <= n; i += 16)
+    {
+        sum = _mm512_add_epi32(sum, avx512MultiplyBytes(x + i, y + i));
+    }
+    std::int32_t total = _mm512_reduce_add_epi32(sum);
+    for(; i < n; ++i)
+    {
+        total += static_cast<std::int32_t>(x[i]) * y[i];
+    }
+    return total;
+}
+
+//Four rows are multiplied at a time, and their sums reduced together.
+NN_TARGET_VNNI void avx512VnniMultiplyInt8(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y)
+{
+    unsigned row = 0;
+    for(; row + 4 <= nRows; row += 4)
+    {
+        const std::int8_t* w = weights + row * stride;
+        __m512i sum0 = _mm512_setzero_si512();
+        __m512i sum1 = _mm512_setzero_si512();
+        __m512i sum2 = _mm512_setzero_si512();
+        __m512i sum3 = _mm512_setzero_si512();
+        unsigned i = 0;
+        for(; i + 64 <= n; i += 64)
+        {
+            __m512i bytes = _mm512_loadu_si512(x + i);
+            sum0 = _mm512_dpbusd_epi32(sum0, bytes, _mm512_loadu_si512(w + i));
+            sum1 = _mm512_dpbusd_epi32(sum1, bytes, _mm512_loadu_si512(w + stride + i));
+            sum2 = _mm512_dpbusd_epi32(sum2, bytes, _mm512_loadu_si512(w + 2 * stride + i));
+            sum3 = _mm512_dpbusd_epi32(sum3, bytes, _mm512_loadu_si512(w + 3 * stride + i));
+        }
+        //Interleaving the sums leaves in each 128 bit lane a partial sum of each row.
+        __m512i sum01 = _mm512_add_epi32(_mm512_unpacklo_epi32(sum0, sum1), _mm512_unpackhi_epi32(sum0, sum1));
+        __m512i sum23 = _mm512_add_epi32(_mm512_unpacklo_epi32(sum2, sum3), _mm512_unpackhi_epi32(sum2, sum3));
+        __m512i lanes = _mm512_add_epi32(_mm512_unpacklo_epi64(sum01, sum23), _mm512_unpackhi_epi64(sum01, sum23));
+        __m256i half = _mm256_add_epi32(_mm512_castsi512_si256(lanes), _mm512_extracti64x4_epi64(lanes, 1));
+        __m128i quarter = _mm_add_epi32(_mm256_castsi256_si128(half), _mm256_extracti128_si256(half, 1));
+        std::int32_t totals[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(totals), quarter);
+        for(unsigned r = 0; r < 4; ++r)
+        {
+            for(unsigned j = i; j < n; ++j)
+            {
+                totals[r] += static_cast<std::int32_t>(x[j]) * w[r * stride + j];
+            }
+            y[row + r] = scales[row + r] * totals[r] + biases[row + r];
+        }
+    }
+    for(; row < nRows; ++row)
+    {
+        y[row] = scales[row] * avx512VnniDotInt8(x, weights + row * stride, n) + biases[row];
+    }
+}
+
+inline __m256i avx512Levels(const double* x, const double* inverseSteps, const double* shifts)
+{
+    __m512d level = _mm512_fmadd_pd(_mm512_loadu_pd(x), _mm512_loadu_pd(inverseSteps), _mm512_loadu_pd(shifts));
+    level = _mm512_min_pd(_mm512_max_pd(level, _mm512_setzero_pd()), _mm512_set1_pd(255.0));
+    return _mm512_cvtpd_epi32(level);
+}
+
+void avx512Quantise8(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n)
+{
+    //Eight levels are converted at a time, and 16 narrowed to bytes.
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i levels = _mm512_inserti64x4(_mm512_castsi256_si512(avx512Levels(x + i, inverseSteps + i, shifts + i)),
+                                            avx512Levels(x + i + 8, inverseSteps + i + 8, shifts + i + 8), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm512_cvtepi32_epi8(levels));
+    }
+    for(; i < n; ++i)
+    {
+        double level = std::min(255.0, std::max(0.0, x[i] * inverseSteps[i] + shifts[i]));
+        values[i] = static_cast<std::uint8_t>(std::nearbyint(level));
+    }
+}
+
+//Tiles of 4 rows of 2 vectors of C, as in the AVX2 kernels.
+inline void avx512StoreTile(double* entries, __m512d scale, __m512d sum, bool accumulate)
+{
+    _mm512_storeu_pd(entries, accumulate ? _mm512_fmadd_pd(scale, sum, _mm512_loadu_pd(entries)) : _mm512_mul_pd(scale, sum));
+}
+
+inline void avx512StoreTileFloat(float* entries, __m512 scale, __m512 sum, bool accumulate)
+{
+    _mm512_storeu_ps(entries, accumulate ? _mm512_fmadd_ps(scale, sum, _mm512_loadu_ps(entries)) : _mm512_mul_ps(scale, sum));
+}
+
+void avx512MultiplyTile(const double* a, unsigned aRowStride, unsigned aColumnStride, const double* b, unsigned ldb, double* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m512d c00 = _mm512_setzero_pd();
+    __m512d c01 = _mm512_setzero_pd();
+    __m512d c10 = _mm512_setzero_pd();
+    __m512d c11 = _mm512_setzero_pd();
+    __m512d c20 = _mm512_setzero_pd();
+    __m512d c21 = _mm512_setzero_pd();
+    __m512d c30 = _mm512_setzero_pd();
+    __m512d c31 = _mm512_setzero_pd();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const double* bRow = b + p * ldb;
+        const double* column = a + p * aColumnStride;
+        __m512d b0 = _mm512_loadu_pd(bRow);
+        __m512d b1 = _mm512_loadu_pd(bRow + 8);
+        __m512d ai = _mm512_set1_pd(column[0]);
+        c00 = _mm512_fmadd_pd(ai, b0, c00);
+        c01 = _mm512_fmadd_pd(ai, b1, c01);
+        ai = _mm512_set1_pd(column[aRowStride]);
+        c10 = _mm512_fmadd_pd(ai, b0, c10);
+        c11 = _mm512_fmadd_pd(ai, b1, c11);
+        ai = _mm512_set1_pd(column[2 * aRowStride]);
+        c20 = _mm512_fmadd_pd(ai, b0, c20);
+        c21 = _mm512_fmadd_pd(ai, b1, c21);
+        ai = _mm512_set1_pd(column[3 * aRowStride]);
+        c30 = _mm512_fmadd_pd(ai, b0, c30);
+        c31 = _mm512_fmadd_pd(ai, b1, c31);
+    }
+    __m512d scale = _mm512_set1_pd(alpha);
+    avx512StoreTile(c, scale, c00, accumulate);
+    avx512StoreTile(c + 8, scale, c01, accumulate);
+    avx512StoreTile(c + ldc, scale, c10, accumulate);
+    avx512StoreTile(c + ldc + 8, scale, c11, accumulate);
+    avx512StoreTile(c + 2 * ldc, scale, c20, accumulate);
+    avx512StoreTile(c + 2 * ldc + 8, scale, c21, accumulate);
+    avx512StoreTile(c + 3 * ldc, scale, c30, accumulate);
+    avx512StoreTile(c + 3 * ldc + 8, scale, c31, accumulate);
+}
+
+void avx512MultiplyTileFloat(const float* a, unsigned aRowStride, unsigned aColumnStride, const float* b, unsigned ldb, float* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m512 c00 = _mm512_setzero_ps();
+    __m512 c01 = _mm512_setzero_ps();
+    __m512 c10 = _mm512_setzero_ps();
+    __m512 c11 = _mm512_setzero_ps();
+    __m512 c20 = _mm512_setzero_ps();
+    __m512 c21 = _mm512_setzero_ps();
+    __m512 c30 = _mm512_setzero_ps();
+    __m512 c31 = _mm512_setzero_ps();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const float* bRow = b + p * ldb;
+        const float* column = a + p * aColumnStride;
+        __m512 b0 = _mm512_loadu_ps(bRow);
+        __m512 b1 = _mm512_loadu_ps(bRow + 16);
+        __m512 ai = _mm512_set1_ps(column[0]);
+        c00 = _mm512_fmadd_ps(ai, b0, c00);
+        c01 = _mm512_fmadd_ps(ai, b1, c01);
+        ai = _mm512_set1_ps(column[aRowStride]);
+        c10 = _mm512_fmadd_ps(ai, b0, c10);
+        c11 = _mm512_fmadd_ps(ai, b1, c11);
+        ai = _mm512_set1_ps(column[2 * aRowStride]);
+        c20 = _mm512_fmadd_ps(ai, b0, c20);
+        c21 = _mm512_fmadd_ps(ai, b1, c21);
+        ai = _mm512_set1_ps(column[3 * aRowStride]);
+        c30 = _mm512_fmadd_ps(ai, b0, c30);
+        c31 = _mm512_fmadd_ps(ai, b1, c31);
+    }
+    __m512 scale = _mm512_set1_ps(static_cast<float>(alpha));
+    avx512StoreTileFloat(c, scale, c00, accumulate);
+    avx512StoreTileFloat(c + 16, scale, c01, accumulate);
+    avx512StoreTileFloat(c + ldc, scale, c10, accumulate);
+    avx512StoreTileFloat(c + ldc + 16, scale, c11, accumulate);
+    avx512StoreTileFloat(c + 2 * ldc, scale, c20, accumulate);
+    avx512StoreTileFloat(c + 2 * ldc + 16, scale, c21, accumulate);
+    avx512StoreTileFloat(c + 3 * ldc, scale, c30, accumulate);
+    avx512StoreTileFloat(c + 3 * ldc + 16, scale, c31, accumulate);
+}
+
+const KernelTable avx512Table = {"avx512", avx512Dot, avx512Axpy, avx512MomentumUpdate,
+                                 avx512Logistic, avx512LogisticDerivative, avx512Tanh, avx512TanhDerivative,
+                                 avx512DotFloat, avx512AxpyFloat, avx512MomentumUpdateFloat,
+                                 avx512LogisticFloat, avx512LogisticDerivativeFloat, avx512TanhFloat, avx512TanhDerivativeFloat,
+                                 avx512AxpyMixed, avx512MomentumUpdateMixed,
+                                 avx512Dequantise8, avx512Dequantise16, avx512MultiplyInt8, avx512Quantise8,
+                                 16, 32, avx512MultiplyTile, avx512MultiplyTileFloat};
+
+//The same kernels, with the VNNI integer dot product.
+const KernelTable avx512VnniTable = {"avx512vnni", avx512Dot, avx512Axpy, avx512MomentumUpdate,
+                                     avx512Logistic, avx512LogisticDerivative, avx512Tanh, avx512TanhDerivative,
+                                     avx512DotFloat, avx512AxpyFloat, avx512MomentumUpdateFloat,
+                                     avx512LogisticFloat, avx512LogisticDerivativeFloat, avx512TanhFloat, avx512TanhDerivativeFloat,
+                                     avx512AxpyMixed, avx512MomentumUpdateMixed,
+                                     avx512Dequantise8, avx512Dequantise16, avx512VnniMultiplyInt8, avx512Quantise8,
+                                     16, 32, avx512MultiplyTile, avx512MultiplyTileFloat};
+}
+
+const KernelTable* avx512Kernels()
+{
+    return &avx512Table;
+}
+
+const KernelTable* avx512VnniKernels()
+{
+    return &avx512VnniTable;
+}
+#else
+const KernelTable* avx512Kernels()
+{
+    return NULL;
+}
+
+const KernelTable* avx512VnniKernels()
+{
+    return NULL;
+}
+#endif
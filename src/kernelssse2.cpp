@@ -0,0 +1,559 @@
+#include "../include/kernels.h"
+#include "../include/kernelconstants.h"
+//This file is compiled with SSE2 enabled (see CMakeLists.txt) and only used if the CPU supports it.
+#ifdef NN_X86_KERNELS
+#include <emmintrin.h>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+double sse2Dot(const double* x, const double* y, unsigned n)
+{
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    sum0 = _mm_add_pd(sum0, sum1);
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum0);
+    double sum = lanes[0] + lanes[1];
+    for(; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void sse2Axpy(double alpha, const double* x, double* y, unsigned n)
+{
+    __m128d a = _mm_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+void sse2MomentumUpdate(double* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m128d m = _mm_set1_pd(momentum);
+    __m128d zero = _mm_setzero_pd();
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d delta = _mm_loadu_pd(deltaWeights + i);
+        __m128d w = _mm_add_pd(_mm_loadu_pd(weights + i), delta);
+        _mm_storeu_pd(weights + i, _mm_add_pd(w, _mm_mul_pd(m, _mm_loadu_pd(oldDeltaWeights + i))));
+        _mm_storeu_pd(oldDeltaWeights + i, delta);
+        _mm_storeu_pd(deltaWeights + i, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = weights[i] + deltaWeights[i] + momentum * oldDeltaWeights[i];
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0;
+    }
+}
+
+//Vector exponential, see the constants above. 2^n is built directly in the exponent bits.
+inline __m128d sse2Exp(__m128d x)
+{
+    const __m128d magic = _mm_set1_pd(roundingMagic);
+    x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(-expLimit)), _mm_set1_pd(expLimit));
+    __m128d n = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(log2e)), magic), magic);
+    __m128d r = _mm_sub_pd(x, _mm_mul_pd(n, _mm_set1_pd(ln2High)));
+    r = _mm_sub_pd(r, _mm_mul_pd(n, _mm_set1_pd(ln2Low)));
+    __m128d rr = _mm_mul_pd(r, r);
+    __m128d p = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(expP0), rr), _mm_set1_pd(expP1));
+    p = _mm_mul_pd(r, _mm_add_pd(_mm_mul_pd(p, rr), _mm_set1_pd(expP2)));
+    __m128d q = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(expQ0), rr), _mm_set1_pd(expQ1));
+    q = _mm_add_pd(_mm_mul_pd(q, rr), _mm_set1_pd(expQ2));
+    q = _mm_add_pd(_mm_mul_pd(q, rr), _mm_set1_pd(expQ3));
+    __m128d e = _mm_div_pd(p, _mm_sub_pd(q, p));
+    e = _mm_add_pd(_mm_set1_pd(1.0), _mm_add_pd(e, e));
+    __m128i bits = _mm_slli_epi64(_mm_castpd_si128(_mm_add_pd(n, _mm_set1_pd(roundingMagic + 1023.0))), 52);
+    return _mm_mul_pd(e, _mm_castsi128_pd(bits));
+}
+
+void sse2Logistic(double* values, unsigned n, double beta)
+{
+    const __m128d scale = _mm_set1_pd(-2.0 * beta);
+    const __m128d one = _mm_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d e = sse2Exp(_mm_mul_pd(scale, _mm_loadu_pd(values + i)));
+        _mm_storeu_pd(values + i, _mm_div_pd(one, _mm_add_pd(one, e)));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = 1.0 / (1.0 + std::exp(-2.0 * beta * values[i]));
+    }
+}
+
+void sse2LogisticDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m128d scale = _mm_set1_pd(2.0 * beta);
+    const __m128d one = _mm_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d f = _mm_loadu_pd(outputs + i);
+        _mm_storeu_pd(derivatives + i, _mm_mul_pd(_mm_mul_pd(scale, f), _mm_sub_pd(one, f)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = 2.0 * beta * outputs[i] * (1.0 - outputs[i]);
+    }
+}
+
+void sse2Tanh(double* values, unsigned n, double beta)
+{
+    const __m128d scale = _mm_set1_pd(2.0 * beta);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d two = _mm_set1_pd(2.0);
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d e = sse2Exp(_mm_mul_pd(scale, _mm_loadu_pd(values + i)));
+        _mm_storeu_pd(values + i, _mm_sub_pd(one, _mm_div_pd(two, _mm_add_pd(e, one))));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = std::tanh(beta * values[i]);
+    }
+}
+
+void sse2TanhDerivative(const double* outputs, double* derivatives, unsigned n, double beta)
+{
+    const __m128d scale = _mm_set1_pd(beta);
+    const __m128d one = _mm_set1_pd(1.0);
+    unsigned i = 0;
+    for(; i + 2 <= n; i += 2)
+    {
+        __m128d f = _mm_loadu_pd(outputs + i);
+        _mm_storeu_pd(derivatives + i, _mm_mul_pd(scale, _mm_sub_pd(one, _mm_mul_pd(f, f))));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = beta * (1.0 - outputs[i] * outputs[i]);
+    }
+}
+
+float sse2DotFloat(const float* x, const float* y, unsigned n)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    unsigned i = 0;
+    for(; i + 8 <= n; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(y + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(y + i + 4)));
+    }
+    sum0 = _mm_add_ps(sum0, sum1);
+    float lanes[4];
+    _mm_storeu_ps(lanes, sum0);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for(; i < n; ++i)
+    {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void sse2AxpyFloat(double alpha, const float* x, float* y, unsigned n)
+{
+    const float af = static_cast<float>(alpha);
+    __m128 a = _mm_set1_ps(af);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(a, _mm_loadu_ps(x + i))));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += af * x[i];
+    }
+}
+
+void sse2MomentumUpdateFloat(float* weights, float* deltaWeights, float* oldDeltaWeights, double momentum, unsigned n)
+{
+    const float mf = static_cast<float>(momentum);
+    __m128 m = _mm_set1_ps(mf);
+    __m128 zero = _mm_setzero_ps();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 delta = _mm_loadu_ps(deltaWeights + i);
+        __m128 w = _mm_add_ps(_mm_loadu_ps(weights + i), delta);
+        _mm_storeu_ps(weights + i, _mm_add_ps(w, _mm_mul_ps(m, _mm_loadu_ps(oldDeltaWeights + i))));
+        _mm_storeu_ps(oldDeltaWeights + i, delta);
+        _mm_storeu_ps(deltaWeights + i, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = weights[i] + deltaWeights[i] + mf * oldDeltaWeights[i];
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0f;
+    }
+}
+
+//Single precision vector exponential, see the constants above.
+inline __m128 sse2ExpFloat(__m128 x)
+{
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-expLimitFloat)), _mm_set1_ps(expLimitFloat));
+    __m128i ni = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(log2eFloat)));
+    __m128 n = _mm_cvtepi32_ps(ni);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(ln2HighFloat)));
+    r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(ln2LowFloat)));
+    __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(expPFloat0), r), _mm_set1_ps(expPFloat1));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expPFloat2));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expPFloat3));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expPFloat4));
+    p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(expPFloat5));
+    __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r), _mm_set1_ps(1.0f));
+    __m128i bits = _mm_slli_epi32(_mm_add_epi32(ni, _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(e, _mm_castsi128_ps(bits));
+}
+
+void sse2LogisticFloat(float* values, unsigned n, double beta)
+{
+    const float sf = static_cast<float>(-2.0 * beta);
+    const __m128 scale = _mm_set1_ps(sf);
+    const __m128 one = _mm_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 e = sse2ExpFloat(_mm_mul_ps(scale, _mm_loadu_ps(values + i)));
+        _mm_storeu_ps(values + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = 1.0f / (1.0f + std::exp(sf * values[i]));
+    }
+}
+
+void sse2LogisticDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const float sf = static_cast<float>(2.0 * beta);
+    const __m128 scale = _mm_set1_ps(sf);
+    const __m128 one = _mm_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 f = _mm_loadu_ps(outputs + i);
+        _mm_storeu_ps(derivatives + i, _mm_mul_ps(_mm_mul_ps(scale, f), _mm_sub_ps(one, f)));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = sf * outputs[i] * (1.0f - outputs[i]);
+    }
+}
+
+void sse2TanhFloat(float* values, unsigned n, double beta)
+{
+    const float bf = static_cast<float>(beta);
+    const __m128 scale = _mm_set1_ps(2.0f * bf);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 e = sse2ExpFloat(_mm_mul_ps(scale, _mm_loadu_ps(values + i)));
+        _mm_storeu_ps(values + i, _mm_sub_ps(one, _mm_div_ps(two, _mm_add_ps(e, one))));
+    }
+    for(; i < n; ++i)
+    {
+        values[i] = std::tanh(bf * values[i]);
+    }
+}
+
+void sse2TanhDerivativeFloat(const float* outputs, float* derivatives, unsigned n, double beta)
+{
+    const float bf = static_cast<float>(beta);
+    const __m128 scale = _mm_set1_ps(bf);
+    const __m128 one = _mm_set1_ps(1.0f);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 f = _mm_loadu_ps(outputs + i);
+        _mm_storeu_ps(derivatives + i, _mm_mul_ps(scale, _mm_sub_ps(one, _mm_mul_ps(f, f))));
+    }
+    for(; i < n; ++i)
+    {
+        derivatives[i] = bf * (1.0f - outputs[i] * outputs[i]);
+    }
+}
+
+//The mixed precision kernels widen 4 single precision values into two double precision vectors.
+void sse2AxpyMixed(double alpha, const float* x, double* y, unsigned n)
+{
+    __m128d a = _mm_set1_pd(alpha);
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 xf = _mm_loadu_ps(x + i);
+        __m128d low = _mm_cvtps_pd(xf);
+        __m128d high = _mm_cvtps_pd(_mm_movehl_ps(xf, xf));
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, low)));
+        _mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(a, high)));
+    }
+    for(; i < n; ++i)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+void sse2MomentumUpdateMixed(float* weights, double* deltaWeights, double* oldDeltaWeights, double momentum, unsigned n)
+{
+    __m128d m = _mm_set1_pd(momentum);
+    __m128d zero = _mm_setzero_pd();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 wf = _mm_loadu_ps(weights + i);
+        __m128d delta0 = _mm_loadu_pd(deltaWeights + i);
+        __m128d delta1 = _mm_loadu_pd(deltaWeights + i + 2);
+        __m128d w0 = _mm_add_pd(_mm_cvtps_pd(wf), delta0);
+        __m128d w1 = _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(wf, wf)), delta1);
+        w0 = _mm_add_pd(w0, _mm_mul_pd(m, _mm_loadu_pd(oldDeltaWeights + i)));
+        w1 = _mm_add_pd(w1, _mm_mul_pd(m, _mm_loadu_pd(oldDeltaWeights + i + 2)));
+        _mm_storeu_ps(weights + i, _mm_movelh_ps(_mm_cvtpd_ps(w0), _mm_cvtpd_ps(w1)));
+        _mm_storeu_pd(oldDeltaWeights + i, delta0);
+        _mm_storeu_pd(oldDeltaWeights + i + 2, delta1);
+        _mm_storeu_pd(deltaWeights + i, zero);
+        _mm_storeu_pd(deltaWeights + i + 2, zero);
+    }
+    for(; i < n; ++i)
+    {
+        weights[i] = static_cast<float>(weights[i] + deltaWeights[i] + momentum * oldDeltaWeights[i]);
+        oldDeltaWeights[i] = deltaWeights[i];
+        deltaWeights[i] = 0.0;
+    }
+}
+
+//Converts four 32 bit integers to double precision, and scales and shifts them.
+inline void sse2Dequantise4(__m128i ints, const double* scales, const double* shifts, double* y)
+{
+    __m128d low = _mm_cvtepi32_pd(ints);
+    __m128d high = _mm_cvtepi32_pd(_mm_shuffle_epi32(ints, _MM_SHUFFLE(1, 0, 3, 2)));
+    _mm_storeu_pd(y, _mm_add_pd(_mm_mul_pd(low, _mm_loadu_pd(scales)), _mm_loadu_pd(shifts)));
+    _mm_storeu_pd(y + 2, _mm_add_pd(_mm_mul_pd(high, _mm_loadu_pd(scales + 2)), _mm_loadu_pd(shifts + 2)));
+}
+
+void sse2Dequantise8(const std::uint8_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        std::int32_t packed;
+        std::memcpy(&packed, values + i, sizeof(packed));
+        __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+        sse2Dequantise4(_mm_unpacklo_epi16(words, zero), scales + i, shifts + i, y + i);
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+void sse2Dequantise16(const std::uint16_t* values, const double* scales, const double* shifts, double* y, unsigned n)
+{
+    __m128i zero = _mm_setzero_si128();
+    unsigned i = 0;
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(values + i));
+        sse2Dequantise4(_mm_unpacklo_epi16(words, zero), scales + i, shifts + i, y + i);
+    }
+    for(; i < n; ++i)
+    {
+        y[i] = values[i] * scales[i] + shifts[i];
+    }
+}
+
+std::int32_t sse2DotInt8(const std::uint8_t* x, const std::int8_t* y, unsigned n)
+{
+    //The bytes are widened to 16 bits (the signed ones by interleaving them with themselves
+    //and shifting back), and the products summed in pairs into 32 bits, without overflow.
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i xBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+        __m128i yBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+        __m128i yLow = _mm_srai_epi16(_mm_unpacklo_epi8(yBytes, yBytes), 8);
+        __m128i yHigh = _mm_srai_epi16(_mm_unpackhi_epi8(yBytes, yBytes), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(xBytes, zero), yLow));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(xBytes, zero), yHigh));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    std::int32_t total = _mm_cvtsi128_si32(sum);
+    for(; i < n; ++i)
+    {
+        total += static_cast<std::int32_t>(x[i]) * y[i];
+    }
+    return total;
+}
+
+void sse2MultiplyInt8(const std::uint8_t* x, const std::int8_t* weights, unsigned stride, unsigned nRows, unsigned n, const double* scales, const double* biases, double* y)
+{
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        y[row] = scales[row] * sse2DotInt8(x, weights + row * stride, n) + biases[row];
+    }
+}
+
+//Two levels are converted at a time, and 16 packed to bytes with unsigned saturation.
+inline __m128i sse2Levels(const double* x, const double* inverseSteps, const double* shifts)
+{
+    __m128d level = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(x), _mm_loadu_pd(inverseSteps)), _mm_loadu_pd(shifts));
+    level = _mm_min_pd(_mm_max_pd(level, _mm_setzero_pd()), _mm_set1_pd(255.0));
+    return _mm_cvtpd_epi32(level);
+}
+
+inline __m128i sse2Levels4(const double* x, const double* inverseSteps, const double* shifts)
+{
+    return _mm_unpacklo_epi64(sse2Levels(x, inverseSteps, shifts), sse2Levels(x + 2, inverseSteps + 2, shifts + 2));
+}
+
+void sse2Quantise8(const double* x, const double* inverseSteps, const double* shifts, std::uint8_t* values, unsigned n)
+{
+    unsigned i = 0;
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i low = _mm_packs_epi32(sse2Levels4(x + i, inverseSteps + i, shifts + i), sse2Levels4(x + i + 4, inverseSteps + i + 4, shifts + i + 4));
+        __m128i high = _mm_packs_epi32(sse2Levels4(x + i + 8, inverseSteps + i + 8, shifts + i + 8), sse2Levels4(x + i + 12, inverseSteps + i + 12, shifts + i + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_packus_epi16(low, high));
+    }
+    for(; i < n; ++i)
+    {
+        double level = std::min(255.0, std::max(0.0, x[i] * inverseSteps[i] + shifts[i]));
+        values[i] = static_cast<std::uint8_t>(std::nearbyint(level));
+    }
+}
+
+//Tiles of 4 rows of 2 vectors of C, accumulated in 8 registers: each row of B is loaded
+//once for the 4 rows, and each entry of A once for the 2 vectors.
+inline void sse2StoreTile(double* entries, __m128d scale, __m128d sum, bool accumulate)
+{
+    _mm_storeu_pd(entries, accumulate ? _mm_add_pd(_mm_loadu_pd(entries), _mm_mul_pd(scale, sum)) : _mm_mul_pd(scale, sum));
+}
+
+inline void sse2StoreTileFloat(float* entries, __m128 scale, __m128 sum, bool accumulate)
+{
+    _mm_storeu_ps(entries, accumulate ? _mm_add_ps(_mm_loadu_ps(entries), _mm_mul_ps(scale, sum)) : _mm_mul_ps(scale, sum));
+}
+
+void sse2MultiplyTile(const double* a, unsigned aRowStride, unsigned aColumnStride, const double* b, unsigned ldb, double* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m128d c00 = _mm_setzero_pd();
+    __m128d c01 = _mm_setzero_pd();
+    __m128d c10 = _mm_setzero_pd();
+    __m128d c11 = _mm_setzero_pd();
+    __m128d c20 = _mm_setzero_pd();
+    __m128d c21 = _mm_setzero_pd();
+    __m128d c30 = _mm_setzero_pd();
+    __m128d c31 = _mm_setzero_pd();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const double* bRow = b + p * ldb;
+        const double* column = a + p * aColumnStride;
+        __m128d b0 = _mm_loadu_pd(bRow);
+        __m128d b1 = _mm_loadu_pd(bRow + 2);
+        __m128d ai = _mm_set1_pd(column[0]);
+        c00 = _mm_add_pd(c00, _mm_mul_pd(ai, b0));
+        c01 = _mm_add_pd(c01, _mm_mul_pd(ai, b1));
+        ai = _mm_set1_pd(column[aRowStride]);
+        c10 = _mm_add_pd(c10, _mm_mul_pd(ai, b0));
+        c11 = _mm_add_pd(c11, _mm_mul_pd(ai, b1));
+        ai = _mm_set1_pd(column[2 * aRowStride]);
+        c20 = _mm_add_pd(c20, _mm_mul_pd(ai, b0));
+        c21 = _mm_add_pd(c21, _mm_mul_pd(ai, b1));
+        ai = _mm_set1_pd(column[3 * aRowStride]);
+        c30 = _mm_add_pd(c30, _mm_mul_pd(ai, b0));
+        c31 = _mm_add_pd(c31, _mm_mul_pd(ai, b1));
+    }
+    __m128d scale = _mm_set1_pd(alpha);
+    sse2StoreTile(c, scale, c00, accumulate);
+    sse2StoreTile(c + 2, scale, c01, accumulate);
+    sse2StoreTile(c + ldc, scale, c10, accumulate);
+    sse2StoreTile(c + ldc + 2, scale, c11, accumulate);
+    sse2StoreTile(c + 2 * ldc, scale, c20, accumulate);
+    sse2StoreTile(c + 2 * ldc + 2, scale, c21, accumulate);
+    sse2StoreTile(c + 3 * ldc, scale, c30, accumulate);
+    sse2StoreTile(c + 3 * ldc + 2, scale, c31, accumulate);
+}
+
+void sse2MultiplyTileFloat(const float* a, unsigned aRowStride, unsigned aColumnStride, const float* b, unsigned ldb, float* c, unsigned ldc, unsigned k, double alpha, bool accumulate)
+{
+    __m128 c00 = _mm_setzero_ps();
+    __m128 c01 = _mm_setzero_ps();
+    __m128 c10 = _mm_setzero_ps();
+    __m128 c11 = _mm_setzero_ps();
+    __m128 c20 = _mm_setzero_ps();
+    __m128 c21 = _mm_setzero_ps();
+    __m128 c30 = _mm_setzero_ps();
+    __m128 c31 = _mm_setzero_ps();
+    for(unsigned p = 0; p < k; ++p)
+    {
+        const float* bRow = b + p * ldb;
+        const float* column = a + p * aColumnStride;
+        __m128 b0 = _mm_loadu_ps(bRow);
+        __m128 b1 = _mm_loadu_ps(bRow + 4);
+        __m128 ai = _mm_set1_ps(column[0]);
+        c00 = _mm_add_ps(c00, _mm_mul_ps(ai, b0));
+        c01 = _mm_add_ps(c01, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(column[aRowStride]);
+        c10 = _mm_add_ps(c10, _mm_mul_ps(ai, b0));
+        c11 = _mm_add_ps(c11, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(column[2 * aRowStride]);
+        c20 = _mm_add_ps(c20, _mm_mul_ps(ai, b0));
+        c21 = _mm_add_ps(c21, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(column[3 * aRowStride]);
+        c30 = _mm_add_ps(c30, _mm_mul_ps(ai, b0));
+        c31 = _mm_add_ps(c31, _mm_mul_ps(ai, b1));
+    }
+    __m128 scale = _mm_set1_ps(static_cast<float>(alpha));
+    sse2StoreTileFloat(c, scale, c00, accumulate);
+    sse2StoreTileFloat(c + 4, scale, c01, accumulate);
+    sse2StoreTileFloat(c + ldc, scale, c10, accumulate);
+    sse2StoreTileFloat(c + ldc + 4, scale, c11, accumulate);
+    sse2StoreTileFloat(c + 2 * ldc, scale, c20, accumulate);
+    sse2StoreTileFloat(c + 2 * ldc + 4, scale, c21, accumulate);
+    sse2StoreTileFloat(c + 3 * ldc, scale, c30, accumulate);
+    sse2StoreTileFloat(c + 3 * ldc + 4, scale, c31, accumulate);
+}
+
+const KernelTable sse2Table = {"sse2", sse2Dot, sse2Axpy, sse2MomentumUpdate,
+                               sse2Logistic, sse2LogisticDerivative, sse2Tanh, sse2TanhDerivative,
+                               sse2DotFloat, sse2AxpyFloat, sse2MomentumUpdateFloat,
+                               sse2LogisticFloat, sse2LogisticDerivativeFloat, sse2TanhFloat, sse2TanhDerivativeFloat,
+                               sse2AxpyMixed, sse2MomentumUpdateMixed,
+                               sse2Dequantise8, sse2Dequantise16, sse2MultiplyInt8, sse2Quantise8,
+                               4, 8, sse2MultiplyTile, sse2MultiplyTileFloat};
+}
+
+const KernelTable* sse2Kernels()
+{
+    return &sse2Table;
+}
+#else
+const KernelTable* sse2Kernels()
+{
+    return NULL;
+}
+#endif
@@ -0,0 +1,203 @@
+#include "../include/linearalgebra.h"
+#include "../include/kernels.h"
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+namespace
+{
+unsigned tileColumns(const double*)
+{
+    return Kernels::tileColumns();
+}
+
+unsigned tileColumns(const float*)
+{
+    return Kernels::tileColumnsFloat();
+}
+
+//Computes a tile of nRows x nColumns entries of C with the vector kernel (see Kernels::multiplyTile).
+//Tiles at the edges of C are computed in full, from operands padded with zeros, in buffers,
+//so that every entry of C is computed in the same way wherever the tiles fall; in particular
+//the results do not depend on how the neurons of a layer are split across the threads.
+template<typename Real>
+void computeTile(const Real* a, unsigned aRowStride, unsigned aColumnStride, const Real* b, unsigned ldb, Real* c, unsigned ldc,
+                 unsigned nRows, unsigned nColumns, unsigned k, double alpha, bool accumulate)
+{
+    const unsigned width = tileColumns(c);
+    if(nRows == Kernels::tileRows && nColumns == width)
+    {
+        Kernels::multiplyTile(a, aRowStride, aColumnStride, b, ldb, c, ldc, k, alpha, accumulate);
+        return;
+    }
+    thread_local std::vector<Real> aTile;
+    thread_local std::vector<Real> bTile;
+    thread_local std::vector<Real> cTile;
+    if(nRows < Kernels::tileRows)
+    {
+        aTile.assign(k * Kernels::tileRows, Real(0.0));
+        for(unsigned p = 0; p < k; ++p)
+        {
+            for(unsigned i = 0; i < nRows; ++i)
+            {
+                aTile[p * Kernels::tileRows + i] = a[i * aRowStride + p * aColumnStride];
+            }
+        }
+        a = &aTile[0];
+        aRowStride = 1;
+        aColumnStride = Kernels::tileRows;
+    }
+    if(nColumns < width)
+    {
+        bTile.assign(k * width, Real(0.0));
+        for(unsigned p = 0; p < k; ++p)
+        {
+            std::copy(b + p * ldb, b + p * ldb + nColumns, bTile.begin() + p * width);
+        }
+        b = &bTile[0];
+        ldb = width;
+    }
+    cTile.assign(Kernels::tileRows * width, Real(0.0));
+    if(accumulate)
+    {
+        for(unsigned i = 0; i < nRows; ++i)
+        {
+            std::copy(c + i * ldc, c + i * ldc + nColumns, cTile.begin() + i * width);
+        }
+    }
+    Kernels::multiplyTile(a, aRowStride, aColumnStride, b, ldb, &cTile[0], width, k, alpha, accumulate);
+    for(unsigned i = 0; i < nRows; ++i)
+    {
+        std::copy(cTile.begin() + i * width, cTile.begin() + i * width + nColumns, c + i * ldc);
+    }
+}
+
+//Adds the products to C one pattern at a time, for fewer patterns than the rows of a tile
+//(e.g. online training) and in mixed precision: blocks of 4 rows of C are updated with every
+//pattern in turn, so that each row of B is streamed once every 4 rows of C.
+template<typename Real, typename Accumulator>
+void accumulateRows(double alpha, const Real* a, unsigned lda, const Real* b, unsigned ldb, Accumulator* c, unsigned ldc, unsigned m, unsigned n, unsigned k)
+{
+    for(unsigned row = 0; row < n; row += 4)
+    {
+        unsigned nRows = (n - row < 4) ? n - row : 4;
+        for(unsigned p = 0; p < m; ++p)
+        {
+            const Real* bRow = b + p * ldb;
+            for(unsigned r = 0; r < nRows; ++r)
+            {
+                Kernels::axpy(alpha * a[p * lda + row + r], bRow, c + (row + r) * ldc, k);
+            }
+        }
+    }
+}
+}
+
+template<typename Real>
+void LinearAlgebra::multiplyTransposed(const Real* a, unsigned lda, const Real* b, unsigned ldb, Real* c, unsigned ldc, unsigned m, unsigned n, unsigned k)
+{
+    //Fewer patterns than the rows of a tile (e.g. online training) are computed with dot
+    //products, which read the rows of B where they are.
+    if(m < Kernels::tileRows)
+    {
+        for(unsigned row = 0; row < m; ++row)
+        {
+            for(unsigned col = 0; col < n; ++col)
+            {
+                c[row * ldc + col] = Kernels::dot(a + row * lda, b + col * ldb, k);
+            }
+        }
+        return;
+    }
+    //Each panel of B, with the rows of a tile of columns of C, is transposed once into a
+    //buffer, and used by the tiles of all the rows of A.
+    const unsigned width = tileColumns(c);
+    thread_local std::vector<Real> panel;
+    panel.assign(k * width, Real(0.0));
+    for(unsigned col = 0; col < n; col += width)
+    {
+        unsigned nColumns = std::min(width, n - col);
+        for(unsigned j = 0; j < nColumns; ++j)
+        {
+            const Real* bRow = b + (col + j) * ldb;
+            for(unsigned p = 0; p < k; ++p)
+            {
+                panel[p * width + j] = bRow[p];
+            }
+        }
+        for(unsigned row = 0; row < m; row += Kernels::tileRows)
+        {
+            unsigned nRows = std::min(Kernels::tileRows, m - row);
+            computeTile(a + row * lda, lda, 1u, &panel[0], width, c + row * ldc + col, ldc, nRows, nColumns, k, 1.0, false);
+        }
+    }
+}
+
+template<typename Real>
+void LinearAlgebra::multiply(const Real* a, unsigned lda, const Real* b, unsigned ldb, Real* c, unsigned ldc, unsigned m, unsigned n, unsigned k)
+{
+    //Fewer patterns than the rows of a tile are computed by scaling and adding the rows of B.
+    if(m < Kernels::tileRows)
+    {
+        for(unsigned row = 0; row < m; ++row)
+        {
+            std::fill(c + row * ldc, c + row * ldc + n, Real(0.0));
+            for(unsigned p = 0; p < k; ++p)
+            {
+                Kernels::axpy(a[row * lda + p], b + p * ldb, c + row * ldc, n);
+            }
+        }
+        return;
+    }
+    //The rows of B already hold the columns of the tiles contiguously.
+    const unsigned width = tileColumns(c);
+    for(unsigned col = 0; col < n; col += width)
+    {
+        unsigned nColumns = std::min(width, n - col);
+        for(unsigned row = 0; row < m; row += Kernels::tileRows)
+        {
+            unsigned nRows = std::min(Kernels::tileRows, m - row);
+            computeTile(a + row * lda, lda, 1u, b + col, ldb, c + row * ldc + col, ldc, nRows, nColumns, k, 1.0, false);
+        }
+    }
+}
+
+template<typename Real, typename Accumulator>
+void LinearAlgebra::accumulateTransposedProduct(double alpha, const Real* a, unsigned lda, const Real* b, unsigned ldb, Accumulator* c, unsigned ldc, unsigned m, unsigned n, unsigned k)
+{
+    if constexpr(std::is_same<Real, Accumulator>::value)
+    {
+        if(m < Kernels::tileRows)
+        {
+            accumulateRows(alpha, a, lda, b, ldb, c, ldc, m, n, k);
+            return;
+        }
+        //The entries of a tile of C are the columns of A, read with a stride of lda, times the
+        //rows of B: the patterns are summed in registers, and the sum added to C once.
+        const unsigned width = tileColumns(c);
+        for(unsigned col = 0; col < k; col += width)
+        {
+            unsigned nColumns = std::min(width, k - col);
+            for(unsigned row = 0; row < n; row += Kernels::tileRows)
+            {
+                unsigned nRows = std::min(Kernels::tileRows, n - row);
+                computeTile(a + row, 1u, lda, b + col, ldb, c + row * ldc + col, ldc, nRows, nColumns, m, alpha, true);
+            }
+        }
+    }
+    else
+    {
+        //In mixed precision the single precision products are added to the double precision
+        //entries of C one pattern at a time.
+        accumulateRows(alpha, a, lda, b, ldb, c, ldc, m, n, k);
+    }
+}
+
+//Instantiations for the precisions of the network (see NetworkEngine).
+template void LinearAlgebra::multiplyTransposed<double>(const double*, unsigned, const double*, unsigned, double*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::multiplyTransposed<float>(const float*, unsigned, const float*, unsigned, float*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::multiply<double>(const double*, unsigned, const double*, unsigned, double*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::multiply<float>(const float*, unsigned, const float*, unsigned, float*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::accumulateTransposedProduct<double, double>(double, const double*, unsigned, const double*, unsigned, double*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::accumulateTransposedProduct<float, float>(double, const float*, unsigned, const float*, unsigned, float*, unsigned, unsigned, unsigned, unsigned);
+template void LinearAlgebra::accumulateTransposedProduct<float, double>(double, const float*, unsigned, const float*, unsigned, double*, unsigned, unsigned, unsigned, unsigned);
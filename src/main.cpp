@@ -1,25 +1,186 @@
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
 
 #include "../include/bpneuralnetwork.h"
+#include "../include/threadpool.h"
+#include "../include/patterncache.h"
+#include "../include/foldpartition.h"
+#include "../include/modelfile.h"
+#include "../include/batchscorer.h"
+#include "../include/quantisedengine.h"
+#include "../include/patternreader.h"
+#include "../include/inferenceserver.h"
 /**
  *  @mainpage Elementary Back Propagation Neural Network Example
  *  
- *  This code can be used as a beginner's reference on how to implment
- *  a Neural Network in C++. It is not production optimised, as, for instance
- *  no GPU parallelisation is used. However, several important concepts, i.e. 
- *  cross-validation, testing, normalisation and activation functions are 
- *  implemented and the code is quite short. 
+ *  This code can be used as a reference on how to implement a Neural Network
+ *  in C++: cross-validation, testing, normalisation and activation functions
+ *  are implemented, as well as vector kernels chosen at runtime, multithreaded
+ *  training, memory-mapped data and model files and 8 bit inference. It runs
+ *  on the CPU only, no GPU parallelisation is used.
  * 
  */
 int main(int argc, char *argv[])
 {
-    BPNeuralNetwork bpnn;
-    for(unsigned i = 0; i < bpnn.ir().k(); ++i)
+    //"convert textFile binaryFile inColumns outColumns" writes a binary pattern file,
+    //which can be used as data file instead of the text file.
+    if(argc > 1 && std::string(argv[1]) == "convert")
     {
+        if(argc != 6)
+        {
+            std::cerr << "Usage: " << argv[0] << " convert textFile binaryFile inColumns outColumns" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        ThreadPool pool(0);
+        PatternsManager pm(std::atoi(argv[4]), std::atoi(argv[5]), &pool);
+        pm.readFile(argv[2]);
+        PatternCache::write(argv[3], pm);
+        return 0;
+    }
+    //"score modelFile inputFile outputFile [nThreads] [int8]" writes the outputs of a saved net
+    //for every row of a file of inputs, without any parameter file. With int8 the net is
+    //quantised to 8 bits, calibrated on the first rows of the inputs.
+    if(argc > 1 && std::string(argv[1]) == "score")
+    {
+        bool int8 = (argc > 5 && std::string(argv[argc - 1]) == "int8");
+        int nArguments = int8 ? argc - 1 : argc;
+        if(nArguments != 5 && nArguments != 6)
+        {
+            std::cerr << "Usage: " << argv[0] << " score modelFile inputFile outputFile [nThreads] [int8]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        ModelFile model(argv[2]);
+        InferenceEngine* engine = InferenceEngine::create(model);
+        InferenceEngine* quantised = NULL;
+        if(int8)
+        {
+            const unsigned calibrationRows = 1024;
+            std::vector<double> sample(calibrationRows * engine->inColumns());
+            PatternReader reader(argv[3], engine->inColumns());
+            unsigned nSample = 0;
+            while(nSample < calibrationRows && reader.readRow(&sample[nSample * engine->inColumns()]))
+            {
+                ++nSample;
+            }
+            quantised = new QuantisedEngine(*engine, sample.data(), engine->inColumns(), nSample);
+        }
+        ThreadPool pool((nArguments == 6) ? std::atoi(argv[5]) : 0);
+        BatchScorer scorer(int8 ? *quantised : *engine, pool, 256);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned long long nRows = scorer.score(argv[3], argv[4]);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Scored " << nRows << " rows in " << elapsed.count() << " s (" << nRows / elapsed.count() << " rows/s) on "
+                  << pool.nThreads() << " threads" << std::endl;
+        delete quantised;
+        delete engine;
+        return 0;
+    }
+    //"serve modelFile address [maxBatch] [maxWait]" answers the rows sent by local clients
+    //with the outputs of a saved net, in batches of up to maxBatch rows (64 if omitted),
+    //waiting at most maxWait microseconds (200 if omitted) for a batch to fill.
+    if(argc > 1 && std::string(argv[1]) == "serve")
+    {
+        if(argc < 4 || argc > 6)
+        {
+            std::cerr << "Usage: " << argv[0] << " serve modelFile address [maxBatch] [maxWait]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        ModelFile model(argv[2]);
+        InferenceEngine* engine = InferenceEngine::create(model);
+        int maxBatch = (argc > 4) ? std::atoi(argv[4]) : 64;
+        int maxWait = (argc > 5) ? std::atoi(argv[5]) : 200;
+        if(maxBatch < 1 || maxWait < 0)
+        {
+            std::cerr << "The batches need at least one row, and the wait cannot be negative" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        InferenceServer server(*engine, maxBatch, maxWait);
+        server.listen(argv[3]);
+        std::cout << "Serving " << argv[2] << " on " << argv[3] << " in batches of up to " << maxBatch << " rows, waiting at most "
+                  << maxWait << " us" << std::endl;
+        server.run();
+        ServerStatistics statistics = server.statistics();
+        std::cout << "Served " << statistics.nRequests << " rows in " << statistics.nBatches << " batches, latency p50 "
+                  << statistics.p50 << " us, p99 " << statistics.p99 << " us" << std::endl;
+        delete engine;
+        return 0;
+    }
+    //Parameters and data are read once, and shared (read only) by the nets.
+    InputReader ir;
+    ThreadPool pool(ir.nThreads());
+    PatternsManager pm(ir.inColumns(), ir.outColumns(), &pool, ir.storage());
+    //Streamed data are read again from the file in every epoch, only the statistics are kept.
+    if(ir.streamBuffer() > 0)
+    {
+        pm.readStatistics(ir.fileName());
+    }
+    else
+    {
+        pm.readFile(ir.fileName());
+    }
+    //When the scaling is folded into the nets, the data are kept as read, and scaled
+    //batch by batch while training.
+    if(ir.foldScaling())
+    {
+        pm.setScaling(ir.scalingType());
+    }
+    else
+    {
+        pm.scale(ir.scalingType());
+    }
+    FoldPartition folds(ir, pm);
+    //Each cross-validation fold trains its own net, initialised with its own seed,
+    //and the folds run in parallel. The text of each fold is kept apart and written
+    //in order at the end, so that the output does not depend on the scheduling.
+    unsigned seed = static_cast<unsigned>(std::time(0));
+    std::vector<std::string> reports(ir.k());
+    std::vector<std::string> testResults(ir.k());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool.parallelFor(0, ir.k(), [&](unsigned i)
+    {
+        BPNeuralNetwork bpnn(ir, pm, folds, pool, seed + i);
         bpnn.train(i);
         bpnn.test();
         bpnn.crossvalidate(i);
-    }
+        //The model file holds the net of the last fold, as trained on scaled data, with
+        //the scaling, like Results.txt holds its test results.
+        if(ir.saveModel() && i == ir.k() - 1)
+        {
+            bpnn.saveModel(ir.modelFileName());
+        }
+        if(ir.foldScaling())
+        {
+            bpnn.foldScaling();
+        }
+        reports[i] = bpnn.report();
+        testResults[i] = bpnn.testResults();
+    });
+    //The time is not written to the output file, which only depends on the seed
+    //(except in ASYNCHRONOUS mode).
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Trained " << ir.k() << " folds in " << elapsed.count() << " s" << std::endl;
     
+    std::ofstream file(ir.outFileName().c_str());
+    if(!file.is_open())
+    {
+        std::cerr << "Unable to open " << ir.outFileName() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    BPNeuralNetwork::printHeader(file, ir, pm);
+    file << "Random seed of the first fold: " << seed << std::endl;
+    for(unsigned i = 0; i < ir.k(); ++i)
+    {
+        file << reports[i];
+    }
+    file.close();
+    //The scatter plot data are those of the last fold.
+    std::ofstream resultsFile("Results.txt");
+    resultsFile << testResults[ir.k() - 1];
+    resultsFile.close();
     return 0;
 }
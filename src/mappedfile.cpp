@@ -0,0 +1,66 @@
+#include "../include/mappedfile.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define NN_HAVE_MMAP
+#endif
+
+MappedFile::MappedFile(const std::string& fileName, bool copyOnWrite)
+: m_data(NULL)
+, m_size(0)
+{
+#ifdef NN_HAVE_MMAP
+    int descriptor = open(fileName.c_str(), O_RDONLY);
+    struct stat status;
+    if(descriptor < 0 || fstat(descriptor, &status) != 0)
+    {
+        std::cerr << "Could not open " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    m_size = status.st_size;
+    if(m_size > 0)
+    {
+        //A private mapping can be written, without changing the file.
+        int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* address = mmap(NULL, m_size, protection, copyOnWrite ? MAP_PRIVATE : MAP_SHARED, descriptor, 0);
+        if(address == MAP_FAILED)
+        {
+            std::cerr << "Could not map " << fileName << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        m_data = static_cast<char*>(address);
+    }
+    //The mapping stays valid after the file is closed.
+    close(descriptor);
+#else
+    //The contents are read in a vector of doubles, so that they are 8 byte aligned.
+    std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        std::cerr << "Could not open " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    m_size = static_cast<std::size_t>(file.tellg());
+    m_contents.resize((m_size + sizeof(double) - 1) / sizeof(double));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_contents.data()), m_size);
+    m_data = reinterpret_cast<char*>(m_contents.data());
+    //The copy in memory can always be written.
+    (void)copyOnWrite;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef NN_HAVE_MMAP
+    if(m_data != NULL)
+    {
+        munmap(m_data, m_size);
+    }
+#endif
+}
@@ -0,0 +1,188 @@
+#include "../include/modelfile.h"
+#include "../include/inputreader.h"
+#include "../include/networkengine.h"
+#include "../include/patternsmanager.h"
+#include "../include/layer.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+const char signature[8] = {'N', 'N', 'M', 'O', 'D', 'B', 'I', 'N'};
+const std::uint32_t currentVersion = 1;
+const std::uint32_t byteOrderMark = 0x01020304;
+
+//Offsets of the blocks are rounded up to a cache line.
+std::uint64_t alignedOffset(std::uint64_t offset)
+{
+    return (offset + 63) / 64 * 64;
+}
+
+void writeOrExit(std::FILE* file, const void* data, std::size_t size, const std::string& fileName)
+{
+    if(size > 0 && std::fwrite(data, 1, size, file) != size)
+    {
+        std::cerr << "Error writing " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void padTo(std::FILE* file, std::uint64_t& position, std::uint64_t offset, const std::string& fileName)
+{
+    static const char zeros[64] = {0};
+    writeOrExit(file, zeros, offset - position, fileName);
+    position = offset;
+}
+
+//Whether a block of size bytes at offset lies in the file, on a cache line boundary.
+bool validBlock(std::uint64_t offset, std::uint64_t size, std::size_t fileSize)
+{
+    return offset % 64 == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+void invalidModel(const std::string& fileName, const std::string& problem)
+{
+    std::cerr << fileName << " is not a valid model file: " << problem << std::endl;
+    exit(EXIT_FAILURE);
+}
+}
+
+ModelFile::ModelFile(const std::string& fileName)
+: m_file(fileName)
+, m_header(NULL)
+, m_layers(NULL)
+{
+    if(m_file.size() < sizeof(ModelFileHeader))
+    {
+        invalidModel(fileName, "too short");
+    }
+    m_header = reinterpret_cast<const ModelFileHeader*>(m_file.data());
+    if(std::memcmp(m_header->magic, signature, sizeof(signature)) != 0 || m_header->version != currentVersion || m_header->byteOrder != byteOrderMark)
+    {
+        std::cerr << fileName << " is not a model file of version " << currentVersion << " for this machine" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(m_header->nLayers == 0 || !validBlock(m_header->layersOffset, m_header->nLayers * sizeof(ModelLayerHeader), m_file.size()))
+    {
+        invalidModel(fileName, "bad layers");
+    }
+    if(m_header->hiddenFunction > TANH_ACTIVATION || m_header->outFunction > TANH_ACTIVATION)
+    {
+        invalidModel(fileName, "unknown activation function");
+    }
+    m_layers = reinterpret_cast<const ModelLayerHeader*>(m_file.data() + m_header->layersOffset);
+    //Each layer takes the outputs of the previous one, and all its blocks must be in the file.
+    for(unsigned layer = 0; layer < m_header->nLayers; ++layer)
+    {
+        const ModelLayerHeader& description = m_layers[layer];
+        unsigned nInputs = (layer == 0) ? m_header->inColumns : m_layers[layer - 1].nNodes;
+        if(description.nNodes == 0 || description.nInputs != nInputs || description.stride != paddedStride<double>(nInputs)
+           || !validBlock(description.weightsOffset, std::uint64_t(description.nNodes) * description.stride * sizeof(double), m_file.size())
+           || !validBlock(description.thresholdsOffset, description.nNodes * sizeof(double), m_file.size()))
+        {
+            invalidModel(fileName, "bad layer " + std::to_string(layer));
+        }
+    }
+    if(scaled() && !validBlock(m_header->scalingOffset, 2 * (inColumns() + outColumns()) * sizeof(double), m_file.size()))
+    {
+        invalidModel(fileName, "bad scaling");
+    }
+}
+
+void ModelFile::write(const std::string& fileName, const InputReader& ir, const NetworkEngine& engine, const PatternsManager& pm)
+{
+    ModelFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, signature, sizeof(signature));
+    header.version = currentVersion;
+    header.byteOrder = byteOrderMark;
+    header.nLayers = engine.nLayers();
+    header.inColumns = engine.nInputs(0);
+    header.hiddenFunction = activation(ir.hiddenFunction());
+    header.betaHidden = ir.betaHidden();
+    header.outFunction = activation(ir.outFunction());
+    header.betaOut = ir.betaOut();
+    header.layersOffset = alignedOffset(sizeof(header));
+    //The weights and thresholds of each layer follow the descriptions of the layers.
+    std::vector<ModelLayerHeader> layers(header.nLayers);
+    std::uint64_t offset = header.layersOffset + header.nLayers * sizeof(ModelLayerHeader);
+    for(unsigned layer = 0; layer < header.nLayers; ++layer)
+    {
+        std::memset(&layers[layer], 0, sizeof(ModelLayerHeader));
+        layers[layer].nNodes = engine.nNodes(layer);
+        layers[layer].nInputs = engine.nInputs(layer);
+        layers[layer].stride = paddedStride<double>(layers[layer].nInputs);
+        layers[layer].weightsOffset = alignedOffset(offset);
+        layers[layer].thresholdsOffset = alignedOffset(layers[layer].weightsOffset + std::uint64_t(layers[layer].nNodes) * layers[layer].stride * sizeof(double));
+        offset = layers[layer].thresholdsOffset + layers[layer].nNodes * sizeof(double);
+    }
+    header.scalingOffset = pm.inOffsets().empty() ? 0 : alignedOffset(offset);
+
+    std::FILE* file = std::fopen(fileName.c_str(), "wb");
+    if(file == NULL)
+    {
+        std::cerr << "Unable to open " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::uint64_t position = 0;
+    writeOrExit(file, &header, sizeof(header), fileName);
+    position += sizeof(header);
+    padTo(file, position, header.layersOffset, fileName);
+    writeOrExit(file, layers.data(), layers.size() * sizeof(ModelLayerHeader), fileName);
+    position += layers.size() * sizeof(ModelLayerHeader);
+    //The weights are converted to double precision, in rows padded with zeros.
+    for(unsigned layer = 0; layer < header.nLayers; ++layer)
+    {
+        std::vector<double> weights(std::size_t(layers[layer].nNodes) * layers[layer].stride, 0.0);
+        std::vector<double> thresholds(layers[layer].nNodes);
+        for(unsigned neuroIndex = 0; neuroIndex < layers[layer].nNodes; ++neuroIndex)
+        {
+            for(unsigned wIndex = 0; wIndex < layers[layer].nInputs; ++wIndex)
+            {
+                weights[neuroIndex * layers[layer].stride + wIndex] = engine.weight(layer, neuroIndex, wIndex);
+            }
+            thresholds[neuroIndex] = engine.threshold(layer, neuroIndex);
+        }
+        padTo(file, position, layers[layer].weightsOffset, fileName);
+        writeOrExit(file, weights.data(), weights.size() * sizeof(double), fileName);
+        position += weights.size() * sizeof(double);
+        padTo(file, position, layers[layer].thresholdsOffset, fileName);
+        writeOrExit(file, thresholds.data(), thresholds.size() * sizeof(double), fileName);
+        position += thresholds.size() * sizeof(double);
+    }
+    if(header.scalingOffset != 0)
+    {
+        padTo(file, position, header.scalingOffset, fileName);
+        const std::vector<double>* scaling[4] = {&pm.inOffsets(), &pm.inDivisors(), &pm.outOffsets(), &pm.outDivisors()};
+        for(unsigned block = 0; block < 4; ++block)
+        {
+            writeOrExit(file, scaling[block]->data(), scaling[block]->size() * sizeof(double), fileName);
+        }
+    }
+    if(std::fclose(file) != 0)
+    {
+        std::cerr << "Error writing " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+Activation ModelFile::activation(const std::string& name)
+{
+    if(name == "transfer")
+    {
+        return TRANSFER_ACTIVATION;
+    }
+    else if(name == "logistic")
+    {
+        return LOGISTIC_ACTIVATION;
+    }
+    else if(name == "tanh")
+    {
+        return TANH_ACTIVATION;
+    }
+    std::cerr << "Unknown activation function " << name << std::endl;
+    exit(EXIT_FAILURE);
+}
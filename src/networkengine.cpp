@@ -0,0 +1,377 @@
+#include "../include/networkengine.h"
+#include "../include/transferactivation.h"
+#include "../include/logistic.h"
+#include "../include/tanhfunction.h"
+#include "../include/linearalgebra.h"
+#include "../include/kernels.h"
+#include <iostream>
+#include <cstdlib>
+#include <type_traits>
+#include <algorithm>
+
+namespace
+{
+//Neurons are split across threads in multiples of this number, so that two threads never
+//write to the same cache line of the outputs or deltas.
+const unsigned nodeGrain = 16;
+
+//Allocates a single layer and initialises its weights and thresholds randomly, in the
+//ranges defined in the parameter file.
+//The random numbers are drawn in double precision in every precision, so that the
+//initial nets only differ by rounding.
+template<typename Real, typename Accumulator>
+void initialiseLayer(Layer<Real, Accumulator>& layer, unsigned nNodes, unsigned nInputs, const InputReader& ir, std::mt19937& generator)
+{
+    //Rows are padded to a multiple of 64 bytes, so that each row is cache line aligned.
+    layer.nNodes = nNodes;
+    layer.nInputs = nInputs;
+    layer.stride = paddedStride<Real>(nInputs);
+    layer.outputStride = paddedStride<Real>(nNodes);
+    layer.weights.assign(nNodes * layer.stride, 0.0);
+    layer.thresholds.assign(nNodes, 0.0);
+    std::uniform_real_distribution<double> weightDistribution(ir.weightRange().first, ir.weightRange().second);
+    std::uniform_real_distribution<double> thresholdDistribution(ir.thresholdsRange().first, ir.thresholdsRange().second);
+    for(unsigned neuroIndex = 0; neuroIndex < nNodes; ++neuroIndex)
+    {
+        //Weights are initialised randomly to the range defined in the parameter file.
+        Real* weights = &layer.weights[neuroIndex * layer.stride];
+        for(unsigned wIndex = 0; wIndex < nInputs; ++wIndex)
+        {
+            weights[wIndex] = static_cast<Real>(weightDistribution(generator));
+        }
+        //Thresholds are initialised as weight if an interval is defined, or all set to the same value if [min max] with min = max.
+        layer.thresholds[neuroIndex] = static_cast<Real>((ir.thresholdsRange().second == ir.thresholdsRange().first) ? ir.thresholdsRange().first 
+                                                                                                 : thresholdDistribution(generator));
+    }
+}
+
+//Allocates the workspace of a layer, for batches of up to batchCapacity patterns.
+template<typename Real, typename Accumulator>
+void initialiseWorkspace(LayerWorkspace<Real, Accumulator>& work, const Layer<Real, Accumulator>& layer, unsigned batchCapacity)
+{
+    work.deltaWeights.assign(layer.nNodes * layer.stride, 0.0);
+    work.deltaThresholds.assign(layer.nNodes, 0.0);
+    work.oldDeltaWeights.assign(layer.nNodes * layer.stride, 0.0);
+    work.oldDeltaThresholds.assign(layer.nNodes, 0.0);
+    work.outputs.assign(batchCapacity * layer.outputStride, 0.0);
+    work.derOutputs.assign(batchCapacity * layer.outputStride, 0.0);
+    work.deltas.assign(batchCapacity * layer.outputStride, 0.0);
+}
+
+//Adds the contribution of the current patterns to the deltaWeights and deltaThresholds of
+//the neurons [first, last) of a layer.
+//The contributions of all the patterns in the batch are summed, as in BATCH mode.
+template<typename Real, typename Accumulator>
+void accumulateDeltaWeights(const Layer<Real, Accumulator>& layer, LayerWorkspace<Real, Accumulator>& work, const Real* inputs, unsigned inputStride, unsigned nPatterns, double learningRate, unsigned first, unsigned last)
+{
+    LinearAlgebra::accumulateTransposedProduct(learningRate, &work.deltas[first], layer.outputStride, inputs, inputStride, &work.deltaWeights[first * layer.stride], layer.stride, nPatterns, last - first, layer.nInputs);
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        Kernels::axpy(learningRate, &work.deltas[nRow * layer.outputStride + first], &work.deltaThresholds[first], last - first);
+    }
+}
+
+//Adds the deltaWeights and deltaThresholds of source to those of target, and resets source.
+template<typename Real, typename Accumulator>
+void mergeLayerGradients(LayerWorkspace<Real, Accumulator>& target, LayerWorkspace<Real, Accumulator>& source)
+{
+    Kernels::axpy(1.0, &source.deltaWeights[0], &target.deltaWeights[0], source.deltaWeights.size());
+    Kernels::axpy(1.0, &source.deltaThresholds[0], &target.deltaThresholds[0], source.deltaThresholds.size());
+    std::fill(source.deltaWeights.begin(), source.deltaWeights.end(), Accumulator(0.0));
+    std::fill(source.deltaThresholds.begin(), source.deltaThresholds.end(), Accumulator(0.0));
+}
+
+//Updates weights and thresholds of the neurons [first, last) of a layer. The padding entries
+//of the rows are always zero, so the rows can be updated in a single contiguous loop.
+//The momentum term is taken from the same workspace as the differences.
+template<typename Real, typename Accumulator>
+void updateLayer(Layer<Real, Accumulator>& layer, LayerWorkspace<Real, Accumulator>& work, double momentum, unsigned first, unsigned last)
+{
+    unsigned offset = first * layer.stride;
+    Kernels::momentumUpdate(&layer.weights[offset], &work.deltaWeights[offset], &work.oldDeltaWeights[offset], momentum, (last - first) * layer.stride);
+    Kernels::momentumUpdate(&layer.thresholds[first], &work.deltaThresholds[first], &work.oldDeltaThresholds[first], momentum, last - first);
+}
+
+//In double precision the inputs are used where they are, otherwise they are converted
+//once per batch, in rows padded for the precision of the engine.
+const double* convertInputs(const double* inputs, unsigned& /*inputStride*/, unsigned /*nPatterns*/, unsigned /*nColumns*/, AlignedArray<double>& /*converted*/)
+{
+    return inputs;
+}
+
+const float* convertInputs(const double* inputs, unsigned& inputStride, unsigned nPatterns, unsigned nColumns, AlignedArray<float>& converted)
+{
+    unsigned stride = paddedStride<float>(nColumns);
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        for(unsigned column = 0; column < nColumns; ++column)
+        {
+            converted[nRow * stride + column] = static_cast<float>(inputs[nRow * inputStride + column]);
+        }
+    }
+    inputStride = stride;
+    return &converted[0];
+}
+
+//Last part of the factory: the activation functions are already fixed.
+template<class Hidden, class Out>
+NetworkEngine* createEngine(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator, const Hidden& hidden, const Out& out)
+{
+    if(ir.precision() == SINGLE_PRECISION)
+    {
+        return new NetworkEngineImpl<Hidden, Out, float, float>(ir, batchCapacity, nWorkspaces, pool, generator, hidden, out);
+    }
+    else if(ir.precision() == MIXED_PRECISION)
+    {
+        return new NetworkEngineImpl<Hidden, Out, float, double>(ir, batchCapacity, nWorkspaces, pool, generator, hidden, out);
+    }
+    return new NetworkEngineImpl<Hidden, Out, double, double>(ir, batchCapacity, nWorkspaces, pool, generator, hidden, out);
+}
+
+//Second part of the factory: the hidden activation function is already fixed.
+template<class Hidden>
+NetworkEngine* createEngine(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator, const Hidden& hidden)
+{
+    if(ir.outFunction() == "transfer")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, hidden, TransferActivation());
+    }
+    else if(ir.outFunction() == "logistic")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, hidden, Logistic(ir.betaOut()));
+    }
+    else if(ir.outFunction() == "tanh")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, hidden, TanhFunction(ir.betaOut()));
+    }
+    std::cerr << "Unknown activation function " << ir.outFunction() << std::endl;
+    exit(EXIT_FAILURE);
+}
+}
+
+NetworkEngine* NetworkEngine::create(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator)
+{
+    if(ir.hiddenFunction() == "transfer")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, TransferActivation());
+    }
+    else if(ir.hiddenFunction() == "logistic")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, Logistic(ir.betaHidden()));
+    }
+    else if(ir.hiddenFunction() == "tanh")
+    {
+        return createEngine(ir, batchCapacity, nWorkspaces, pool, generator, TanhFunction(ir.betaHidden()));
+    }
+    std::cerr << "Unknown activation function " << ir.hiddenFunction() << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+NetworkEngineImpl<Hidden, Out, Real, Accumulator>::NetworkEngineImpl(const InputReader& ir, unsigned batchCapacity, unsigned nWorkspaces, ThreadPool* pool, std::mt19937& generator, const Hidden& hidden, const Out& out)
+: m_hFunction(hidden)
+, m_oFunction(out)
+, m_net(ir.nHiddenLayers())
+, m_learningRate(ir.learningRate())
+, m_momentum(ir.momentum())
+, m_workspaces(nWorkspaces)
+, m_pool(pool)
+, m_splitThreshold(ir.splitThreshold())
+{
+    //For the first layer, the number of weights corresponds to the number of input entries
+    //for each pattern, for other layers it is just the number of nodes in the previous layer.
+    //The output layer is treated separately.
+    for(unsigned layer = 0; layer < ir.nHiddenLayers(); ++layer)
+    {
+        unsigned nInputs = (layer == 0) ? ir.inColumns() : ir.nNodesPerLayer()[layer-1];
+        initialiseLayer(m_net[layer], ir.nNodesPerLayer()[layer], nInputs, ir, generator);
+    }
+    initialiseLayer(m_outputs, ir.outColumns(), ir.nNodesPerLayer()[ir.nNodesPerLayer().size() - 1], ir, generator);
+    for(unsigned w = 0; w < nWorkspaces; ++w)
+    {
+        Workspace& workspace = m_workspaces[w];
+        workspace.layers.resize(m_net.size() + 1);
+        for(unsigned layer = 0; layer <= m_net.size(); ++layer)
+        {
+            initialiseWorkspace(workspace.layers[layer], layerAt(layer), batchCapacity);
+        }
+        if(!std::is_same<Real, double>::value)
+        {
+            workspace.convertedInputs.assign(batchCapacity * paddedStride<Real>(ir.inColumns()), Real(0.0));
+        }
+        workspace.batchInputs = NULL;
+        workspace.batchInputStride = 0;
+    }
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::propagate(unsigned workspace, const double* batchInputs, unsigned batchInputStride, unsigned nPatterns)
+{
+    //Each layer takes as input the outputs of the previous one.
+    Workspace& work = m_workspaces[workspace];
+    unsigned inputStride = batchInputStride;
+    const Real* inputs = convertInputs(batchInputs, inputStride, nPatterns, m_net[0].nInputs, work.convertedInputs);
+    work.batchInputs = inputs;
+    work.batchInputStride = inputStride;
+    for(unsigned layer = 0; layer < m_net.size(); ++layer)
+    {
+        computeOutput(m_net[layer], work.layers[layer], m_hFunction, inputs, inputStride, nPatterns);
+        inputs = &work.layers[layer].outputs[0];
+        inputStride = m_net[layer].outputStride;
+    }
+    computeOutput(m_outputs, work.layers[m_net.size()], m_oFunction, inputs, inputStride, nPatterns);
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::backPropagate(unsigned workspace, const double* targets, unsigned targetStride, unsigned nPatterns)
+{
+    //Backpropagate computes the deltas according to the standard multi layer perceptron model,
+    //and the deltaWeights, which will be used during the update phase to compute the new weights.
+    Workspace& work = m_workspaces[workspace];
+    unsigned nHidden = m_net.size();
+    LayerWorkspaceType& outWork = work.layers[nHidden];
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        const double* expected = targets + nRow * targetStride;
+        unsigned offset = nRow * m_outputs.outputStride;
+        for(unsigned outIndex = 0; outIndex < m_outputs.nNodes; ++outIndex)
+        {
+            Real error = static_cast<Real>(expected[outIndex]) - outWork.outputs[offset + outIndex];
+            outWork.deltas[offset + outIndex] = Out::unitDerivative ? error : outWork.derOutputs[offset + outIndex] * error;
+        }
+    }
+    const Real* hiddenOutputs = &work.layers[nHidden - 1].outputs[0];
+    unsigned hiddenStride = m_net[nHidden - 1].outputStride;
+    forNodeRanges(m_outputs.nNodes, [&](unsigned first, unsigned last)
+    {
+        accumulateDeltaWeights(m_outputs, outWork, hiddenOutputs, hiddenStride, nPatterns, m_learningRate, first, last);
+    });
+    for(int layer = nHidden - 1; layer >= 0; --layer)
+    {
+        const LayerType& current = m_net[layer];
+        LayerWorkspaceType& currentWork = work.layers[layer];
+        const Real* inputs = (layer != 0) ? &work.layers[layer - 1].outputs[0] : work.batchInputs;
+        unsigned inputStride = (layer != 0) ? m_net[layer - 1].outputStride : work.batchInputStride;
+        const LayerType& next = layerAt(layer + 1);
+        const LayerWorkspaceType& nextWork = work.layers[layer + 1];
+        //Deltas and deltaWeights of a neuron only depend on its own deltas, so each range
+        //of neurons is completed by the same thread, with one barrier per layer.
+        forNodeRanges(current.nNodes, [&](unsigned first, unsigned last)
+        {
+            computeDeltas(current, currentWork, next, nextWork, nPatterns, first, last);
+            accumulateDeltaWeights(current, currentWork, inputs, inputStride, nPatterns, m_learningRate, first, last);
+        });
+    }   
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::mergeGradients(unsigned target, unsigned source)
+{
+    for(unsigned layer = 0; layer <= m_net.size(); ++layer)
+    {
+        mergeLayerGradients(m_workspaces[target].layers[layer], m_workspaces[source].layers[layer]);
+    }
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::update(unsigned workspace)
+{
+    //Update simply sums the deltaweights to the weights, adding a momentum term.
+    for(unsigned layer = 0; layer <= m_net.size(); ++layer)
+    {
+        LayerType& current = (layer < m_net.size()) ? m_net[layer] : m_outputs;
+        LayerWorkspaceType& work = m_workspaces[workspace].layers[layer];
+        forNodeRanges(current.nNodes, [&](unsigned first, unsigned last)
+        {
+            updateLayer(current, work, m_momentum, first, last);
+        });
+    }
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::foldScaling(const std::vector<double>& inOffsets, const std::vector<double>& inDivisors,
+                                                                    const std::vector<double>& outOffsets, const std::vector<double>& outDivisors)
+{
+    //With x' = (x - o) / d, each neuron of the first layer computes
+    //sum(w * x') + t = sum(w / d * x) + t - sum(w * o / d).
+    LayerType& first = m_net.empty() ? m_outputs : m_net[0];
+    for(unsigned node = 0; node < first.nNodes && !inOffsets.empty(); ++node)
+    {
+        Real* weights = &first.weights[node * first.stride];
+        double threshold = first.thresholds[node];
+        for(unsigned input = 0; input < first.nInputs; ++input)
+        {
+            double weight = weights[input] / inDivisors[input];
+            threshold -= weight * inOffsets[input];
+            weights[input] = static_cast<Real>(weight);
+        }
+        first.thresholds[node] = static_cast<Real>(threshold);
+    }
+    m_outScales = outDivisors;
+    m_outOffsets = outOffsets;
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+template<class Body>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::forNodeRanges(unsigned nNodes, const Body& body)
+{
+    //Small layers, and single threaded runs, do not pay for the synchronisation.
+    unsigned nGrains = (nNodes + nodeGrain - 1) / nodeGrain;
+    unsigned nRanges = (m_pool == NULL || m_splitThreshold == 0 || nNodes < m_splitThreshold) ? 1 : std::min(m_pool->nThreads(), nGrains);
+    if(nRanges <= 1)
+    {
+        body(0, nNodes);
+        return;
+    }
+    m_pool->parallelFor(0, nRanges, [&](unsigned range)
+    {
+        unsigned first = nGrains * range / nRanges * nodeGrain;
+        unsigned last = std::min(nGrains * (range + 1) / nRanges * nodeGrain, nNodes);
+        body(first, last);
+    });
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+template<class Function>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::computeOutput(const LayerType& layer, LayerWorkspaceType& work, const Function& function, const Real* inputs, unsigned inputStride, unsigned nPatterns)
+{
+    //Weighted sums for the whole batch, then threshold and activation function, applied
+    //to a whole row at once. The derivative is computed from the outputs, when needed.
+    //The outputs of different neurons are independent, so wide layers are split in ranges
+    //of neurons computed by different threads.
+    forNodeRanges(layer.nNodes, [&](unsigned first, unsigned last)
+    {
+        LinearAlgebra::multiplyTransposed(inputs, inputStride, &layer.weights[first * layer.stride], layer.stride, &work.outputs[first], layer.outputStride, nPatterns, last - first, layer.nInputs);
+        for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+        {
+            Real* outputs = &work.outputs[nRow * layer.outputStride + first];
+            Kernels::axpy(1.0, &layer.thresholds[first], outputs, last - first);
+            function.equation(outputs, last - first);
+            if(!Function::unitDerivative)
+            {
+                function.firstDerivativeFromOutput(outputs, &work.derOutputs[nRow * layer.outputStride + first], last - first);
+            }
+        }
+    });
+}
+
+template<class Hidden, class Out, typename Real, typename Accumulator>
+void NetworkEngineImpl<Hidden, Out, Real, Accumulator>::computeDeltas(const LayerType& layer, LayerWorkspaceType& work, const LayerType& next, const LayerWorkspaceType& nextWork, unsigned nPatterns, unsigned first, unsigned last)
+{
+    //The deltas of the following layer are multiplied by its weights, which are read
+    //row by row, so that the memory is accessed contiguously.
+    LinearAlgebra::multiply(&nextWork.deltas[0], next.outputStride, &next.weights[first], next.stride, &work.deltas[first], layer.outputStride, nPatterns, last - first, next.nNodes);
+    if(Hidden::unitDerivative)
+    {
+        return;
+    }
+    for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+    {
+        Real* deltas = &work.deltas[nRow * layer.outputStride];
+        const Real* derOutputs = &work.derOutputs[nRow * layer.outputStride];
+        for(unsigned neuroIndex = first; neuroIndex < last; ++neuroIndex)
+        {
+            deltas[neuroIndex] *= derOutputs[neuroIndex];
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#include "../include/parallelpatternreader.h"
+#include "../include/patternreader.h"
+#include "../include/threadpool.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+//Nominal size of the ranges of the file parsed by the threads.
+const std::size_t rangeSize = 1 << 22;
+
+//Finds the end of the line starting at begin (before end), and the start of the next one.
+const char* lineEnd(const char* begin, const char* end, const char*& next)
+{
+    const char* newLine = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    next = (newLine != NULL) ? newLine + 1 : end;
+    const char* last = (newLine != NULL) ? newLine : end;
+    if(last != begin && *(last - 1) == '\r')
+    {
+        --last;
+    }
+    return last;
+}
+}
+
+ParallelPatternReader::ParallelPatternReader(const std::string& fileName, unsigned nColumns, ThreadPool* pool)
+: m_fileName(fileName)
+, m_file(fileName)
+, m_nColumns(nColumns)
+, m_pool(pool)
+, m_nHeaderLines(0)
+, m_nRows(0)
+{
+    //Comments and empty lines before the data are skipped here, sequentially.
+    const char* data = m_file.data();
+    const char* end = data + m_file.size();
+    const char* position = data;
+    while(position != end)
+    {
+        const char* next;
+        const char* last = lineEnd(position, end, next);
+        if(!PatternReader::isEmptyLine(position, last) && *position != '#')
+        {
+            break;
+        }
+        ++m_nHeaderLines;
+        position = next;
+    }
+    //Each range starts after the first end of line at or after its nominal start.
+    std::size_t first = position - data;
+    for(std::size_t start = first; start < m_file.size(); )
+    {
+        std::size_t nominalEnd = start + rangeSize;
+        std::size_t rangeEnd = m_file.size();
+        if(nominalEnd < m_file.size())
+        {
+            const char* newLine = static_cast<const char*>(std::memchr(data + nominalEnd - 1, '\n', m_file.size() - nominalEnd + 1));
+            rangeEnd = (newLine != NULL) ? newLine + 1 - data : m_file.size();
+        }
+        m_rangeStarts.push_back(start);
+        m_rangeEnds.push_back(rangeEnd);
+        start = rangeEnd;
+    }
+    //The lines of each range are counted in parallel, up to the first empty line, which
+    //ends the data: the following ranges are then left out.
+    unsigned nRanges = m_rangeStarts.size();
+    std::vector<unsigned> nLines(nRanges, 0);
+    std::vector<char> ended(nRanges, 0);
+    forRanges([&](unsigned range)
+    {
+        const char* line = data + m_rangeStarts[range];
+        const char* rangeEnd = data + m_rangeEnds[range];
+        while(line != rangeEnd)
+        {
+            const char* next;
+            if(PatternReader::isEmptyLine(line, lineEnd(line, rangeEnd, next)))
+            {
+                ended[range] = 1;
+                return;
+            }
+            ++nLines[range];
+            line = next;
+        }
+    });
+    m_firstRows.assign(nRanges, 0);
+    m_rangeRows.assign(nRanges, 0);
+    bool finished = false;
+    for(unsigned range = 0; range < nRanges && !finished; ++range)
+    {
+        m_firstRows[range] = m_nRows;
+        m_rangeRows[range] = nLines[range];
+        m_nRows += nLines[range];
+        finished = (ended[range] != 0);
+    }
+}
+
+void ParallelPatternReader::read(const std::function<void(unsigned, unsigned, const double*)>& body) const
+{
+    read(0, m_rangeStarts.size(), body);
+}
+
+void ParallelPatternReader::read(unsigned firstRange, unsigned lastRange, const std::function<void(unsigned, unsigned, const double*)>& body) const
+{
+    //Each range keeps the first error it finds, and the first one in the file is reported.
+    unsigned nRanges = m_rangeStarts.size();
+    std::vector<std::string> errors(nRanges);
+    std::vector<unsigned> errorLines(nRanges, 0);
+    forRanges(firstRange, lastRange, [&](unsigned range)
+    {
+        const char* line = m_file.data() + m_rangeStarts[range];
+        const char* rangeEnd = m_file.data() + m_rangeEnds[range];
+        std::vector<double> values(m_nColumns);
+        for(unsigned nRow = m_firstRows[range]; nRow < m_firstRows[range] + m_rangeRows[range]; ++nRow)
+        {
+            const char* next;
+            const char* last = lineEnd(line, rangeEnd, next);
+            if(!PatternReader::parseLine(line, last, &values[0], m_nColumns, errors[range]))
+            {
+                errorLines[range] = m_nHeaderLines + nRow + 1;
+                return;
+            }
+            body(range, nRow, &values[0]);
+            line = next;
+        }
+    });
+    for(unsigned range = firstRange; range < lastRange; ++range)
+    {
+        if(errorLines[range] != 0)
+        {
+            std::cerr << "Malformed line " << errorLines[range] << " of " << m_fileName << ": " << errors[range] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void ParallelPatternReader::forRanges(unsigned firstRange, unsigned lastRange, const std::function<void(unsigned)>& body) const
+{
+    if(m_pool != NULL)
+    {
+        m_pool->parallelFor(firstRange, lastRange, body);
+    }
+    else
+    {
+        for(unsigned range = firstRange; range < lastRange; ++range)
+        {
+            body(range);
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "../include/patterncache.h"
+#include "../include/patternsmanager.h"
+#include "../include/layer.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+const char signature[8] = {'N', 'N', 'P', 'A', 'T', 'B', 'I', 'N'};
+const std::uint32_t currentVersion = 1;
+const std::uint32_t byteOrderMark = 0x01020304;
+
+//Offsets of the blocks are rounded up to a cache line.
+std::uint64_t alignedOffset(std::uint64_t offset)
+{
+    return (offset + 63) / 64 * 64;
+}
+
+void writeOrExit(std::FILE* file, const void* data, std::size_t size, const std::string& fileName)
+{
+    if(size > 0 && std::fwrite(data, 1, size, file) != size)
+    {
+        std::cerr << "Error writing " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void padTo(std::FILE* file, std::uint64_t& position, std::uint64_t offset, const std::string& fileName)
+{
+    static const char zeros[64] = {0};
+    writeOrExit(file, zeros, offset - position, fileName);
+    position = offset;
+}
+}
+
+bool PatternCache::isCache(const std::string& fileName)
+{
+    char start[sizeof(signature)];
+    std::FILE* file = std::fopen(fileName.c_str(), "rb");
+    if(file == NULL)
+    {
+        return false;
+    }
+    bool found = std::fread(start, 1, sizeof(start), file) == sizeof(start) && std::memcmp(start, signature, sizeof(signature)) == 0;
+    std::fclose(file);
+    return found;
+}
+
+const PatternCacheHeader& PatternCache::header(const MappedFile& file, const std::string& fileName, unsigned inColumns, unsigned outColumns)
+{
+    if(file.size() < sizeof(PatternCacheHeader))
+    {
+        std::cerr << fileName << " is too short for a binary pattern file" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const PatternCacheHeader& header = *reinterpret_cast<const PatternCacheHeader*>(file.data());
+    if(std::memcmp(header.magic, signature, sizeof(signature)) != 0 || header.version != currentVersion || header.byteOrder != byteOrderMark)
+    {
+        std::cerr << fileName << " is not a binary pattern file of version " << currentVersion << " for this machine" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(header.inColumns != inColumns || header.outColumns != outColumns)
+    {
+        std::cerr << fileName << " has " << header.inColumns << " input and " << header.outColumns << " output columns, instead of "
+                  << inColumns << " and " << outColumns << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    //The matrices are used where they are mapped, by kernels expecting the padded rows
+    //and the alignment written by this class.
+    std::uint64_t statisticsEnd = header.statisticsOffset + 4 * (static_cast<std::uint64_t>(header.inColumns) + header.outColumns) * sizeof(double);
+    if(header.inStride != paddedStride<double>(header.inColumns) || header.outStride != paddedStride<double>(header.outColumns)
+       || header.statisticsOffset % 64 != 0 || header.inputsOffset % 64 != 0 || header.outputsOffset % 64 != 0
+       || header.statisticsOffset < sizeof(PatternCacheHeader) || statisticsEnd > header.inputsOffset)
+    {
+        std::cerr << fileName << " has an invalid layout" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if(header.nRows > std::numeric_limits<unsigned>::max())
+    {
+        std::cerr << fileName << " has more patterns than can be used (" << header.nRows << ")" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    //The sizes are compared with what is left after each offset, so that they cannot wrap.
+    if(header.inputsOffset > file.size() || header.nRows * header.inStride * sizeof(double) > file.size() - header.inputsOffset
+       || header.outputsOffset > file.size() || header.nRows * header.outStride * sizeof(double) > file.size() - header.outputsOffset)
+    {
+        std::cerr << fileName << " is truncated" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return header;
+}
+
+void PatternCache::write(const std::string& fileName, const PatternsManager& pm)
+{
+    PatternCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, signature, sizeof(signature));
+    header.version = currentVersion;
+    header.byteOrder = byteOrderMark;
+    header.inColumns = pm.inMins().size();
+    header.outColumns = pm.outMins().size();
+    header.nRows = pm.numberOfInputPatterns();
+    header.inStride = paddedStride<double>(header.inColumns);
+    header.outStride = paddedStride<double>(header.outColumns);
+    header.statisticsOffset = alignedOffset(sizeof(header));
+    header.inputsOffset = alignedOffset(header.statisticsOffset + 4 * (header.inColumns + header.outColumns) * sizeof(double));
+    header.outputsOffset = alignedOffset(header.inputsOffset + header.nRows * header.inStride * sizeof(double));
+
+    std::FILE* file = std::fopen(fileName.c_str(), "wb");
+    if(file == NULL)
+    {
+        std::cerr << "Unable to open " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::uint64_t position = 0;
+    writeOrExit(file, &header, sizeof(header), fileName);
+    position += sizeof(header);
+    padTo(file, position, header.statisticsOffset, fileName);
+    const std::vector<double>* statistics[8] = {&pm.inMins(), &pm.inMaxs(), &pm.inMeans(), &pm.inStdDevs(),
+                                                &pm.outMins(), &pm.outMaxs(), &pm.outMeans(), &pm.outStdDevs()};
+    for(unsigned block = 0; block < 8; ++block)
+    {
+        writeOrExit(file, statistics[block]->data(), statistics[block]->size() * sizeof(double), fileName);
+        position += statistics[block]->size() * sizeof(double);
+    }
+    //The matrices in memory have the layout of the file (rows padded with zeros),
+    //and are written at once.
+    padTo(file, position, header.inputsOffset, fileName);
+    writeOrExit(file, pm.inputMatrix(), header.nRows * header.inStride * sizeof(double), fileName);
+    position += header.nRows * header.inStride * sizeof(double);
+    padTo(file, position, header.outputsOffset, fileName);
+    writeOrExit(file, pm.outputMatrix(), header.nRows * header.outStride * sizeof(double), fileName);
+    if(std::fclose(file) != 0)
+    {
+        std::cerr << "Error writing " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,169 @@
+#include "../include/patternreader.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+
+namespace
+{
+//Size of the blocks read from the file.
+const std::size_t blockSize = 1 << 20;
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+}
+
+PatternReader::PatternReader(const std::string& fileName, unsigned nColumns)
+: m_fileName(fileName)
+, m_file(std::fopen(fileName.c_str(), "rb"))
+, m_nColumns(nColumns)
+, m_buffer(blockSize)
+, m_position(0)
+, m_size(0)
+, m_lineNumber(0)
+, m_inData(false)
+, m_finished(false)
+{
+    if(m_file == NULL)
+    {
+        std::cerr << "Could not open " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+PatternReader::~PatternReader()
+{
+    std::fclose(m_file);
+}
+
+bool PatternReader::readRow(double* values)
+{
+    const char* begin;
+    const char* end;
+    while(!m_finished && nextLine(begin, end))
+    {
+        //Comments and empty lines are skipped before the data, an empty line ends them.
+        if(isEmptyLine(begin, end) || (!m_inData && *begin == '#'))
+        {
+            if(m_inData)
+            {
+                m_finished = true;
+            }
+            continue;
+        }
+        m_inData = true;
+        std::string error;
+        if(!parseLine(begin, end, values, m_nColumns, error))
+        {
+            std::cerr << "Malformed line " << m_lineNumber << " of " << m_fileName << ": " << error << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return true;
+    }
+    m_finished = true;
+    return false;
+}
+
+bool PatternReader::isEmptyLine(const char* begin, const char* end)
+{
+    while(begin != end && isBlank(*begin))
+    {
+        ++begin;
+    }
+    return begin == end;
+}
+
+bool PatternReader::parseLine(const char* begin, const char* end, double* values, unsigned nColumns, std::string& error)
+{
+    const char* position = begin;
+    for(unsigned column = 0; column < nColumns; ++column)
+    {
+        while(position != end && isBlank(*position))
+        {
+            ++position;
+        }
+        //Values after the first one can also be separated by a comma.
+        if(column > 0 && position != end && *position == ',')
+        {
+            ++position;
+            while(position != end && isBlank(*position))
+            {
+                ++position;
+            }
+        }
+        if(position == end)
+        {
+            error = "expected " + std::to_string(nColumns) + " values, found " + std::to_string(column);
+            return false;
+        }
+        //std::from_chars does not accept an explicit plus sign.
+        const char* number = (*position == '+') ? position + 1 : position;
+        std::from_chars_result result = std::from_chars(number, end, values[column]);
+        if(result.ec != std::errc() || (result.ptr != end && !isBlank(*result.ptr) && *result.ptr != ','))
+        {
+            const char* wordEnd = position;
+            while(wordEnd != end && !isBlank(*wordEnd) && *wordEnd != ',')
+            {
+                ++wordEnd;
+            }
+            error = "value " + std::to_string(column + 1) + " (\"" + std::string(position, wordEnd) + "\") is not a number";
+            return false;
+        }
+        position = result.ptr;
+    }
+    while(position != end && (isBlank(*position) || *position == ','))
+    {
+        ++position;
+    }
+    if(position != end)
+    {
+        error = "more than the expected " + std::to_string(nColumns) + " values";
+        return false;
+    }
+    return true;
+}
+
+bool PatternReader::nextLine(const char*& begin, const char*& end)
+{
+    while(true)
+    {
+        char* first = &m_buffer[0] + m_position;
+        char* newLine = static_cast<char*>(std::memchr(first, '\n', m_size - m_position));
+        bool atEnd = std::feof(m_file) != 0;
+        if(newLine != NULL || (atEnd && m_position < m_size))
+        {
+            //The last line of the file can lack the end of line.
+            char* last = (newLine != NULL) ? newLine : &m_buffer[0] + m_size;
+            m_position = last - &m_buffer[0] + ((newLine != NULL) ? 1 : 0);
+            if(last != first && *(last - 1) == '\r')
+            {
+                --last;
+            }
+            begin = first;
+            end = last;
+            ++m_lineNumber;
+            return true;
+        }
+        if(atEnd)
+        {
+            return false;
+        }
+        //The incomplete line is moved to the start of the buffer, which is enlarged
+        //if the line does not fit, and the following block is appended.
+        std::size_t remaining = m_size - m_position;
+        std::memmove(&m_buffer[0], first, remaining);
+        if(remaining == m_buffer.size())
+        {
+            m_buffer.resize(2 * m_buffer.size());
+        }
+        m_position = 0;
+        m_size = remaining + std::fread(&m_buffer[remaining], 1, m_buffer.size() - remaining, m_file);
+        if(std::ferror(m_file))
+        {
+            std::cerr << "Error reading " << m_fileName << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
@@ -1,180 +1,506 @@
 #include "../include/patternsmanager.h"
+#include "../include/parallelpatternreader.h"
+#include "../include/patterncache.h"
+#include "../include/patternstream.h"
+#include "../include/threadpool.h"
+#include "../include/layer.h"
+#include "../include/kernels.h"
+#include <algorithm>
 #include <iostream>
 #include <cstdlib>
-#include <sstream>
 #include <cmath>
-PatternsManager::PatternsManager(unsigned inputPatternSize, unsigned outputSize)
+
+namespace
+{
+    /**
+    * @brief Number of patterns in each block of the statistics and of the scaling.
+    */
+    const unsigned patternBlock = 4096;
+
+    /**
+    * @brief Subtracts an offset from each value and divides it by a divisor.
+    */
+    void scaleValues(const double* values, const double* offsets, const double* divisors, unsigned nValues, double* scaled)
+    {
+        for(unsigned i = 0; i < nValues; ++i)
+        {
+            scaled[i] = (values[i] - offsets[i]) / divisors[i];
+        }
+    }
+
+    void scaleValues(double* values, const double* offsets, const double* divisors, unsigned nValues)
+    {
+        scaleValues(values, offsets, divisors, nValues, values);
+    }
+
+    /**
+    * @brief Calls body(block) for each block, sharing the blocks among the threads if
+    * there is a pool.
+    */
+    template<class Body>
+    void forBlocks(ThreadPool* pool, unsigned nBlocks, const Body& body)
+    {
+        if(pool != NULL)
+        {
+            pool->parallelFor(0, nBlocks, body);
+        }
+        else
+        {
+            for(unsigned block = 0; block < nBlocks; ++block)
+            {
+                body(block);
+            }
+        }
+    }
+}
+
+PatternsManager::PatternsManager(unsigned inputPatternSize, unsigned outputSize, ThreadPool* pool, Storage storage)
 : m_inputPatternSize(inputPatternSize)
 , m_outputSize(outputSize)
+, m_nPatterns(0)
+, m_pool(pool)
+, m_storage(storage)
+, m_scalingType("none")
+, m_dataScaled(false)
+, m_inputMatrix(NULL)
+, m_inputStride(paddedStride<double>(inputPatternSize))
+, m_outputMatrix(NULL)
+, m_outputStride(paddedStride<double>(outputSize))
+, m_mapping(NULL)
 {
 
 }
 
+PatternsManager::~PatternsManager()
+{
+    delete m_mapping;
+}
+
 unsigned PatternsManager::numberOfInputPatterns() const
 {
-    return m_inputPatterns.size();
+    return m_nPatterns;
 }
 
 unsigned PatternsManager::numberOfOutputs() const
 {
-    return m_outputs.size();
+    return m_nPatterns;
 }
 
-const std::vector<double>& PatternsManager::getInputPattern(unsigned nIn) const
+void PatternsManager::readFile(const std::string& fileName)
 {
-    return m_inputPatterns[nIn];
+    if(m_storage != DOUBLE_STORAGE)
+    {
+        readQuantised(fileName);
+        return;
+    }
+    if(PatternCache::isCache(fileName))
+    {
+        readCache(fileName);
+        return;
+    }
+    //Each line holds the inputs followed by the outputs of a pattern. The lines are
+    //counted first, and then parsed in parallel straight into their rows of the two
+    //matrices (the padding of the rows stays zero).
+    clearPatterns();
+    ParallelPatternReader reader(fileName, m_inputPatternSize + m_outputSize, m_pool);
+    m_nPatterns = reader.nRows();
+    if(m_nPatterns == 0)
+    {
+        std::cerr << "No patterns found in " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    m_inputStorage.assign(static_cast<std::size_t>(m_nPatterns) * m_inputStride, 0.0);
+    m_outputStorage.assign(static_cast<std::size_t>(m_nPatterns) * m_outputStride, 0.0);
+    reader.read([this](unsigned, unsigned nRow, const double* row)
+    {
+        std::copy(row, row + m_inputPatternSize, m_inputStorage.begin() + static_cast<std::size_t>(nRow) * m_inputStride);
+        std::copy(row + m_inputPatternSize, row + m_inputPatternSize + m_outputSize, m_outputStorage.begin() + static_cast<std::size_t>(nRow) * m_outputStride);
+    });
+    m_inputMatrix = m_inputStorage.data();
+    m_outputMatrix = m_outputStorage.data();
+    computeStatistics();
 }
 
-const std::vector<double>& PatternsManager::getOutput(unsigned nOut) const
+void PatternsManager::readStatistics(const std::string& fileName)
 {
-    return m_outputs[nOut];
+    clearPatterns();
+    if(PatternCache::isCache(fileName))
+    {
+        MappedFile file(fileName);
+        m_nPatterns = PatternCache::header(file, fileName, m_inputPatternSize, m_outputSize).nRows;
+        readCacheStatistics(file);
+        return;
+    }
+    //A single pass over the file: only the statistics are kept.
+    std::vector<double> row(m_inputPatternSize + m_outputSize);
+    RunningStatistics inStatistics(m_inputPatternSize);
+    RunningStatistics outStatistics(m_outputSize);
+    PatternStream stream(fileName, m_inputPatternSize, m_outputSize);
+    while(stream.readRow(&row[0]))
+    {
+        inStatistics.add(&row[0]);
+        outStatistics.add(&row[m_inputPatternSize]);
+    }
+    m_nPatterns = inStatistics.count();
+    if(m_nPatterns == 0)
+    {
+        std::cerr << "No patterns found in " << fileName << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    storeStatistics(inStatistics, outStatistics);
 }
 
-void PatternsManager::readFile(const std::string& fileName)
+void PatternsManager::computeStatistics()
 {
-    std::string fileNameCopy = fileName;
-    std::ifstream file(fileNameCopy.c_str());
-    if(!file.is_open())
+    //The blocks do not depend on the number of threads, and are merged in order,
+    //so that the statistics are always the same.
+    unsigned nBlocks = (m_nPatterns + patternBlock - 1) / patternBlock;
+    std::vector<RunningStatistics> inStatistics(nBlocks, RunningStatistics(m_inputPatternSize));
+    std::vector<RunningStatistics> outStatistics(nBlocks, RunningStatistics(m_outputSize));
+    auto body = [&](unsigned block)
     {
-        std::cerr << "Could not open " << fileNameCopy << std::endl;
-        exit(EXIT_FAILURE);
+        unsigned last = std::min((block + 1) * patternBlock, m_nPatterns);
+        for(unsigned nPattern = block * patternBlock; nPattern < last; ++nPattern)
+        {
+            inStatistics[block].add(m_inputMatrix + static_cast<std::size_t>(nPattern) * m_inputStride);
+            outStatistics[block].add(m_outputMatrix + static_cast<std::size_t>(nPattern) * m_outputStride);
+        }
+    };
+    forBlocks(m_pool, nBlocks, body);
+    for(unsigned block = 1; block < nBlocks; ++block)
+    {
+        inStatistics[0].merge(inStatistics[block]);
+        outStatistics[0].merge(outStatistics[block]);
     }
-    std::string line;
-    do
+    storeStatistics(inStatistics[0], outStatistics[0]);
+}
+
+void PatternsManager::storeStatistics(const RunningStatistics& inStatistics, const RunningStatistics& outStatistics)
+{
+    m_inMins = inStatistics.mins();
+    m_inMaxs = inStatistics.maxs();
+    m_inMeans = inStatistics.means();
+    m_inStdDevs = inStatistics.stdDevs();
+    m_outMins = outStatistics.mins();
+    m_outMaxs = outStatistics.maxs();
+    m_outMeans = outStatistics.means();
+    m_outStdDevs = outStatistics.stdDevs();
+}
+
+void PatternsManager::clearPatterns()
+{
+    AlignedVector().swap(m_inputStorage);
+    AlignedVector().swap(m_outputStorage);
+    std::vector<std::uint8_t>().swap(m_inputs8);
+    std::vector<std::uint16_t>().swap(m_inputs16);
+    delete m_mapping;
+    m_mapping = NULL;
+    m_inputMatrix = NULL;
+    m_outputMatrix = NULL;
+    m_inputStride = paddedStride<double>(m_inputPatternSize);
+    m_outputStride = paddedStride<double>(m_outputSize);
+    m_nPatterns = 0;
+    m_dataScaled = false;
+}
+
+void PatternsManager::readCache(const std::string& fileName)
+{
+    //The statistics are stored in the file, and its matrices are used in place: the
+    //mapping is copy-on-write, so that scaling only copies the pages it changes.
+    clearPatterns();
+    m_mapping = new MappedFile(fileName, true);
+    const PatternCacheHeader& header = PatternCache::header(*m_mapping, fileName, m_inputPatternSize, m_outputSize);
+    readCacheStatistics(*m_mapping);
+    m_nPatterns = header.nRows;
+    m_inputStride = header.inStride;
+    m_outputStride = header.outStride;
+    m_inputMatrix = reinterpret_cast<double*>(m_mapping->mutableData() + header.inputsOffset);
+    m_outputMatrix = reinterpret_cast<double*>(m_mapping->mutableData() + header.outputsOffset);
+}
+
+void PatternsManager::readCacheStatistics(const MappedFile& file)
+{
+    const PatternCacheHeader& header = *reinterpret_cast<const PatternCacheHeader*>(file.data());
+    const double* statistics = reinterpret_cast<const double*>(file.data() + header.statisticsOffset);
+    std::vector<double>* inStatistics[4] = {&m_inMins, &m_inMaxs, &m_inMeans, &m_inStdDevs};
+    for(unsigned block = 0; block < 4; ++block)
     {
-        getline(file,line);
+        inStatistics[block]->assign(statistics, statistics + m_inputPatternSize);
+        statistics += m_inputPatternSize;
     }
-    while(line.length() <= 1 || line[0] == '#');
-    std::vector<double> inputPattern(m_inputPatternSize);
-    std::vector<double> output(m_outputSize);
-    m_inMins.resize(m_inputPatternSize, 1e10);
-    m_inMaxs.resize(m_inputPatternSize, -1e10);
-    m_inMeans.resize(m_inputPatternSize, 0.0);
-    m_outMins.resize(m_outputSize, 1e10);
-    m_outMaxs.resize(m_outputSize, -1e10);
-    m_outMeans.resize(m_outputSize, 0.0);
-    do
+    std::vector<double>* outStatistics[4] = {&m_outMins, &m_outMaxs, &m_outMeans, &m_outStdDevs};
+    for(unsigned block = 0; block < 4; ++block)
     {
-        std::stringstream lineStream(line);
+        outStatistics[block]->assign(statistics, statistics + m_outputSize);
+        statistics += m_outputSize;
+    }
+}
 
-        for(int in = 0; in < inputPattern.size(); ++in)
+void PatternsManager::readQuantised(const std::string& fileName)
+{
+    //The range of each column is needed before the patterns are stored: a binary file has
+    //the statistics stored, a text file is parsed twice, first for the statistics.
+    auto allocate = [this]()
+    {
+        double levels = (m_storage == UINT8_STORAGE) ? 255.0 : 65535.0;
+        m_quantisationSteps.resize(m_inputPatternSize);
+        for(unsigned nEntry = 0; nEntry < m_inputPatternSize; ++nEntry)
         {
-            lineStream >> inputPattern[in];
-            m_inMeans[in] += inputPattern[in];
-            if(inputPattern[in] < m_inMins[in])
-            {
-                m_inMins[in] = inputPattern[in];
-            }
-            if(inputPattern[in] > m_inMaxs[in])
-            {
-                m_inMaxs[in] = inputPattern[in];
-            }
+            //A constant column is stored as zeros.
+            double range = m_inMaxs[nEntry] - m_inMins[nEntry];
+            m_quantisationSteps[nEntry] = (range > 0.0) ? range / levels : 1.0;
         }
-        for(int out = 0; out < output.size(); ++out)
+        std::size_t nValues = static_cast<std::size_t>(m_nPatterns) * m_inputPatternSize;
+        if(m_storage == UINT8_STORAGE)
         {
-            lineStream >> output[out];
-            m_outMeans[out] += output[out];
-            if(output[out] < m_outMins[out])
-            {
-                m_outMins[out] = output[out];
-            }
-            if(output[out] > m_outMaxs[out])
+            m_inputs8.assign(nValues, 0);
+        }
+        else
+        {
+            m_inputs16.assign(nValues, 0);
+        }
+        m_outputStorage.assign(static_cast<std::size_t>(m_nPatterns) * m_outputStride, 0.0);
+        m_outputMatrix = m_outputStorage.data();
+    };
+    if(PatternCache::isCache(fileName))
+    {
+        //The patterns are quantised from the mapping of the file, in blocks shared among
+        //the threads, and the mapping is released.
+        readStatistics(fileName);
+        allocate();
+        MappedFile file(fileName);
+        const PatternCacheHeader& header = PatternCache::header(file, fileName, m_inputPatternSize, m_outputSize);
+        const double* inputs = reinterpret_cast<const double*>(file.data() + header.inputsOffset);
+        const double* outputs = reinterpret_cast<const double*>(file.data() + header.outputsOffset);
+        unsigned nBlocks = (m_nPatterns + patternBlock - 1) / patternBlock;
+        forBlocks(m_pool, nBlocks, [&](unsigned block)
+        {
+            unsigned last = std::min((block + 1) * patternBlock, m_nPatterns);
+            for(unsigned nPattern = block * patternBlock; nPattern < last; ++nPattern)
             {
-               m_outMaxs[out] = output[out];
+                const double* output = outputs + static_cast<std::size_t>(nPattern) * header.outStride;
+                quantisePattern(nPattern, inputs + static_cast<std::size_t>(nPattern) * header.inStride);
+                std::copy(output, output + m_outputSize, m_outputStorage.begin() + static_cast<std::size_t>(nPattern) * m_outputStride);
             }
+        });
+    }
+    else
+    {
+        //Both passes parse the ranges of the file in parallel; the statistics of each
+        //range are merged in order, so that they do not depend on the number of threads.
+        clearPatterns();
+        ParallelPatternReader reader(fileName, m_inputPatternSize + m_outputSize, m_pool);
+        m_nPatterns = reader.nRows();
+        if(m_nPatterns == 0)
+        {
+            std::cerr << "No patterns found in " << fileName << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::vector<RunningStatistics> inStatistics(reader.nRanges(), RunningStatistics(m_inputPatternSize));
+        std::vector<RunningStatistics> outStatistics(reader.nRanges(), RunningStatistics(m_outputSize));
+        reader.read([&](unsigned range, unsigned, const double* row)
+        {
+            inStatistics[range].add(row);
+            outStatistics[range].add(row + m_inputPatternSize);
+        });
+        for(unsigned range = 1; range < reader.nRanges(); ++range)
+        {
+            inStatistics[0].merge(inStatistics[range]);
+            outStatistics[0].merge(outStatistics[range]);
         }
-        m_inputPatterns.push_back(inputPattern);
-        m_outputs.push_back(output);
+        storeStatistics(inStatistics[0], outStatistics[0]);
+        allocate();
+        reader.read([this](unsigned, unsigned nRow, const double* row)
+        {
+            quantisePattern(nRow, row);
+            std::copy(row + m_inputPatternSize, row + m_inputPatternSize + m_outputSize, m_outputStorage.begin() + static_cast<std::size_t>(nRow) * m_outputStride);
+        });
     }
-    while(getline(file,line) && line.length() > 1);
-    for(int in = 0; in < m_inMeans.size(); ++in)
+    setDequantisation();
+}
+
+void PatternsManager::quantisePattern(unsigned nPattern, const double* inputPattern)
+{
+    //Each value is rounded to the nearest step from the minimum of its column.
+    double levels = (m_storage == UINT8_STORAGE) ? 255.0 : 65535.0;
+    std::size_t first = static_cast<std::size_t>(nPattern) * m_inputPatternSize;
+    for(unsigned nEntry = 0; nEntry < m_inputPatternSize; ++nEntry)
     {
-        m_inMeans[in] /= m_inputPatterns.size();
+        double level = std::floor((inputPattern[nEntry] - m_inMins[nEntry]) / m_quantisationSteps[nEntry] + 0.5);
+        level = std::min(std::max(level, 0.0), levels);
+        if(m_storage == UINT8_STORAGE)
+        {
+            m_inputs8[first + nEntry] = static_cast<std::uint8_t>(level);
+        }
+        else
+        {
+            m_inputs16[first + nEntry] = static_cast<std::uint16_t>(level);
+        }
     }
-    for(int out = 0; out < m_outMeans.size(); ++out)
+}
+
+void PatternsManager::setDequantisation()
+{
+    //A quantised value q stands for min + q * step, which the scaling turns into
+    //(min + q * step - offset) / divisor: a single scale and offset per column.
+    if(m_quantisationSteps.empty())
     {
-        m_outMeans[out] /= m_outputs.size();
+        return;
     }
-    
-    m_inStdDevs.resize(m_inputPatternSize,0.0);
-    for(int nPattern = 0; nPattern < m_inputPatterns.size(); ++nPattern)
+    m_dequantisationScales.resize(m_inputPatternSize);
+    m_dequantisationShifts.resize(m_inputPatternSize);
+    for(unsigned nEntry = 0; nEntry < m_inputPatternSize; ++nEntry)
     {
-        for(int in = 0; in < m_inStdDevs.size(); ++in)
-        {
-            m_inStdDevs[in] += (m_inputPatterns[nPattern][in] - m_inMeans[in]) * (m_inputPatterns[nPattern][in] - m_inMeans[in]);
-        }
+        double offset = m_inOffsets.empty() ? 0.0 : m_inOffsets[nEntry];
+        double divisor = m_inDivisors.empty() ? 1.0 : m_inDivisors[nEntry];
+        m_dequantisationScales[nEntry] = m_quantisationSteps[nEntry] / divisor;
+        m_dequantisationShifts[nEntry] = (m_inMins[nEntry] - offset) / divisor;
     }
-    for(int in = 0; in < m_inStdDevs.size(); ++in)
+}
+
+void PatternsManager::dequantiseInputPattern(unsigned nIn, double* inputPattern) const
+{
+    std::size_t first = static_cast<std::size_t>(nIn) * m_inputPatternSize;
+    if(m_storage == UINT8_STORAGE)
+    {
+        Kernels::dequantise(&m_inputs8[first], m_dequantisationScales.data(), m_dequantisationShifts.data(), inputPattern, m_inputPatternSize);
+    }
+    else
     {
-        m_inStdDevs[in] /= m_inputPatterns.size();
-        m_inStdDevs[in] = sqrt(m_inStdDevs[in]);
+        Kernels::dequantise(&m_inputs16[first], m_dequantisationScales.data(), m_dequantisationShifts.data(), inputPattern, m_inputPatternSize);
     }
-    
-    m_outStdDevs.resize(m_outputSize,0.0);
-    for(int nPattern = 0; nPattern < m_outputs.size(); ++nPattern)
+}
+
+void PatternsManager::setScaling(const std::string& scalingType)
+{
+    m_scalingType = scalingType;
+    //Both scalings subtract an offset and divide by a divisor, computed once.
+    if(scalingType == "normal")
     {
-        for(int out = 0; out < m_outStdDevs.size(); ++out)
+        m_inOffsets = m_inMins;
+        m_outOffsets = m_outMins;
+        m_inDivisors.resize(m_inputPatternSize);
+        m_outDivisors.resize(m_outputSize);
+        for(unsigned nEntry = 0; nEntry < m_inputPatternSize; ++nEntry)
         {
-            m_outStdDevs[out] += (m_outputs[nPattern][out] - m_outMeans[out]) * (m_outputs[nPattern][out] - m_outMeans[out]);
+            m_inDivisors[nEntry] = m_inMaxs[nEntry] - m_inMins[nEntry];
         }
+        for(unsigned nEntry = 0; nEntry < m_outputSize; ++nEntry)
+        {
+            m_outDivisors[nEntry] = m_outMaxs[nEntry] - m_outMins[nEntry];
+        }
+    }
+    else if(scalingType == "mean")
+    {
+        m_inOffsets = m_inMeans;
+        m_outOffsets = m_outMeans;
+        m_inDivisors = m_inStdDevs;
+        m_outDivisors = m_outStdDevs;
     }
-    for(int out = 0; out < m_outStdDevs.size(); ++out)
+    else
     {
-        m_outStdDevs[out] /= m_outputs.size();
-        m_outStdDevs[out] = sqrt(m_outStdDevs[out]);
+        m_inOffsets.clear();
+        m_inDivisors.clear();
+        m_outOffsets.clear();
+        m_outDivisors.clear();
     }
-    file.close();
+    setDequantisation();
 }
 
 void PatternsManager::scale(const std::string& scalingType)
 {
-    if(scalingType == "none")
+    setScaling(scalingType);
+    if(m_inOffsets.empty())
     {
         return;
     }
-    if(scalingType == "normal")
+    //Streamed data are not in memory, and are scaled as they are read. Quantised inputs
+    //are scaled when they are dequantised, and only their outputs are rewritten.
+    unsigned nBlocks = (m_outputMatrix != NULL) ? (m_nPatterns + patternBlock - 1) / patternBlock : 0;
+    forBlocks(m_pool, nBlocks, [&](unsigned block)
     {
-        for(unsigned nPattern = 0; nPattern < m_inputPatterns.size(); ++nPattern)
+        unsigned last = std::min((block + 1) * patternBlock, m_nPatterns);
+        for(unsigned nPattern = block * patternBlock; nPattern < last; ++nPattern)
         {
-            for(unsigned nEntry = 0; nEntry < m_inputPatterns[nPattern].size(); ++nEntry)
+            if(m_inputMatrix != NULL)
             {
-                m_inputPatterns[nPattern][nEntry] = (m_inputPatterns[nPattern][nEntry] - m_inMins[nEntry]) / (m_inMaxs[nEntry] - m_inMins[nEntry]);
+                scalePattern(m_inputMatrix + static_cast<std::size_t>(nPattern) * m_inputStride, m_outputMatrix + static_cast<std::size_t>(nPattern) * m_outputStride);
             }
-        }
-        for(unsigned nPattern = 0; nPattern < m_outputs.size(); ++nPattern)
-        {
-            for(unsigned nEntry = 0; nEntry < m_outputs[nPattern].size(); ++nEntry)
+            else
             {
-                m_outputs[nPattern][nEntry] = (m_outputs[nPattern][nEntry] - m_outMins[nEntry]) / (m_outMaxs[nEntry] - m_outMins[nEntry]);
+                scaleOutput(m_outputMatrix + static_cast<std::size_t>(nPattern) * m_outputStride);
             }
         }
+    });
+    m_dataScaled = (m_outputMatrix != NULL);
+}
+
+void PatternsManager::scalePattern(double* inputPattern, double* output) const
+{
+    if(m_inOffsets.empty())
+    {
+        return;
+    }
+    scaleValues(inputPattern, m_inOffsets.data(), m_inDivisors.data(), m_inputPatternSize);
+    scaleValues(output, m_outOffsets.data(), m_outDivisors.data(), m_outputSize);
+}
+
+void PatternsManager::copyPattern(unsigned nPattern, double* inputPattern, double* output) const
+{
+    //The values are scaled as they are copied, in the same pass, as dequantisation does.
+    bool scaled = unscaledData();
+    if(quantisedInputs())
+    {
+        dequantiseInputPattern(nPattern, inputPattern);
     }
-    if(scalingType == "mean")
+    else
     {
-        for(unsigned nPattern = 0; nPattern < m_inputPatterns.size(); ++nPattern)
+        const double* storedInput = m_inputMatrix + static_cast<std::size_t>(nPattern) * m_inputStride;
+        if(scaled)
         {
-            for(unsigned nEntry = 0; nEntry < m_inputPatterns[nPattern].size(); ++nEntry)
-            {
-                m_inputPatterns[nPattern][nEntry] = (m_inputPatterns[nPattern][nEntry] - m_inMeans[nEntry]) / m_inStdDevs[nEntry];
-            }
+            scaleValues(storedInput, m_inOffsets.data(), m_inDivisors.data(), m_inputPatternSize, inputPattern);
         }
-        for(unsigned nPattern = 0; nPattern < m_outputs.size(); ++nPattern)
+        else
         {
-            for(unsigned nEntry = 0; nEntry < m_outputs[nPattern].size(); ++nEntry)
-            {
-                m_outputs[nPattern][nEntry] = (m_outputs[nPattern][nEntry] - m_outMeans[nEntry]) / m_outStdDevs[nEntry];
-            }
+            std::copy(storedInput, storedInput + m_inputPatternSize, inputPattern);
         }
     }
+    const double* storedOutput = m_outputMatrix + static_cast<std::size_t>(nPattern) * m_outputStride;
+    if(scaled && !m_outOffsets.empty())
+    {
+        scaleValues(storedOutput, m_outOffsets.data(), m_outDivisors.data(), m_outputSize, output);
+    }
+    else
+    {
+        std::copy(storedOutput, storedOutput + m_outputSize, output);
+    }
+}
+
+void PatternsManager::scaleOutput(double* output) const
+{
+    if(m_outOffsets.empty())
+    {
+        return;
+    }
+    scaleValues(output, m_outOffsets.data(), m_outDivisors.data(), m_outputSize);
 }
 
 std::ostream& operator<<(std::ostream& os, const PatternsManager& pm)
 {
+    std::vector<double> inputPattern(pm.inMins().size());
     for(unsigned nPattern = 0; nPattern < pm.numberOfInputPatterns(); ++nPattern)
     {
-        for(unsigned nEntry = 0; nEntry < pm.getInputPattern(nPattern).size(); ++nEntry)
+        if(pm.quantisedInputs())
+        {
+            pm.dequantiseInputPattern(nPattern, inputPattern.data());
+        }
+        else
+        {
+            std::copy(pm.getInputPattern(nPattern).begin(), pm.getInputPattern(nPattern).end(), inputPattern.begin());
+        }
+        for(unsigned nEntry = 0; nEntry < inputPattern.size(); ++nEntry)
         {
-            os << pm.getInputPattern(nPattern)[nEntry] << " ";
+            os << inputPattern[nEntry] << " ";
         }
         for(unsigned nEntry = 0; nEntry < pm.getOutput(nPattern).size(); ++nEntry)
         {
@@ -0,0 +1,45 @@
+#include "../include/patternstream.h"
+#include <algorithm>
+
+PatternStream::PatternStream(const std::string& fileName, unsigned inColumns, unsigned outColumns)
+: m_inColumns(inColumns)
+, m_outColumns(outColumns)
+, m_reader(NULL)
+, m_mapping(NULL)
+, m_header(NULL)
+, m_nextRow(0)
+{
+    if(PatternCache::isCache(fileName))
+    {
+        m_mapping = new MappedFile(fileName);
+        m_header = &PatternCache::header(*m_mapping, fileName, inColumns, outColumns);
+    }
+    else
+    {
+        m_reader = new PatternReader(fileName, inColumns + outColumns);
+    }
+}
+
+PatternStream::~PatternStream()
+{
+    delete m_reader;
+    delete m_mapping;
+}
+
+bool PatternStream::readRow(double* row)
+{
+    if(m_reader != NULL)
+    {
+        return m_reader->readRow(row);
+    }
+    if(m_nextRow == m_header->nRows)
+    {
+        return false;
+    }
+    const double* inputs = reinterpret_cast<const double*>(m_mapping->data() + m_header->inputsOffset) + m_nextRow * m_header->inStride;
+    const double* outputs = reinterpret_cast<const double*>(m_mapping->data() + m_header->outputsOffset) + m_nextRow * m_header->outStride;
+    std::copy(inputs, inputs + m_inColumns, row);
+    std::copy(outputs, outputs + m_outColumns, row + m_inColumns);
+    ++m_nextRow;
+    return true;
+}
@@ -0,0 +1,155 @@
+#include "../include/quantisedengine.h"
+#include "../include/linearalgebra.h"
+#include "../include/kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//Patterns propagated at once during the calibration.
+const unsigned calibrationBatch = 256;
+//Largest magnitude of a quantised weight, so that the weights are symmetric around 0.
+const double weightLevels = 127.0;
+//Largest quantised input.
+const double inputLevels = 255.0;
+}
+
+QuantisedEngine::QuantisedEngine(const InferenceEngine& source, const double* sample, unsigned sampleStride, unsigned nSample)
+: m_source(source)
+{
+    copyNet(source);
+    std::vector<std::vector<double> > mins;
+    std::vector<std::vector<double> > maxs;
+    calibrate(sample, sampleStride, nSample, mins, maxs);
+    m_quantised.resize(m_layers.size());
+    for(unsigned layer = 0; layer < m_layers.size(); ++layer)
+    {
+        const InferenceLayer& original = m_layers[layer];
+        QuantisedLayer& quantised = m_quantised[layer];
+        //Each input spans its calibrated range in 255 steps; an input which never changed
+        //(or a sample without patterns) is taken as constant.
+        std::vector<double> steps(original.nInputs, 0.0);
+        std::vector<double> inputMins(original.nInputs, 0.0);
+        quantised.inverseSteps.assign(original.nInputs, 0.0);
+        quantised.shifts.assign(original.nInputs, 0.0);
+        for(unsigned column = 0; column < original.nInputs; ++column)
+        {
+            if(mins[layer][column] <= maxs[layer][column])
+            {
+                inputMins[column] = mins[layer][column];
+                steps[column] = (maxs[layer][column] - mins[layer][column]) / inputLevels;
+            }
+            if(steps[column] > 0.0)
+            {
+                quantised.inverseSteps[column] = 1.0 / steps[column];
+                quantised.shifts[column] = -inputMins[column] / steps[column];
+            }
+        }
+        //The weights are multiplied by the steps of their inputs, and the lower ends of the
+        //ranges are added to the thresholds, in double precision.
+        quantised.stride = paddedStride<std::int8_t>(original.nInputs);
+        quantised.weights.assign(original.nNodes * quantised.stride, 0);
+        quantised.scales.assign(original.nNodes, 0.0);
+        quantised.biases.assign(original.nNodes, 0.0);
+        std::vector<double> stepWeights(original.nInputs);
+        for(unsigned neuroIndex = 0; neuroIndex < original.nNodes; ++neuroIndex)
+        {
+            const double* weights = original.weights + neuroIndex * original.stride;
+            double bias = original.thresholds[neuroIndex];
+            double largest = 0.0;
+            for(unsigned column = 0; column < original.nInputs; ++column)
+            {
+                stepWeights[column] = weights[column] * steps[column];
+                bias += weights[column] * inputMins[column];
+                largest = std::max(largest, std::fabs(stepWeights[column]));
+            }
+            double scale = largest / weightLevels;
+            for(unsigned column = 0; column < original.nInputs && scale > 0.0; ++column)
+            {
+                quantised.weights[neuroIndex * quantised.stride + column] = static_cast<std::int8_t>(std::lround(stepWeights[column] / scale));
+            }
+            quantised.scales[neuroIndex] = scale;
+            quantised.biases[neuroIndex] = bias;
+        }
+    }
+}
+
+InferenceWorkspace QuantisedEngine::workspace(unsigned batchCapacity) const
+{
+    //The inputs of a layer are quantised one pattern at a time.
+    InferenceWorkspace work = InferenceEngine::workspace(batchCapacity);
+    unsigned widest = 0;
+    for(unsigned layer = 0; layer < m_quantised.size(); ++layer)
+    {
+        widest = std::max(widest, m_quantised[layer].stride);
+    }
+    work.quantised.assign(widest, 0);
+    return work;
+}
+
+const double* QuantisedEngine::propagate(InferenceWorkspace& work, const double* inputs, unsigned inputStride, unsigned nPatterns) const
+{
+    double* outputs = NULL;
+    for(unsigned layer = 0; layer < m_layers.size(); ++layer)
+    {
+        const InferenceLayer& original = m_layers[layer];
+        const QuantisedLayer& quantised = m_quantised[layer];
+        outputs = &work.outputs[layer % 2][0];
+        std::uint8_t* levels = &work.quantised[0];
+        for(unsigned nRow = 0; nRow < nPatterns; ++nRow)
+        {
+            Kernels::quantise(inputs + nRow * inputStride, &quantised.inverseSteps[0], &quantised.shifts[0], levels, original.nInputs);
+            //The padding of the weights is 0, so the products run over whole padded rows,
+            //without the tails of the kernels.
+            double* sums = outputs + nRow * original.outputStride;
+            Kernels::multiply(levels, &quantised.weights[0], quantised.stride, original.nNodes, quantised.stride, &quantised.scales[0], &quantised.biases[0], sums);
+            m_source.activate(layer, sums, original.nNodes);
+        }
+        inputs = outputs;
+        inputStride = original.outputStride;
+    }
+    return outputs;
+}
+
+void QuantisedEngine::calibrate(const double* sample, unsigned sampleStride, unsigned nSample, std::vector<std::vector<double> >& mins, std::vector<std::vector<double> >& maxs) const
+{
+    //The sample is propagated in double precision, as by the original engine, and the
+    //inputs of each layer are recorded on the way.
+    mins.resize(m_layers.size());
+    maxs.resize(m_layers.size());
+    for(unsigned layer = 0; layer < m_layers.size(); ++layer)
+    {
+        mins[layer].assign(m_layers[layer].nInputs, std::numeric_limits<double>::max());
+        maxs[layer].assign(m_layers[layer].nInputs, -std::numeric_limits<double>::max());
+    }
+    InferenceWorkspace work = InferenceEngine::workspace(calibrationBatch);
+    for(unsigned first = 0; first < nSample; first += calibrationBatch)
+    {
+        unsigned nBatch = std::min(calibrationBatch, nSample - first);
+        unsigned inputStride = sampleStride;
+        const double* inputs = scaleInputs(sample + static_cast<std::size_t>(first) * sampleStride, inputStride, nBatch, work);
+        for(unsigned layer = 0; layer < m_layers.size(); ++layer)
+        {
+            const InferenceLayer& original = m_layers[layer];
+            for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+            {
+                for(unsigned column = 0; column < original.nInputs; ++column)
+                {
+                    mins[layer][column] = std::min(mins[layer][column], inputs[nRow * inputStride + column]);
+                    maxs[layer][column] = std::max(maxs[layer][column], inputs[nRow * inputStride + column]);
+                }
+            }
+            double* outputs = &work.outputs[layer % 2][0];
+            LinearAlgebra::multiplyTransposed(inputs, inputStride, original.weights, original.stride, outputs, original.outputStride, nBatch, original.nNodes, original.nInputs);
+            for(unsigned nRow = 0; nRow < nBatch; ++nRow)
+            {
+                double* row = outputs + nRow * original.outputStride;
+                Kernels::axpy(1.0, original.thresholds, row, original.nNodes);
+                m_source.activate(layer, row, original.nNodes);
+            }
+            inputs = outputs;
+            inputStride = original.outputStride;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include "../include/runningstatistics.h"
+#include <cmath>
+#include <limits>
+
+RunningStatistics::RunningStatistics(unsigned nColumns)
+: m_count(0)
+, m_mins(nColumns, std::numeric_limits<double>::max())
+, m_maxs(nColumns, -std::numeric_limits<double>::max())
+, m_means(nColumns, 0.0)
+, m_squaredDeviations(nColumns, 0.0)
+{
+
+}
+
+void RunningStatistics::add(const double* row)
+{
+    ++m_count;
+    const double weight = 1.0 / m_count;
+    const unsigned nColumns = m_means.size();
+    double* mins = m_mins.data();
+    double* maxs = m_maxs.data();
+    double* means = m_means.data();
+    double* squaredDeviations = m_squaredDeviations.data();
+    //Each column is independent, so that the loop is vectorised.
+    for(unsigned i = 0; i < nColumns; ++i)
+    {
+        const double delta = row[i] - means[i];
+        means[i] += delta * weight;
+        squaredDeviations[i] += delta * (row[i] - means[i]);
+        mins[i] = row[i] < mins[i] ? row[i] : mins[i];
+        maxs[i] = row[i] > maxs[i] ? row[i] : maxs[i];
+    }
+}
+
+void RunningStatistics::merge(const RunningStatistics& other)
+{
+    if(other.m_count == 0)
+    {
+        return;
+    }
+    if(m_count == 0)
+    {
+        *this = other;
+        return;
+    }
+    const double count = static_cast<double>(m_count + other.m_count);
+    const double otherWeight = other.m_count / count;
+    const double cross = static_cast<double>(m_count) * other.m_count / count;
+    for(unsigned i = 0; i < m_means.size(); ++i)
+    {
+        const double delta = other.m_means[i] - m_means[i];
+        m_means[i] += delta * otherWeight;
+        m_squaredDeviations[i] += other.m_squaredDeviations[i] + delta * delta * cross;
+        if(other.m_mins[i] < m_mins[i])
+        {
+            m_mins[i] = other.m_mins[i];
+        }
+        if(other.m_maxs[i] > m_maxs[i])
+        {
+            m_maxs[i] = other.m_maxs[i];
+        }
+    }
+    m_count += other.m_count;
+}
+
+std::vector<double> RunningStatistics::stdDevs() const
+{
+    std::vector<double> stdDevs(m_squaredDeviations.size(), 0.0);
+    for(unsigned i = 0; i < stdDevs.size() && m_count > 0; ++i)
+    {
+        stdDevs[i] = sqrt(m_squaredDeviations[i] / m_count);
+    }
+    return stdDevs;
+}
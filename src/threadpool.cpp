@@ -0,0 +1,95 @@
+#include "../include/threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned nThreads)
+: m_stop(false)
+{
+    if(nThreads == 0)
+    {
+        nThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    //The calling thread is one of the threads running the loops.
+    for(unsigned i = 1; i < nThreads; ++i)
+    {
+        m_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+    for(unsigned i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].join();
+    }
+}
+
+void ThreadPool::parallelFor(unsigned begin, unsigned end, const std::function<void(unsigned)>& body)
+{
+    //Nothing to share: the loop is run by the calling thread.
+    if(m_workers.empty() || end - begin <= 1)
+    {
+        for(unsigned i = begin; i < end; ++i)
+        {
+            body(i);
+        }
+        return;
+    }
+    Job job;
+    job.body = &body;
+    job.next = begin;
+    job.end = end;
+    job.nWorkers = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(&job);
+    }
+    m_jobAvailable.notify_all();
+    runIterations(job);
+    //The job lives on this stack, so it can only be left when no worker is using it.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    removeJob(&job);
+    m_workerDone.wait(lock, [&job]{return job.nWorkers == 0;});
+}
+
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_jobAvailable.wait(lock, [this]{return m_stop || !m_jobs.empty();});
+        if(m_jobs.empty())
+        {
+            return;
+        }
+        Job* job = m_jobs.front();
+        ++job->nWorkers;
+        lock.unlock();
+        runIterations(*job);
+        lock.lock();
+        removeJob(job);
+        --job->nWorkers;
+        m_workerDone.notify_all();
+    }
+}
+
+void ThreadPool::runIterations(Job& job)
+{
+    for(unsigned i = job.next++; i < job.end; i = job.next++)
+    {
+        (*job.body)(i);
+    }
+}
+
+void ThreadPool::removeJob(Job* job)
+{
+    std::deque<Job*>::iterator it = std::find(m_jobs.begin(), m_jobs.end(), job);
+    if(it != m_jobs.end())
+    {
+        m_jobs.erase(it);
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * @file kernelstest.cpp
+ * @brief Compares each kernel of the table in use, as chosen through NN_KERNELS, against
+ * the portable table.
+ *
+ * Usage: kernelstest instructionSet. CTest runs it once per value of NN_KERNELS; if the CPU
+ * does not support the instruction set requested, the narrower table chosen instead is
+ * tested. The vector kernels may sum in another order, use fused multiply-adds, and
+ * approximate the exponential, so that floating point results are compared within a
+ * tolerance; the integer dot products and the quantisation are compared exactly.
+ */
+#include "../include/kernels.h"
+#include "testreport.h"
+#include <vector>
+#include <random>
+#include <string>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+
+namespace
+{
+std::mt19937 generator(12345);
+
+//Lengths covering the vector loops of every instruction set, and their remainders.
+const unsigned lengths[] = {0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000};
+
+template<typename Real>
+double tolerance()
+{
+    return std::is_same<Real, double>::value ? 1e-13 : 1e-5;
+}
+
+template<typename Real>
+std::vector<Real> randomVector(unsigned n, double low, double high)
+{
+    std::uniform_real_distribution<double> distribution(low, high);
+    std::vector<Real> values(n);
+    for(unsigned i = 0; i < n; ++i)
+    {
+        values[i] = static_cast<Real>(distribution(generator));
+    }
+    return values;
+}
+
+template<typename Real>
+bool closeVectors(const std::vector<Real>& values, const std::vector<Real>& references, double tolerance)
+{
+    for(unsigned i = 0; i < values.size(); ++i)
+    {
+        if(!TestReport::close(values[i], references[i], tolerance))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string label(const char* kernel, unsigned n)
+{
+    return std::string(kernel) + ", n = " + std::to_string(n);
+}
+
+template<typename Real>
+void testDot(TestReport& report, Real (*portable)(const Real*, const Real*, unsigned), const char* name)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<Real> x = randomVector<Real>(n, -1.0, 1.0);
+        std::vector<Real> y = randomVector<Real>(n, -1.0, 1.0);
+        double magnitude = 0.0;
+        for(unsigned i = 0; i < n; ++i)
+        {
+            magnitude += std::fabs(double(x[i]) * y[i]);
+        }
+        double difference = Kernels::dot(x.data(), y.data(), n) - portable(x.data(), y.data(), n);
+        report.check(std::fabs(difference) <= tolerance<Real>() * std::max(1.0, magnitude), label(name, n));
+    }
+}
+
+template<typename Real, typename Accumulator>
+void testAxpy(TestReport& report, void (*portable)(double, const Real*, Accumulator*, unsigned), const char* name)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<Real> x = randomVector<Real>(n, -1.0, 1.0);
+        std::vector<Accumulator> y = randomVector<Accumulator>(n, -1.0, 1.0);
+        std::vector<Accumulator> reference = y;
+        Kernels::axpy(0.37, x.data(), y.data(), n);
+        portable(0.37, x.data(), reference.data(), n);
+        report.check(closeVectors(y, reference, tolerance<Real>()), label(name, n));
+    }
+}
+
+template<typename Real, typename Accumulator>
+void testMomentumUpdate(TestReport& report, void (*portable)(Real*, Accumulator*, Accumulator*, double, unsigned), const char* name)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<Real> weights = randomVector<Real>(n, -1.0, 1.0);
+        std::vector<Accumulator> deltaWeights = randomVector<Accumulator>(n, -0.1, 0.1);
+        std::vector<Accumulator> oldDeltaWeights = randomVector<Accumulator>(n, -0.1, 0.1);
+        std::vector<Real> referenceWeights = weights;
+        std::vector<Accumulator> referenceDeltaWeights = deltaWeights;
+        std::vector<Accumulator> referenceOldDeltaWeights = oldDeltaWeights;
+        Kernels::momentumUpdate(weights.data(), deltaWeights.data(), oldDeltaWeights.data(), 0.9, n);
+        portable(referenceWeights.data(), referenceDeltaWeights.data(), referenceOldDeltaWeights.data(), 0.9, n);
+        report.check(closeVectors(weights, referenceWeights, tolerance<Real>())
+                     && deltaWeights == referenceDeltaWeights && oldDeltaWeights == referenceOldDeltaWeights, label(name, n));
+    }
+}
+
+//Functions applied in place, from points spread over the saturated parts as well.
+template<typename Real>
+void testActivation(TestReport& report, void (*kernel)(Real*, unsigned, double), void (*portable)(Real*, unsigned, double), const char* name)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<Real> values = randomVector<Real>(n, -30.0, 30.0);
+        std::vector<Real> reference = values;
+        kernel(values.data(), n, 0.7);
+        portable(reference.data(), n, 0.7);
+        report.check(closeVectors(values, reference, tolerance<Real>()), label(name, n));
+    }
+}
+
+template<typename Real>
+void testDerivative(TestReport& report, void (*kernel)(const Real*, Real*, unsigned, double), void (*portable)(const Real*, Real*, unsigned, double),
+                    const char* name)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<Real> outputs = randomVector<Real>(n, -1.0, 1.0);
+        std::vector<Real> derivatives(n);
+        std::vector<Real> reference(n);
+        kernel(outputs.data(), derivatives.data(), n, 0.7);
+        portable(outputs.data(), reference.data(), n, 0.7);
+        report.check(closeVectors(derivatives, reference, tolerance<Real>()), label(name, n));
+    }
+}
+
+template<typename Compact>
+void testDequantise(TestReport& report, void (*portable)(const Compact*, const double*, const double*, double*, unsigned), const char* name)
+{
+    std::uniform_int_distribution<unsigned> distribution(0, std::numeric_limits<Compact>::max());
+    for(unsigned n : lengths)
+    {
+        std::vector<Compact> values(n);
+        for(unsigned i = 0; i < n; ++i)
+        {
+            values[i] = static_cast<Compact>(distribution(generator));
+        }
+        std::vector<double> scales = randomVector<double>(n, 0.001, 0.1);
+        std::vector<double> shifts = randomVector<double>(n, -10.0, 10.0);
+        std::vector<double> y(n);
+        std::vector<double> reference(n);
+        Kernels::dequantise(values.data(), scales.data(), shifts.data(), y.data(), n);
+        portable(values.data(), scales.data(), shifts.data(), reference.data(), n);
+        report.check(closeVectors(y, reference, tolerance<double>()), label(name, n));
+    }
+}
+
+//With unit scales and no offsets the results are the integer sums themselves, which must
+//be exact, up to the largest sums of 65536 products; the rows are padded, with bytes that
+//must not be read.
+void testMultiplyInt8(TestReport& report, const KernelTable& portable)
+{
+    const unsigned nRows = 6;
+    std::uniform_int_distribution<int> unsignedBytes(0, 255);
+    std::uniform_int_distribution<int> signedBytes(-128, 127);
+    std::vector<unsigned> multiplyLengths(std::begin(lengths), std::end(lengths));
+    multiplyLengths.push_back(65536);
+    for(unsigned n : multiplyLengths)
+    {
+        const unsigned stride = n + 5;
+        for(unsigned extreme = 0; extreme < 3; ++extreme)
+        {
+            std::vector<std::uint8_t> x(n);
+            std::vector<std::int8_t> weights(nRows * stride, 99);
+            for(unsigned i = 0; i < n; ++i)
+            {
+                x[i] = static_cast<std::uint8_t>(extreme == 0 ? unsignedBytes(generator) : 255);
+                for(unsigned row = 0; row < nRows; ++row)
+                {
+                    int weight = (extreme == 0) ? signedBytes(generator) : (extreme == 1 ? -128 : 127);
+                    weights[row * stride + i] = static_cast<std::int8_t>(weight);
+                }
+            }
+            std::vector<double> scales(nRows, 1.0);
+            std::vector<double> biases(nRows, 0.0);
+            std::vector<double> y(nRows);
+            Kernels::multiply(x.data(), weights.data(), stride, nRows, n, scales.data(), biases.data(), y.data());
+            bool exact = true;
+            for(unsigned row = 0; row < nRows; ++row)
+            {
+                std::int64_t sum = 0;
+                for(unsigned i = 0; i < n; ++i)
+                {
+                    sum += static_cast<std::int64_t>(x[i]) * weights[row * stride + i];
+                }
+                exact = exact && y[row] == static_cast<double>(sum);
+            }
+            report.check(exact, label(extreme == 0 ? "multiplyInt8 exact sums" : "multiplyInt8 exact extreme sums", n));
+        }
+        std::vector<std::uint8_t> x(n);
+        std::vector<std::int8_t> weights(nRows * stride);
+        for(unsigned i = 0; i < n; ++i)
+        {
+            x[i] = static_cast<std::uint8_t>(unsignedBytes(generator));
+        }
+        for(std::int8_t& weight : weights)
+        {
+            weight = static_cast<std::int8_t>(signedBytes(generator));
+        }
+        std::vector<double> scales = randomVector<double>(nRows, 1e-5, 1e-3);
+        std::vector<double> biases = randomVector<double>(nRows, -1.0, 1.0);
+        std::vector<double> y(nRows);
+        std::vector<double> reference(nRows);
+        Kernels::multiply(x.data(), weights.data(), stride, nRows, n, scales.data(), biases.data(), y.data());
+        portable.multiplyInt8(x.data(), weights.data(), stride, nRows, n, scales.data(), biases.data(), reference.data());
+        report.check(closeVectors(y, reference, tolerance<double>()), label("multiplyInt8 scaled", n));
+    }
+}
+
+//The levels are rounded ties to even in every version, but a fused multiply-add may move a
+//level lying within rounding of a tie to the other side: only there a difference of one is allowed.
+void testQuantise8(TestReport& report, const KernelTable& portable)
+{
+    for(unsigned n : lengths)
+    {
+        std::vector<double> x = randomVector<double>(n, -2.0, 2.0);
+        std::vector<double> inverseSteps = randomVector<double>(n, 40.0, 80.0);
+        std::vector<double> shifts = randomVector<double>(n, 100.0, 150.0);
+        for(unsigned i = 0; i < n; i += 7)
+        {
+            x[i] = (i % 2 == 0) ? std::numeric_limits<double>::quiet_NaN() : 1e300;
+        }
+        for(unsigned i = 3; i < n; i += 11)
+        {
+            //An exact tie.
+            x[i] = 0.5;
+            inverseSteps[i] = 1.0;
+            shifts[i] = 2.0;
+        }
+        std::vector<std::uint8_t> values(n);
+        std::vector<std::uint8_t> reference(n);
+        Kernels::quantise(x.data(), inverseSteps.data(), shifts.data(), values.data(), n);
+        portable.quantise8(x.data(), inverseSteps.data(), shifts.data(), reference.data(), n);
+        bool equal = true;
+        for(unsigned i = 0; i < n; ++i)
+        {
+            double level = x[i] * inverseSteps[i] + shifts[i];
+            bool nearTie = std::fabs(level - std::floor(level) - 0.5) < 1e-9;
+            equal = equal && (values[i] == reference[i] || (nearTie && std::abs(values[i] - reference[i]) == 1));
+        }
+        report.check(equal, label("quantise8", n));
+    }
+}
+
+//The tile in use is compared against the portable tiles covering the same columns, with
+//both layouts of A used by LinearAlgebra; the entries of C around the tile must not change.
+template<typename Real>
+void testMultiplyTile(TestReport& report, unsigned width, unsigned portableWidth,
+                      void (*portable)(const Real*, unsigned, unsigned, const Real*, unsigned, Real*, unsigned, unsigned, double, bool), const char* name)
+{
+    if(!report.check(width % portableWidth == 0, std::string(name) + " width " + std::to_string(width)))
+    {
+        return;
+    }
+    const unsigned rows = Kernels::tileRows;
+    const unsigned ldb = width + 3;
+    const unsigned ldc = width + 5;
+    const unsigned ks[] = {0, 1, 2, 5, 64, 257};
+    for(unsigned k : ks)
+    {
+        for(unsigned transposed = 0; transposed < 2; ++transposed)
+        {
+            for(unsigned accumulate = 0; accumulate < 2; ++accumulate)
+            {
+                std::vector<Real> a = randomVector<Real>(rows * k, -1.0, 1.0);
+                std::vector<Real> b = randomVector<Real>(k * ldb, -1.0, 1.0);
+                std::vector<Real> c = randomVector<Real>((rows + 1) * ldc, -1.0, 1.0);
+                std::vector<Real> reference = c;
+                unsigned aRowStride = transposed ? 1 : k;
+                unsigned aColumnStride = transposed ? rows : 1;
+                Kernels::multiplyTile(a.data(), aRowStride, aColumnStride, b.data(), ldb, c.data(), ldc, k, 0.3, accumulate != 0);
+                for(unsigned col = 0; col < width; col += portableWidth)
+                {
+                    portable(a.data(), aRowStride, aColumnStride, b.data() + col, ldb, reference.data() + col, ldc, k, 0.3, accumulate != 0);
+                }
+                std::string what = label(name, k) + (transposed ? ", A by columns" : ", A by rows") + (accumulate ? ", accumulated" : "");
+                report.check(closeVectors(c, reference, tolerance<Real>() * std::max(1u, k)), what);
+            }
+        }
+    }
+}
+}
+
+int main(int argc, char* argv[])
+{
+    TestReport report(std::string("kernels ") + Kernels::instructionSet());
+    if(argc > 1 && std::string(argv[1]) != Kernels::instructionSet())
+    {
+        std::cout << argv[1] << " is not supported here, testing the " << Kernels::instructionSet() << " kernels instead" << std::endl;
+    }
+    const KernelTable& portable = *portableKernels();
+    testDot<double>(report, portable.dot, "dot");
+    testDot<float>(report, portable.dotFloat, "dotFloat");
+    testAxpy<double, double>(report, portable.axpy, "axpy");
+    testAxpy<float, float>(report, portable.axpyFloat, "axpyFloat");
+    testAxpy<float, double>(report, portable.axpyMixed, "axpyMixed");
+    testMomentumUpdate<double, double>(report, portable.momentumUpdate, "momentumUpdate");
+    testMomentumUpdate<float, float>(report, portable.momentumUpdateFloat, "momentumUpdateFloat");
+    testMomentumUpdate<float, double>(report, portable.momentumUpdateMixed, "momentumUpdateMixed");
+    testActivation<double>(report, Kernels::logistic, portable.logistic, "logistic");
+    testActivation<float>(report, Kernels::logistic, portable.logisticFloat, "logisticFloat");
+    testActivation<double>(report, Kernels::tanh, portable.tanh, "tanh");
+    testActivation<float>(report, Kernels::tanh, portable.tanhFloat, "tanhFloat");
+    testDerivative<double>(report, Kernels::logisticDerivative, portable.logisticDerivative, "logisticDerivative");
+    testDerivative<float>(report, Kernels::logisticDerivative, portable.logisticDerivativeFloat, "logisticDerivativeFloat");
+    testDerivative<double>(report, Kernels::tanhDerivative, portable.tanhDerivative, "tanhDerivative");
+    testDerivative<float>(report, Kernels::tanhDerivative, portable.tanhDerivativeFloat, "tanhDerivativeFloat");
+    testDequantise<std::uint8_t>(report, portable.dequantise8, "dequantise8");
+    testDequantise<std::uint16_t>(report, portable.dequantise16, "dequantise16");
+    testMultiplyInt8(report, portable);
+    testQuantise8(report, portable);
+    testMultiplyTile<double>(report, Kernels::tileColumns(), portable.tileColumns, portable.multiplyTile, "multiplyTile");
+    testMultiplyTile<float>(report, Kernels::tileColumnsFloat(), portable.tileColumnsFloat, portable.multiplyTileFloat, "multiplyTileFloat");
+    return report.result();
+}
@@ -0,0 +1,123 @@
+/**
+ * @file modelfiletest.cpp
+ * @brief Writes a net to a model file, maps it back, and checks that the inference engine
+ * of the file computes the outputs of the net as trained.
+ *
+ * Usage: modelfiletest inputFile, where inputFile is the parameter file of the repository,
+ * whose entries are changed for each net tested and written to Input.txt. The outputs of
+ * the engine of the file, from raw inputs, are compared with those of
+ * NetworkEngine::propagate from the scaled inputs, brought back to the units of the data.
+ */
+#include "../include/inputreader.h"
+#include "../include/patternsmanager.h"
+#include "../include/networkengine.h"
+#include "../include/inferenceengine.h"
+#include "../include/modelfile.h"
+#include "testreport.h"
+#include "testinputfile.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <iostream>
+#include <cstdlib>
+
+namespace
+{
+const unsigned inColumns = 6;
+const unsigned outColumns = 2;
+const unsigned nRows = 50;
+const char* const dataFile = "modelfiletest.data";
+const char* const modelFile = "modelfiletest.model";
+
+void testNet(TestReport& report, const std::string& templateFile, const std::map<unsigned, std::string>& values, double tolerance)
+{
+    writeInputFile(templateFile, values);
+    InputReader ir;
+    std::string name = values.at(15) + ", " + values.at(16) + ", " + values.at(19) + ": ";
+    PatternsManager raw(inColumns, outColumns);
+    raw.readFile(dataFile);
+    PatternsManager scaled(inColumns, outColumns);
+    scaled.readFile(dataFile);
+    scaled.scale(ir.scalingType());
+    std::mt19937 generator(12345);
+    NetworkEngine* engine = NetworkEngine::create(ir, nRows, 1, NULL, generator);
+    ModelFile::write(modelFile, ir, *engine, scaled);
+    ModelFile model(modelFile);
+
+    bool sameLayers = model.nLayers() == engine->nLayers() && model.inColumns() == inColumns && model.outColumns() == outColumns;
+    for(unsigned layer = 0; layer < engine->nLayers() && sameLayers; ++layer)
+    {
+        sameLayers = model.nNodes(layer) == engine->nNodes(layer) && model.nInputs(layer) == engine->nInputs(layer);
+        for(unsigned node = 0; node < engine->nNodes(layer) && sameLayers; ++node)
+        {
+            sameLayers = model.thresholds(layer)[node] == engine->threshold(layer, node);
+            for(unsigned input = 0; input < engine->nInputs(layer) && sameLayers; ++input)
+            {
+                sameLayers = model.weights(layer)[node * model.stride(layer) + input] == engine->weight(layer, node, input);
+            }
+        }
+    }
+    report.check(sameLayers, name + "layers, weights and thresholds");
+    report.check(model.hiddenFunction() == ModelFile::activation(ir.hiddenFunction()) && model.outFunction() == ModelFile::activation(ir.outFunction())
+                 && model.betaHidden() == ir.betaHidden() && model.betaOut() == ir.betaOut(), name + "activation functions");
+    bool sameScaling = model.scaled();
+    for(unsigned column = 0; column < inColumns && sameScaling; ++column)
+    {
+        sameScaling = model.inOffsets()[column] == scaled.inOffsets()[column] && model.inDivisors()[column] == scaled.inDivisors()[column];
+    }
+    for(unsigned column = 0; column < outColumns && sameScaling; ++column)
+    {
+        sameScaling = model.outOffsets()[column] == scaled.outOffsets()[column] && model.outDivisors()[column] == scaled.outDivisors()[column];
+    }
+    report.check(sameScaling, name + "scaling");
+
+    InferenceEngine* inference = InferenceEngine::create(model);
+    InferenceWorkspace work = inference->workspace(16);
+    std::vector<double> outputs(nRows * outColumns);
+    inference->predict(raw.inputMatrix(), raw.inputStride(), nRows, &outputs[0], outColumns, work);
+    engine->propagate(0, scaled.inputMatrix(), scaled.inputStride(), nRows);
+    bool sameOutputs = true;
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        for(unsigned column = 0; column < outColumns; ++column)
+        {
+            double expected = engine->output(row, column) * scaled.outDivisors()[column] + scaled.outOffsets()[column];
+            sameOutputs = sameOutputs && TestReport::close(outputs[row * outColumns + column], expected, tolerance);
+        }
+    }
+    report.check(sameOutputs, name + "outputs of the inference engine");
+    delete inference;
+    delete engine;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: modelfiletest inputFile" << std::endl;
+        return EXIT_FAILURE;
+    }
+    TestReport report("model file");
+    writeDataFile(dataFile, nRows, inColumns + outColumns, -20.0, 80.0);
+    std::map<unsigned, std::string> values;
+    values[1] = dataFile;
+    values[2] = std::to_string(inColumns);
+    values[3] = std::to_string(outColumns);
+    values[4] = "1";
+    values[5] = "5";
+    values[15] = "logistic 0.5";
+    values[16] = "logistic 0.5";
+    values[19] = "double";
+    testNet(report, argv[1], values, 1e-12);
+    //The single precision nets are stored, and used by the inference engine, in double precision.
+    values[4] = "2";
+    values[5] = "7 3";
+    values[15] = "tanh 0.7";
+    values[16] = "transfer 1";
+    values[19] = "float";
+    testNet(report, argv[1], values, 1e-5);
+    values[19] = "mixed";
+    testNet(report, argv[1], values, 1e-5);
+    return report.result();
+}
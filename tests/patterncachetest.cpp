@@ -0,0 +1,124 @@
+/**
+ * @file patterncachetest.cpp
+ * @brief Writes a binary pattern file and reads it back, or checks that a damaged one is
+ * rejected.
+ *
+ * Usage: patterncachetest [truncated|misaligned]. Without argument the data and the
+ * statistics read from the binary file are compared with those read from the text file.
+ * With an argument the binary file is damaged before being read, which must stop the
+ * program with the error message checked by CTest.
+ */
+#include "../include/patternsmanager.h"
+#include "../include/patterncache.h"
+#include "testreport.h"
+#include <vector>
+#include <random>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+
+namespace
+{
+const unsigned inColumns = 5;
+const unsigned outColumns = 2;
+const unsigned nRows = 37;
+
+void writeTextFile(const std::string& fileName)
+{
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> distribution(-100.0, 100.0);
+    std::ofstream file(fileName.c_str());
+    file << std::setprecision(17);
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        for(unsigned column = 0; column < inColumns + outColumns; ++column)
+        {
+            file << distribution(generator) << ((column + 1 < inColumns + outColumns) ? " " : "\n");
+        }
+    }
+}
+
+std::vector<char> readBytes(const std::string& fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void writeBytes(const std::string& fileName, const std::vector<char>& bytes)
+{
+    std::ofstream file(fileName.c_str(), std::ios::binary);
+    file.write(bytes.data(), bytes.size());
+}
+
+bool sameRows(const PatternsManager& text, const PatternsManager& binary)
+{
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        RowView textInputs = text.getInputPattern(row);
+        RowView binaryInputs = binary.getInputPattern(row);
+        RowView textOutputs = text.getOutput(row);
+        RowView binaryOutputs = binary.getOutput(row);
+        if(!std::equal(textInputs.begin(), textInputs.end(), binaryInputs.begin())
+           || !std::equal(textOutputs.begin(), textOutputs.end(), binaryOutputs.begin()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    //Each case has its own files, so that CTest can run them in parallel.
+    const std::string name = (argc > 1) ? std::string("patterncachetest_") + argv[1] : "patterncachetest";
+    const std::string textFile = name + ".data";
+    const std::string binaryFile = name + ".bin";
+    writeTextFile(textFile);
+    PatternsManager text(inColumns, outColumns);
+    text.readFile(textFile);
+    PatternCache::write(binaryFile, text);
+    if(argc > 1)
+    {
+        //The file loses the end of its output block, or its input block is moved off the
+        //64-byte boundary the kernels expect.
+        std::vector<char> bytes = readBytes(binaryFile);
+        if(std::string(argv[1]) == "truncated")
+        {
+            bytes.resize(bytes.size() - sizeof(double));
+        }
+        else
+        {
+            std::uint64_t inputsOffset;
+            std::memcpy(&inputsOffset, &bytes[offsetof(PatternCacheHeader, inputsOffset)], sizeof(inputsOffset));
+            inputsOffset += sizeof(double);
+            std::memcpy(&bytes[offsetof(PatternCacheHeader, inputsOffset)], &inputsOffset, sizeof(inputsOffset));
+        }
+        writeBytes(binaryFile, bytes);
+        PatternsManager damaged(inColumns, outColumns);
+        damaged.readFile(binaryFile);
+        std::cerr << "The " << argv[1] << " binary file was accepted" << std::endl;
+        return EXIT_FAILURE;
+    }
+    TestReport report("pattern cache");
+    report.check(PatternCache::isCache(binaryFile) && !PatternCache::isCache(textFile), "signature");
+    PatternsManager binary(inColumns, outColumns);
+    binary.readFile(binaryFile);
+    report.check(binary.numberOfInputPatterns() == nRows && binary.numberOfOutputs() == nRows, "sizes");
+    report.check(binary.inputStride() == text.inputStride() && binary.outputStride() == text.outputStride(), "strides");
+    report.check(reinterpret_cast<std::uintptr_t>(binary.inputMatrix()) % 64 == 0
+                 && reinterpret_cast<std::uintptr_t>(binary.outputMatrix()) % 64 == 0, "alignment of the mapped blocks");
+    report.check(sameRows(text, binary), "patterns");
+    report.check(binary.inMins() == text.inMins() && binary.inMaxs() == text.inMaxs()
+                 && binary.inMeans() == text.inMeans() && binary.inStdDevs() == text.inStdDevs(), "input statistics");
+    report.check(binary.outMins() == text.outMins() && binary.outMaxs() == text.outMaxs()
+                 && binary.outMeans() == text.outMeans() && binary.outStdDevs() == text.outStdDevs(), "output statistics");
+    return report.result();
+}
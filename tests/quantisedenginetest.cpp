@@ -0,0 +1,135 @@
+/**
+ * @file quantisedenginetest.cpp
+ * @brief Quantises the net of a model file to 8 bits, and checks its outputs against
+ * those of the double precision engine.
+ *
+ * Usage: quantisedenginetest inputFile, where inputFile is the parameter file of the
+ * repository (see modelfiletest.cpp). The integer products themselves are checked for
+ * exactness by kernelstest; here the outputs of the whole quantised net must stay within
+ * the error of the quantisation of the calibrated ranges, and inputs outside these ranges
+ * must saturate rather than wrap around.
+ */
+#include "../include/inputreader.h"
+#include "../include/patternsmanager.h"
+#include "../include/networkengine.h"
+#include "../include/inferenceengine.h"
+#include "../include/quantisedengine.h"
+#include "../include/modelfile.h"
+#include "../include/kernels.h"
+#include "testreport.h"
+#include "testinputfile.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+const unsigned inColumns = 6;
+const unsigned outColumns = 2;
+const unsigned nRows = 200;
+const char* const dataFile = "quantisedenginetest.data";
+const char* const modelFile = "quantisedenginetest.model";
+
+//Largest difference between the outputs of the two engines, relative to the range of the
+//outputs of the double precision one.
+double relativeError(const std::vector<double>& outputs, const std::vector<double>& reference)
+{
+    double difference = 0.0;
+    double low = *std::min_element(reference.begin(), reference.end());
+    double high = *std::max_element(reference.begin(), reference.end());
+    for(unsigned i = 0; i < outputs.size(); ++i)
+    {
+        difference = std::max(difference, std::fabs(outputs[i] - reference[i]));
+    }
+    return difference / (high - low);
+}
+
+void testNet(TestReport& report, const std::string& templateFile, const std::map<unsigned, std::string>& values, double tolerance)
+{
+    writeInputFile(templateFile, values);
+    InputReader ir;
+    std::string name = values.at(5) + " nodes, " + values.at(15) + ", " + values.at(16) + ": ";
+    PatternsManager raw(inColumns, outColumns);
+    raw.readFile(dataFile);
+    PatternsManager scaled(inColumns, outColumns);
+    scaled.readFile(dataFile);
+    scaled.scale(ir.scalingType());
+    std::mt19937 generator(12345);
+    NetworkEngine* engine = NetworkEngine::create(ir, nRows, 1, NULL, generator);
+    ModelFile::write(modelFile, ir, *engine, scaled);
+    ModelFile model(modelFile);
+    InferenceEngine* inference = InferenceEngine::create(model);
+    //Calibrated on the patterns it is checked on: every input and weight is then rounded to
+    //one of 255 steps of its range, and the errors add up over the layers (about 1% of the
+    //range of the outputs for the deeper net).
+    QuantisedEngine quantised(*inference, raw.inputMatrix(), raw.inputStride(), nRows);
+
+    std::vector<double> reference(nRows * outColumns);
+    std::vector<double> outputs(nRows * outColumns);
+    InferenceWorkspace work = inference->workspace(32);
+    InferenceWorkspace quantisedWork = quantised.workspace(32);
+    inference->predict(raw.inputMatrix(), raw.inputStride(), nRows, &reference[0], outColumns, work);
+    quantised.predict(raw.inputMatrix(), raw.inputStride(), nRows, &outputs[0], outColumns, quantisedWork);
+    double error = relativeError(outputs, reference);
+    std::cout << name << "largest error " << error << " of the range of the outputs" << std::endl;
+    report.check(error <= tolerance, name + "outputs within " + std::to_string(tolerance) + " of the range");
+
+    //Inputs beyond the calibrated ranges saturate the quantised inputs: inputs ten and a
+    //thousand times the range of the data beyond its ends must give the same outputs.
+    std::vector<double> farInputs(nRows * inColumns);
+    std::vector<double> fartherInputs(nRows * inColumns);
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        for(unsigned column = 0; column < inColumns; ++column)
+        {
+            double low = raw.inMins()[column];
+            double high = raw.inMaxs()[column];
+            bool below = raw.getInputPattern(row)[column] < 0.5 * (low + high);
+            farInputs[row * inColumns + column] = below ? low - 10.0 * (high - low) : high + 10.0 * (high - low);
+            fartherInputs[row * inColumns + column] = below ? low - 1000.0 * (high - low) : high + 1000.0 * (high - low);
+        }
+    }
+    std::vector<double> farOutputs(nRows * outColumns);
+    std::vector<double> fartherOutputs(nRows * outColumns);
+    quantised.predict(&farInputs[0], inColumns, nRows, &farOutputs[0], outColumns, quantisedWork);
+    quantised.predict(&fartherInputs[0], inColumns, nRows, &fartherOutputs[0], outColumns, quantisedWork);
+    bool clamped = true;
+    for(unsigned i = 0; i < farOutputs.size(); ++i)
+    {
+        clamped = clamped && std::isfinite(farOutputs[i]) && farOutputs[i] == fartherOutputs[i];
+    }
+    report.check(clamped, name + "inputs out of the calibrated ranges saturated");
+    delete inference;
+    delete engine;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: quantisedenginetest inputFile" << std::endl;
+        return EXIT_FAILURE;
+    }
+    TestReport report(std::string("quantised engine ") + Kernels::instructionSet());
+    writeDataFile(dataFile, nRows, inColumns + outColumns, -20.0, 80.0);
+    std::map<unsigned, std::string> values;
+    values[1] = dataFile;
+    values[2] = std::to_string(inColumns);
+    values[3] = std::to_string(outColumns);
+    values[4] = "1";
+    values[5] = "16";
+    values[15] = "logistic 0.5";
+    values[16] = "logistic 0.5";
+    testNet(report, argv[1], values, 0.02);
+    values[4] = "2";
+    values[5] = "70 30";
+    values[15] = "tanh 0.7";
+    values[16] = "transfer 1";
+    testNet(report, argv[1], values, 0.02);
+    return report.result();
+}
@@ -0,0 +1,224 @@
+/**
+ * @file servertest.cpp
+ * @brief Serves a net on a Unix domain socket and checks, as a client, the replies to rows,
+ * to a bad row, to stats and to a line too long, the outputs against those of the batch
+ * scoring.
+ *
+ * Usage: servertest inputFile, where inputFile is the parameter file of the repository
+ * (see modelfiletest.cpp). The server runs in a thread of the test, and is stopped with
+ * SIGTERM as the command serve would be.
+ */
+#include "../include/inputreader.h"
+#include "../include/patternsmanager.h"
+#include "../include/networkengine.h"
+#include "../include/inferenceengine.h"
+#include "../include/inferenceserver.h"
+#include "../include/batchscorer.h"
+#include "../include/threadpool.h"
+#include "../include/modelfile.h"
+#include "testreport.h"
+#include "testinputfile.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+const unsigned inColumns = 6;
+const unsigned outColumns = 2;
+const unsigned nRows = 100;
+const char* const dataFile = "servertest.data";
+const char* const modelFile = "servertest.model";
+const char* const inputsFile = "servertest.inputs";
+const char* const scoresFile = "servertest.scores";
+const char* const socketPath = "servertest.sock";
+//Longest line accepted by the server.
+const std::size_t maxLineLength = 1 << 20;
+
+//A connection to the server, reading its replies line by line.
+class Client
+{
+public:
+    Client() : m_connection(socket(AF_UNIX, SOCK_STREAM, 0))
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, socketPath);
+        if(m_connection < 0 || connect(m_connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::cerr << "Unable to connect to " << socketPath << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    ~Client()
+    {
+        close(m_connection);
+    }
+    void send(const std::string& text)
+    {
+        std::size_t sent = 0;
+        while(sent < text.size())
+        {
+            ssize_t n = write(m_connection, text.data() + sent, text.size() - sent);
+            if(n <= 0)
+            {
+                return;
+            }
+            sent += n;
+        }
+    }
+    //Next line received, without its newline; false once the server has closed the connection.
+    bool readLine(std::string& line)
+    {
+        std::size_t end;
+        while((end = m_received.find('\n')) == std::string::npos)
+        {
+            char chunk[4096];
+            ssize_t n = read(m_connection, chunk, sizeof(chunk));
+            if(n <= 0)
+            {
+                return false;
+            }
+            m_received.append(chunk, n);
+        }
+        line = m_received.substr(0, end);
+        m_received.erase(0, end + 1);
+        return true;
+    }
+private:
+    int m_connection;
+    std::string m_received;
+    Client(const Client&);
+    Client& operator=(const Client&);
+};
+
+std::vector<double> values(const std::string& line)
+{
+    std::istringstream text(line);
+    std::vector<double> result;
+    double value;
+    while(text >> value)
+    {
+        result.push_back(value);
+    }
+    return result;
+}
+
+bool sameOutputs(const std::string& reply, const std::string& scored)
+{
+    std::vector<double> replyValues = values(reply);
+    std::vector<double> scoredValues = values(scored);
+    bool same = replyValues.size() == outColumns && scoredValues.size() == outColumns;
+    for(unsigned column = 0; column < outColumns && same; ++column)
+    {
+        same = TestReport::close(replyValues[column], scoredValues[column], 1e-12);
+    }
+    return same;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        std::cerr << "Usage: servertest inputFile" << std::endl;
+        return EXIT_FAILURE;
+    }
+    TestReport report("inference server");
+    writeDataFile(dataFile, nRows, inColumns + outColumns, -20.0, 80.0);
+    writeDataFile(inputsFile, nRows, inColumns, -30.0, 90.0);
+    std::map<unsigned, std::string> entries;
+    entries[1] = dataFile;
+    entries[2] = std::to_string(inColumns);
+    entries[3] = std::to_string(outColumns);
+    entries[4] = "1";
+    entries[5] = "8";
+    writeInputFile(argv[1], entries);
+    InputReader ir;
+    PatternsManager scaled(inColumns, outColumns);
+    scaled.readFile(dataFile);
+    scaled.scale(ir.scalingType());
+    std::mt19937 generator(12345);
+    NetworkEngine* network = NetworkEngine::create(ir, nRows, 1, NULL, generator);
+    ModelFile::write(modelFile, ir, *network, scaled);
+    ModelFile model(modelFile);
+    InferenceEngine* engine = InferenceEngine::create(model);
+
+    ThreadPool pool(1);
+    BatchScorer scorer(*engine, pool, 16);
+    scorer.score(inputsFile, scoresFile);
+    std::vector<std::string> inputs;
+    std::vector<std::string> scores;
+    std::ifstream inputsStream(inputsFile);
+    std::ifstream scoresStream(scoresFile);
+    std::string line;
+    while(std::getline(inputsStream, line))
+    {
+        inputs.push_back(line);
+    }
+    while(std::getline(scoresStream, line))
+    {
+        scores.push_back(line);
+    }
+    report.check(inputs.size() == nRows && scores.size() == nRows, "rows scored");
+
+    InferenceServer server(*engine, 8, 200);
+    server.listen(std::string("unix:") + socketPath);
+    std::thread serving(&InferenceServer::run, &server);
+    {
+        //All the rows at once, a bad row in the middle, then the counters once they are answered.
+        Client client;
+        std::string rows;
+        for(unsigned row = 0; row < inputs.size(); ++row)
+        {
+            rows += inputs[row] + (row % 2 == 0 ? "\n" : "\r\n");
+            if(row == nRows / 2)
+            {
+                rows += "1 2 x\n";
+            }
+        }
+        client.send(rows);
+        bool same = true;
+        bool bad = false;
+        for(unsigned row = 0; row < inputs.size(); ++row)
+        {
+            same = same && client.readLine(line) && sameOutputs(line, scores[row]);
+            if(row == nRows / 2)
+            {
+                bad = client.readLine(line) && line.compare(0, 7, "error: ") == 0;
+            }
+        }
+        report.check(same, "outputs of the rows against the batch scoring");
+        report.check(bad, "error for a bad row");
+        client.send("stats\n");
+        std::istringstream stats(client.readLine(line) ? line : std::string());
+        std::string requests;
+        unsigned long long nRequests = 0;
+        stats >> requests >> nRequests;
+        report.check(requests == "requests" && nRequests == nRows, "stats");
+    }
+    {
+        //A line never ending is refused once longer than the limit, and its connection closed.
+        Client client;
+        client.send(std::string(maxLineLength + 1, '1'));
+        bool refused = client.readLine(line) && line.compare(0, 24, "error: line longer than ") == 0;
+        report.check(refused && !client.readLine(line), "line too long refused");
+    }
+    std::raise(SIGTERM);
+    serving.join();
+    report.check(server.statistics().nRequests == nRows, "requests counted");
+    delete engine;
+    delete network;
+    return report.result();
+}
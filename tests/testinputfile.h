@@ -0,0 +1,73 @@
+#ifndef TESTINPUTFILE_H
+#define TESTINPUTFILE_H
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <random>
+#include <iomanip>
+/**
+ * @file testinputfile.h
+ * @brief Contains the functions writing the data and parameter files of the tests
+ * which train or save nets.
+ */
+
+/**
+* @brief Writes a text data file of random values, uniform in [low, high].
+*
+* @param fileName Name of the file.
+* @param nRows Number of patterns.
+* @param nColumns Number of values per pattern, inputs and outputs.
+* @param low Lowest value.
+* @param high Highest value.
+*/
+inline void writeDataFile(const std::string& fileName, unsigned nRows, unsigned nColumns, double low, double high)
+{
+    std::mt19937 generator(12345);
+    std::uniform_real_distribution<double> distribution(low, high);
+    std::ofstream file(fileName.c_str());
+    file << std::setprecision(17);
+    for(unsigned row = 0; row < nRows; ++row)
+    {
+        for(unsigned column = 0; column < nColumns; ++column)
+        {
+            file << distribution(generator) << ((column + 1 < nColumns) ? " " : "\n");
+        }
+    }
+}
+
+/**
+* @brief Writes Input.txt as a copy of a parameter file, with the values of some entries
+* replaced. The lines end with CRLF, as in the file of the repository, which
+* @ref InputReader expects.
+*
+* @param templateFile The parameter file copied, e.g. data/Input.txt.
+* @param values New values, by number of entry as in the file.
+*/
+inline void writeInputFile(const std::string& templateFile, const std::map<unsigned, std::string>& values)
+{
+    std::ifstream source(templateFile.c_str());
+    std::ofstream file("Input.txt", std::ios::binary);
+    std::string line;
+    unsigned nEntry = 0;
+    bool header = true;
+    while(std::getline(source, line))
+    {
+        if(!line.empty() && line[line.length() - 1] == '\r')
+        {
+            line.erase(line.length() - 1);
+        }
+        if(!header && (line.empty() || line[0] != '#'))
+        {
+            ++nEntry;
+            std::map<unsigned, std::string>::const_iterator value = values.find(nEntry);
+            if(value != values.end())
+            {
+                line = value->second;
+            }
+        }
+        header = false;
+        file << line << "\r\n";
+    }
+}
+#endif // TESTINPUTFILE_H
@@ -0,0 +1,78 @@
+#ifndef TESTREPORT_H
+#define TESTREPORT_H
+
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+/**
+ * @file testreport.h
+ * @brief Contains class @ref TestReport.
+ */
+ /**
+ * @brief Class counting the checks of a test executable, and printing those that fail.
+ *
+ * The tests are plain executables run by CTest, which fail through their exit code.
+ */
+class TestReport
+{
+public:
+    /**
+    * @brief Constructor.
+    *
+    * @param name Name of the test, printed with the summary.
+    */
+    explicit TestReport(const std::string& name) : m_name(name), m_nChecks(0), m_nFailures(0) {}
+    /**
+    * @brief Records a check, printing \p what if it fails.
+    *
+    * @param passed Whether the check passed.
+    * @param what Description of the check.
+    * @return \p passed.
+    */
+    bool check(bool passed, const std::string& what)
+    {
+        ++m_nChecks;
+        if(!passed)
+        {
+            ++m_nFailures;
+            std::cerr << m_name << ": FAILED " << what << std::endl;
+        }
+        return passed;
+    }
+    /**
+    * @brief Whether two values agree within a relative tolerance.
+    *
+    * @param value Value computed.
+    * @param reference Value expected.
+    * @param tolerance Largest difference allowed, relative to the magnitude of the values
+    * (at least 1).
+    */
+    static bool close(double value, double reference, double tolerance)
+    {
+        return std::fabs(value - reference) <= tolerance * std::max(1.0, std::fabs(reference));
+    }
+    /**
+    * @brief Prints the summary and returns the exit code of the test.
+    */
+    int result() const
+    {
+        std::cout << m_name << ": " << m_nChecks - m_nFailures << " of " << m_nChecks << " checks passed" << std::endl;
+        return (m_nFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+private:
+    /**
+    * @brief Name of the test.
+    */
+    std::string m_name;
+    /**
+    * @brief Number of checks.
+    */
+    unsigned m_nChecks;
+    /**
+    * @brief Number of failed checks.
+    */
+    unsigned m_nFailures;
+};
+#endif // TESTREPORT_H